@@ -11,7 +11,22 @@ proc savestate_common {} {
 	}
 }
 
-proc savestate {{name ""}} {
+proc savestate {args} {
+	set name ""
+	set format "xml"
+	while {[llength $args] > 0} {
+		set args [lassign $args arg]
+		switch -- $arg {
+			"-format" {
+				if {[llength $args] == 0} {error "missing value for -format"}
+				set args [lassign $args format]
+			}
+			default {
+				if {$name ne ""} {error "too many arguments"}
+				set name $arg
+			}
+		}
+	}
 	savestate_common
 	file mkdir $directory
 	if {[catch {::openmsx::internal_screenshot -raw -doublesize $png}]} {
@@ -19,7 +34,7 @@ proc savestate {{name ""}} {
 		catch {file delete -- $png}
 	}
 	set currentID [machine]
-	store_machine $currentID $fullname
+	store_machine -format $format $currentID $fullname
 	return $fullname
 }
 
@@ -94,12 +109,14 @@ proc savestate_list_tab {args} {
 
 # savestate
 set_help_text savestate \
-{savestate [<name>]
+{savestate [-format xml|binary] [<name>]
 
 Create a snapshot of the current emulated MSX machine.
 
 Optionally you can specify a name for the savestate. If you omit this the default name 'quicksave' will be taken.
 
+The default 'xml' format can be loaded by any (later) openMSX version. The 'binary' format is a lot faster to save and load, but it can only be loaded by the exact same openMSX build that created it. 'loadstate' automatically detects the format.
+
 See also 'loadstate', 'list_savestates', 'delete_savestate'.
 }
 set_tabcompletion_proc savestate [namespace code savestate_tab]
@@ -28,6 +28,9 @@ GlobalSettings::GlobalSettings(GlobalCommandController& commandController_)
 		EnumSetting<ResampledSoundDevice::ResampleType>::Map{
 			{"hq",   ResampledSoundDevice::ResampleType::HQ},
 			{"blip", ResampledSoundDevice::ResampleType::BLIP}})
+	, reverseMemoryBudgetSetting(commandController, "reverse_memory_budget",
+		"maximum amount of memory (in MB) used for the reverse history of a machine, 0 means unlimited",
+		0, 0, 1024 * 1024)
 	, speedManager(commandController)
 	, throttleManager(commandController)
 {
@@ -49,6 +49,9 @@ public:
 	[[nodiscard]] EnumSetting<ResampledSoundDevice::ResampleType>& getResampleSetting() {
 		return resampleSetting;
 	}
+	[[nodiscard]] IntegerSetting& getReverseMemoryBudgetSetting() {
+		return reverseMemoryBudgetSetting;
+	}
 	[[nodiscard]] SpeedManager& getSpeedManager() {
 		return speedManager;
 	}
@@ -70,6 +73,7 @@ private:
 	StringSetting  invalidPsgDirectionsSetting;
 	StringSetting  invalidPpiModeSetting;
 	EnumSetting<ResampledSoundDevice::ResampleType> resampleSetting;
+	IntegerSetting reverseMemoryBudgetSetting;
 	SpeedManager speedManager;
 	ThrottleManager throttleManager;
 };
@@ -16,6 +16,7 @@
 #include "FileContext.hh"
 #include "FileException.hh"
 #include "FilePool.hh"
+#include "FrameHashRecorder.hh"
 #include "GlobalCliComm.hh"
 #include "GlobalCommandController.hh"
 #include "GlobalSettings.hh"
@@ -33,6 +34,7 @@
 #include "RomInfo.hh"
 #include "StateChangeDistributor.hh"
 #include "SymbolManager.hh"
+#include "TclArgParser.hh"
 #include "TclCallbackMessages.hh"
 #include "TclObject.hh"
 #include "UserSettings.hh"
@@ -48,6 +50,7 @@
 
 #include "narrow.hh"
 #include "serialize.hh"
+#include "serialize_binary.hh"
 #include "stl.hh"
 #include "unreachable.hh"
 
@@ -284,6 +287,7 @@ void Reactor::init()
 	setClipboardCommand = std::make_unique<SetClipboardCommand>(
 		*globalCommandController, *this);
 	aviRecordCommand = std::make_unique<AviRecorder>(*this);
+	frameHashRecorder = std::make_unique<FrameHashRecorder>(*this);
 	extensionInfo = std::make_unique<ConfigInfo>(
 		getOpenMSXInfoCommand(), "extensions");
 	machineInfo   = std::make_unique<ConfigInfo>(
@@ -1034,22 +1038,40 @@ StoreMachineCommand::StoreMachineCommand(
 
 void StoreMachineCommand::execute(std::span<const TclObject> tokens, TclObject& result)
 {
-	checkNumArgs(tokens, 3, Prefix{1}, "id filename");
-	const auto& machineID = tokens[1].getString();
-	const auto& filename = tokens[2].getString();
+	std::string_view format = "xml";
+	std::array info = {valueArg("-format", format)};
+	auto args = parseTclArgs(getInterpreter(), tokens.subspan(1), info);
+	if (args.size() != 2) {
+		throw SyntaxError();
+	}
+	const auto& machineID = args[0].getString();
+	const auto& filename = args[1].getString();
 
 	const auto& board = *reactor.getMachine(machineID);
 
-	XmlOutputArchive out(filename);
-	out.serialize("machine", board);
-	out.close();
+	if (format == "xml") {
+		XmlOutputArchive out(filename);
+		out.serialize("machine", board);
+		out.close();
+	} else if (format == "binary") {
+		BinaryOutputArchive out(filename);
+		out.serialize("machine", board);
+		out.close();
+	} else {
+		throw CommandException("Unknown savestate format '", format,
+		                       "', must be 'xml' or 'binary'.");
+	}
 	result = filename;
 }
 
 std::string StoreMachineCommand::help(std::span<const TclObject> /*tokens*/) const
 {
 	return
-		"store_machine machineID <filename>  Save state of machine \"machineID\" to indicated file\n"
+		"store_machine [-format xml|binary] machineID <filename>\n"
+		"    Save state of machine \"machineID\" to indicated file.\n"
+		"    The (default) xml format is portable, the binary format is\n"
+		"    a lot faster to save and load, but can only be loaded again\n"
+		"    by the same openMSX build.\n"
 		"\n"
 		"This is a low-level command, the 'savestate' script is easier to use.";
 }
@@ -1078,8 +1100,13 @@ void RestoreMachineCommand::execute(std::span<const TclObject> tokens,
 	const auto filename = FileOperations::expandTilde(std::string(tokens[1].getString()));
 
 	try {
-		XmlInputArchive in(filename);
-		in.serialize("machine", *newBoard);
+		if (BinaryInputArchive::isBinary(filename)) {
+			BinaryInputArchive in(filename);
+			in.serialize("machine", *newBoard);
+		} else {
+			XmlInputArchive in(filename);
+			in.serialize("machine", *newBoard);
+		}
 	} catch (XMLException& e) {
 		throw CommandException("Cannot load state, bad file format: ",
 		                       e.getMessage());
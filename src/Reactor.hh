@@ -33,6 +33,7 @@ class Display;
 class EventDistributor;
 class ExitCommand;
 class FilePool;
+class FrameHashRecorder;
 class GetClipboardCommand;
 class GlobalCliComm;
 class GlobalCommandController;
@@ -202,6 +203,7 @@ private:
 	std::unique_ptr<GetClipboardCommand> getClipboardCommand;
 	std::unique_ptr<SetClipboardCommand> setClipboardCommand;
 	std::unique_ptr<AviRecorder> aviRecordCommand;
+	std::unique_ptr<FrameHashRecorder> frameHashRecorder;
 	std::unique_ptr<ConfigInfo> extensionInfo;
 	std::unique_ptr<ConfigInfo> machineInfo;
 	std::unique_ptr<RealTimeInfo> realTimeInfo;
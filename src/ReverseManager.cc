@@ -8,6 +8,7 @@
 #include "EventDistributor.hh"
 #include "FileContext.hh"
 #include "FileOperations.hh"
+#include "GlobalSettings.hh"
 #include "Keyboard.hh"
 #include "MSXCliComm.hh"
 #include "MSXCommandController.hh"
@@ -27,6 +28,7 @@
 #include "narrow.hh"
 #include "one_of.hh"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cmath>
@@ -108,6 +110,7 @@ void ReverseManager::ReverseHistory::swap(ReverseHistory& other) noexcept
 {
 	std::swap(chunks, other.chunks);
 	std::swap(events, other.events);
+	std::swap(memoryTotal, other.memoryTotal);
 }
 
 void ReverseManager::ReverseHistory::clear()
@@ -115,6 +118,8 @@ void ReverseManager::ReverseHistory::clear()
 	// clear() and free storage capacity
 	Chunks().swap(chunks);
 	Events().swap(events);
+	memoryTotal = 0;
+	compressorSaved = getCompressorSaved();
 }
 
 
@@ -125,6 +130,7 @@ ReverseManager::ReverseManager(MSXMotherBoard& motherBoard_)
 	, syncInputEvent (motherBoard_.getScheduler())
 	, motherBoard(motherBoard_)
 	, eventDistributor(motherBoard.getReactor().getEventDistributor())
+	, memoryBudgetSetting(motherBoard.getReactor().getGlobalSettings().getReverseMemoryBudgetSetting())
 	, reverseCmd(motherBoard.getCommandController())
 {
 	eventDistributor.registerEventListener(EventType::TAKE_REVERSE_SNAPSHOT, *this);
@@ -227,6 +233,14 @@ void ReverseManager::status(TclObject& result) const
 	}));
 	result.addDictKeyValue("snapshots", snapshots);
 
+	TclObject snapshotMemory;
+	snapshotMemory.addListElements(std::views::transform(history.chunks, [](auto& p) {
+		return narrow_cast<int64_t>(p.second.memorySize);
+	}));
+	result.addDictKeyValue("snapshot_memory", snapshotMemory);
+	result.addDictKeyValue("memory", narrow_cast<int64_t>(history.getMemoryTotal()));
+	result.addDictKeyValue("memory_budget", int64_t(memoryBudgetSetting.getInt()) * 1024 * 1024);
+
 	auto lastEvent = rbegin(history.events);
 	if (lastEvent != rend(history.events) && std::holds_alternative<EndLogEvent>(*lastEvent)) {
 		++lastEvent;
@@ -250,6 +264,15 @@ void ReverseManager::debugInfo(TclObject& result) const
 		totalSize += chunk.savestate.size();
 	}
 	strAppend(res, "total size: ", totalSize, '\n');
+	auto stats = history.lastDeltaBlocks.getCompressorStats();
+	strAppend(res, "compressed in background: ", stats.background,
+	          ", synchronous (queue full): ", stats.synchronous,
+	          ", dropped before compression: ", stats.dropped,
+	          ", saved ", stats.saved, " bytes\n",
+	          "strong recompression: ", stats.strong,
+	          " blocks, saved ", stats.strongSaved, " bytes\n",
+	          "compression queue: ", stats.queued,
+	          " (max ", stats.maxQueued, ")\n");
 	result = res;
 }
 
@@ -735,6 +758,7 @@ void ReverseManager::loadReplay(
 		newHistory.chunks[newHistory.getNextSeqNum(newChunk.time)] =
 			std::move(newChunk);
 	}
+	newHistory.updateMemorySizes();
 
 	// Note: until this point we didn't make any changes to the current
 	// ReverseManager/MSXMotherBoard yet
@@ -756,6 +780,8 @@ void ReverseManager::transferHistory(ReverseHistory& oldHistory,
 
 	// actual history transfer
 	history.swap(oldHistory);
+	// the blocks are no longer compressed by the old compressor
+	history.updateMemorySizes();
 
 	// resume collecting (and event recording)
 	collecting = true;
@@ -861,15 +887,147 @@ void ReverseManager::takeSnapshot(EmuTime time)
 	// sequence number, though this snapshot does not necessarily have the
 	// exact same EmuTime (because we don't (re)start taking snapshots at
 	// the same moment in time).
+	if (auto it = history.chunks.find(seqNum); it != end(history.chunks)) {
+		history.erase(it, std::next(it));
+	}
 
 	// actually create new snapshot
-	ReverseChunk& newChunk = history.chunks[seqNum];
-	newChunk.deltaBlocks.clear();
+	ReverseChunk newChunk;
 	MemOutputArchive out(history.lastDeltaBlocks, newChunk.deltaBlocks, true);
 	out.serialize("machine", motherBoard);
 	newChunk.time = time;
 	newChunk.savestate = std::move(out).releaseBuffer();
 	newChunk.eventCount = replayIndex;
+	history.add(seqNum, std::move(newChunk));
+
+	enforceMemoryBudget();
+}
+
+void ReverseManager::ReverseHistory::updateMemorySizes()
+{
+	// Delta blocks are shared between snapshots, count each block only
+	// once, in the oldest snapshot that uses it.
+	std::unordered_set<const DeltaBlock*> seen;
+	size_t total = 0;
+	for (auto& [idx, chunk] : chunks) {
+		chunk.memorySize = chunk.savestate.size();
+		for (const auto& block : chunk.deltaBlocks) {
+			chunk.memorySize += block->getMemorySize(seen);
+		}
+		total += chunk.memorySize;
+	}
+	memoryTotal = total;
+	// Query this afterwards: a block that gets compressed while we're
+	// measuring then (typically) results in an overestimation instead of
+	// an underestimation.
+	compressorSaved = getCompressorSaved();
+}
+
+size_t ReverseManager::ReverseHistory::calcMemorySize(Chunks::const_iterator it) const
+{
+	// A delta block that is shared with older snapshots is always also
+	// used by the previous snapshot (snapshots are taken in order), so
+	// it's enough to only look at that one. (And if not, the block is
+	// counted twice, an overestimation is fine).
+	std::unordered_set<const DeltaBlock*> seen;
+	if (it != begin(chunks)) {
+		for (const auto& block : std::prev(it)->second.deltaBlocks) {
+			(void)block->getMemorySize(seen);
+		}
+	}
+	const auto& chunk = it->second;
+	size_t size = chunk.savestate.size();
+	for (const auto& block : chunk.deltaBlocks) {
+		size += block->getMemorySize(seen);
+	}
+	return size;
+}
+
+void ReverseManager::ReverseHistory::add(unsigned seqNum, ReverseChunk&& chunk)
+{
+	// The new snapshot can take over blocks that were accounted to the
+	// next one. Always measure the current size of the blocks (iso using
+	// 'memorySize'), the compressor savings are subtracted separately.
+	auto next = chunks.upper_bound(seqNum);
+	size_t oldNextSize = (next != end(chunks)) ? calcMemorySize(next) : 0;
+
+	auto it = chunks.emplace_hint(next, seqNum, std::move(chunk));
+	auto& newChunk = it->second;
+	newChunk.memorySize = calcMemorySize(it);
+	memoryTotal += newChunk.memorySize;
+	if (next != end(chunks)) {
+		next->second.memorySize = calcMemorySize(next);
+		memoryTotal -= std::min(memoryTotal, oldNextSize);
+		memoryTotal += next->second.memorySize;
+	}
+}
+
+void ReverseManager::ReverseHistory::erase(Chunks::iterator first, Chunks::iterator last)
+{
+	// See add(), blocks that were shared with the removed snapshots are
+	// now accounted to the next snapshot.
+	size_t removed = 0;
+	for (auto it = first; it != last; ++it) {
+		removed += calcMemorySize(it);
+	}
+	if (last != end(chunks)) removed += calcMemorySize(last);
+	auto next = chunks.erase(first, last);
+	memoryTotal -= std::min(memoryTotal, removed);
+	if (next != end(chunks)) {
+		next->second.memorySize = calcMemorySize(next);
+		memoryTotal += next->second.memorySize;
+	}
+}
+
+size_t ReverseManager::ReverseHistory::getCompressorSaved() const
+{
+	auto stats = lastDeltaBlocks.getCompressorStats();
+	return stats.saved + stats.strongSaved;
+}
+
+size_t ReverseManager::ReverseHistory::getMemoryTotal() const
+{
+	auto saved = getCompressorSaved() - compressorSaved;
+	return memoryTotal - std::min(memoryTotal, saved);
+}
+
+void ReverseManager::enforceMemoryBudget()
+{
+	auto budget = size_t(memoryBudgetSetting.getInt()) * 1024 * 1024;
+	if (budget == 0) return;
+
+	auto total = history.getMemoryTotal();
+	if (total <= budget) return;
+
+	// First recompress the oldest snapshots with a stronger (but slower)
+	// codec. This happens in the background, so re-evaluate on the next
+	// snapshot. Leave the most recent snapshots alone, those should remain
+	// fast to restore. Only when that's not enough, start dropping
+	// snapshots. Though don't wait for the recompression when we're
+	// already way over budget.
+	if (total <= (budget + budget / 4)) {
+		bool pending = false;
+		auto num = history.chunks.size() / 2;
+		for (auto it = begin(history.chunks); num--; ++it) {
+			for (const auto& block : it->second.deltaBlocks) {
+				if (block->canCompressStrong()) {
+					pending = true;
+					if (!history.lastDeltaBlocks.compressStrong(block)) {
+						return; // queue full, continue next time
+					}
+				}
+			}
+		}
+		if (pending) return;
+	}
+
+	// Drop the oldest snapshots, though like dropOldSnapshots(), never
+	// the very first one (the begin of the history), and also not the
+	// one we just took.
+	while ((history.getMemoryTotal() > budget) && (history.chunks.size() > 2)) {
+		auto it = std::next(begin(history.chunks));
+		history.erase(it, std::next(it));
+	}
 }
 
 void ReverseManager::replayNextEvent()
@@ -898,7 +1056,7 @@ void ReverseManager::stopReplay(EmuTime time) noexcept
 		auto it = std::ranges::find_if(history.chunks, [&](auto& p) {
 			return p.second.time > time;
 		});
-		history.chunks.erase(it, end(history.chunks));
+		history.erase(it, end(history.chunks));
 		// this also means someone is changing history, record that
 		reRecordCount++;
 	}
@@ -926,7 +1084,9 @@ void ReverseManager::dropOldSnapshots(unsigned count)
 	while (true) {
 		y >>= 1;
 		if ((y == 0) || (count < d)) return;
-		history.chunks.erase(count - d);
+		if (auto it = history.chunks.find(count - d); it != end(history.chunks)) {
+			history.erase(it, std::next(it));
+		}
 		d += d2;
 		d2 *= 2;
 	}
@@ -24,6 +24,7 @@ namespace openmsx {
 
 class EventDelay;
 class EventDistributor;
+class IntegerSetting;
 class Interpreter;
 class MSXMotherBoard;
 class TclObject;
@@ -84,6 +85,13 @@ private:
 		// snapshot was created. So when going back replay should
 		// start at this index.
 		unsigned eventCount;
+
+		// Memory used by this snapshot. Delta blocks that are shared
+		// with older snapshots are not included. Updated when snapshots
+		// are added or removed. Blocks can still shrink afterwards
+		// (they're compressed in the background), so this may be an
+		// overestimation, see ReverseHistory::getMemoryTotal().
+		size_t memorySize = 0;
 	};
 	using Chunks = std::map<unsigned, ReverseChunk>;
 	using Events = std::deque<StateChange>;
@@ -92,10 +100,34 @@ private:
 		void swap(ReverseHistory& other) noexcept;
 		void clear();
 		[[nodiscard]] unsigned getNextSeqNum(EmuTime time) const;
+		// (Re)calculate 'ReverseChunk::memorySize' for all snapshots
+		// and 'memoryTotal' from scratch.
+		void updateMemorySizes();
+		// Add a snapshot (there may not yet be one with the same
+		// sequence number), keeps 'memoryTotal' up to date.
+		void add(unsigned seqNum, ReverseChunk&& chunk);
+		// Remove snapshots, keeps 'memoryTotal' up to date.
+		void erase(Chunks::iterator first, Chunks::iterator last);
+		// Memory currently used by all snapshots. Cheap, it doesn't
+		// visit the snapshots.
+		[[nodiscard]] size_t getMemoryTotal() const;
 
 		Chunks chunks;
 		Events events;
 		LastDeltaBlocks lastDeltaBlocks;
+		// Sum of the memory used by all snapshots, each measured when
+		// it was added (or when its predecessor changed). Minus the
+		// bytes saved by the 'lastDeltaBlocks' compressor since
+		// 'compressorSaved', this is the current total.
+		size_t memoryTotal = 0;
+		size_t compressorSaved = 0;
+
+	private:
+		// Memory used by one snapshot, with the current size of its
+		// blocks, see 'ReverseChunk::memorySize'.
+		[[nodiscard]] size_t calcMemorySize(Chunks::const_iterator it) const;
+		// Total number of bytes saved so far by the compressor.
+		[[nodiscard]] size_t getCompressorSaved() const;
 	};
 
 	void start();
@@ -121,6 +153,7 @@ private:
 	void schedule(EmuTime time);
 	void replayNextEvent();
 	template<unsigned N> void dropOldSnapshots(unsigned count);
+	void enforceMemoryBudget();
 
 	// Schedulable
 	struct SyncNewSnapshot final : Schedulable {
@@ -150,6 +183,7 @@ private:
 private:
 	MSXMotherBoard& motherBoard;
 	EventDistributor& eventDistributor;
+	IntegerSetting& memoryBudgetSetting;
 
 	struct ReverseCmd final : Command {
 		explicit ReverseCmd(CommandController& controller);
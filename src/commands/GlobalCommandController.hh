@@ -21,6 +21,7 @@
 
 namespace openmsx {
 
+class Debuggable;
 class EventDistributor;
 class Reactor;
 class GlobalCliComm;
@@ -138,6 +139,21 @@ private:
 		CliConnection& getConnection();
 	} updateCmd;
 
+	struct BinaryCmd final : Command {
+		explicit BinaryCmd(CommandController& commandController);
+		void execute(std::span<const TclObject> tokens, TclObject& result) override;
+		[[nodiscard]] std::string help(std::span<const TclObject> tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	private:
+		CliConnection& getConnection();
+		struct Block {
+			Debuggable& device;
+			unsigned address;
+			unsigned size;
+		};
+		Block getBlock(std::span<const TclObject> tokens);
+	} binaryCmd;
+
 	struct PlatformInfo final : InfoTopic {
 		explicit PlatformInfo(InfoCommand& openMSXInfoCommand);
 		void execute(std::span<const TclObject> tokens,
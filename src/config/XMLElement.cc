@@ -391,7 +391,8 @@ void XMLDocument::load(zstring_view filename, std::string_view systemID)
 	}
 }
 
-XMLElement* XMLDocument::loadElement(MemInputArchive& ar)
+template<typename Archive>
+XMLElement* XMLDocument::loadElement(Archive& ar)
 {
 	auto name = ar.loadStr();
 	if (name.empty()) return nullptr; // should only happen for empty document
@@ -430,6 +431,11 @@ void XMLDocument::serialize(MemInputArchive& ar, unsigned /*version*/)
 	root = loadElement(ar);
 }
 
+void XMLDocument::serialize(CheckedMemInputArchive& ar, unsigned /*version*/)
+{
+	root = loadElement(ar);
+}
+
 static void saveElement(MemOutputArchive& ar, const XMLElement& elem)
 {
 	ar.save(elem.getName());
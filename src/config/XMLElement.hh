@@ -339,12 +339,13 @@ public:
 	void load(const OldXMLElement& elem); // bw compat
 
 	void serialize(MemInputArchive&  ar, unsigned version);
+	void serialize(CheckedMemInputArchive& ar, unsigned version);
 	void serialize(MemOutputArchive& ar, unsigned version) const;
 	void serialize(XmlInputArchive&  ar, unsigned version);
 	void serialize(XmlOutputArchive& ar, unsigned version) const;
 
 private:
-	XMLElement* loadElement(MemInputArchive& ar);
+	template<typename Archive> XMLElement* loadElement(Archive& ar);
 	XMLElement* clone(const XMLElement& inElem);
 	XMLElement* clone(const OldXMLElement& elem);
 
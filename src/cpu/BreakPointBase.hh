@@ -2,14 +2,18 @@
 #define BREAKPOINTBASE_HH
 
 #include "CommandException.hh"
+#include "CompiledCondition.hh"
 #include "GlobalCliComm.hh"
 #include "TclObject.hh"
 
 #include "ScopedAssign.hh"
 #include "strCat.hh"
 
+#include <memory>
+
 namespace openmsx {
 
+class Debugger;
 class Interpreter;
 
 /** CRTP base class for CPU break and watch points.
@@ -26,7 +30,13 @@ public:
 	[[nodiscard]] bool isEnabled() const { return enabled; }
 	[[nodiscard]] bool onlyOnce() const { return once; }
 
-	void setCondition(const TclObject& c) { condition = c; }
+	void setCondition(const TclObject& c) {
+		condition = c;
+		// shared_ptr: breakpoints get copied quite often, see
+		// MSXCPUInterface::checkBreakPoints()
+		auto comp = CompiledCondition::compile(condition.getString());
+		compiled = comp ? std::make_shared<const CompiledCondition>(std::move(*comp)) : nullptr;
+	}
 	void setCommand(const TclObject& c) { command = c; }
 	void setEnabled(Interpreter& interp, const TclObject& e) {
 		setEnabled(e.getBoolean(interp)); // may throw
@@ -37,14 +47,14 @@ public:
 	}
 	void setOnce(bool o) { once = o; }
 
-	bool checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp) {
+	bool checkAndExecute(GlobalCliComm& cliComm, Interpreter& interp, Debugger& debugger) {
 		if (!enabled) return false;
 		if (executing) {
 			// no recursive execution
 			return false;
 		}
 		ScopedAssign sa(executing, true);
-		if (isTrue(cliComm, interp)) {
+		if (isTrue(cliComm, interp, debugger)) {
 			try {
 				command.executeCommand(interp, true); // compile command
 			} catch (CommandException& e) {
@@ -63,11 +73,15 @@ private:
 	// Note: we require GlobalCliComm here because breakpoint objects can
 	// be transferred to different MSX machines, and so the MSXCliComm
 	// object won't remain valid.
-	[[nodiscard]] bool isTrue(GlobalCliComm& cliComm, Interpreter& interp) const {
+	[[nodiscard]] bool isTrue(GlobalCliComm& cliComm, Interpreter& interp, Debugger& debugger) const {
 		if (condition.getString().empty()) {
 			// unconditional bp
 			return true;
 		}
+		if (compiled) {
+			// fast path, without Tcl
+			if (auto r = compiled->evaluate(debugger)) return *r;
+		}
 		try {
 			return condition.evalBool(interp);
 		} catch (CommandException& e) {
@@ -79,6 +93,7 @@ private:
 private:
 	TclObject command{"debug break"};
 	TclObject condition;
+	std::shared_ptr<const CompiledCondition> compiled; // nullptr if 'condition' can't be compiled
 	bool enabled = true;
 	bool once = false;
 	bool executing = false;
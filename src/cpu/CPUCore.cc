@@ -160,13 +160,16 @@
 
 #include "CPUCore.hh"
 
+#include "CodeCoverage.hh"
 #include "Dasm.hh"
+#include "InstructionTrace.hh"
 #include "MSXCPUInterface.hh"
 #include "R800.hh"
 #include "Z80.hh"
 
 #include "MSXCliComm.hh"
 #include "MSXMotherBoard.hh"
+#include "Profiler.hh"
 #include "Scheduler.hh"
 #include "TclCallback.hh"
 #include "Thread.hh"
@@ -200,7 +203,8 @@
 //
 // Probably the easiest way to enable this, is to pass the -DUSE_COMPUTED_GOTO
 // flag to the compiler. This is for example done in the super-opt flavour.
-// See build/flavour-super-opt.mk
+// See build/flavour-super-opt.mk. For meson builds, configure with
+// -Dcomputed_goto=true.
 
 #ifndef _MSC_VER
   // [[maybe_unused]] on a label is not (yet?) officially part of c++
@@ -2515,8 +2519,8 @@ template<typename T> void CPUCore<T>::execute2(bool fastForward)
 	// Note: we call scheduler _after_ executing the instruction and before
 	// deciding between executeFast() and executeSlow() (because a
 	// SyncPoint could set an IRQ and then we must choose executeSlow())
-	if (fastForward || !interface->anyBreakPoints()) {
-		// fast path, no breakpoints, no tracing
+	if (fastForward || (!interface->anyBreakPoints() && !profiler && !instructionTrace && !coverage)) {
+		// fast path, no breakpoints, no tracing, no profiling
 		do {
 			if (slowInstructions) {
 				--slowInstructions;
@@ -2538,7 +2542,25 @@ template<typename T> void CPUCore<T>::execute2(bool fastForward)
 			}
 		} while (!needExitCPULoop());
 	} else {
+		if (profiler) profiler->invalidateCache();
+		if (instructionTrace) instructionTrace->invalidateCache();
+		if (coverage) coverage->invalidateCache();
 		do {
+			// Note: 'profiler' can change while executing the
+			// instruction (e.g. from within a watchpoint callback).
+			auto* instrProfiler = profiler;
+			if (instrProfiler || instructionTrace || coverage) {
+				bool irq = (slowInstructions != 0) && (getExecIRQ() != ExecIRQ::NONE);
+				if (coverage && !irq) {
+					coverage->record(getPC());
+				}
+				if (instructionTrace) {
+					instructionTrace->record(*this, irq, T::getTimeFast());
+				}
+				if (instrProfiler) {
+					instrProfiler->beginInstruction(getPC(), getSP(), irq, T::getTimeFast());
+				}
+			}
 			if (slowInstructions == 0) {
 				assert(T::limitReached()); // only one instruction
 				executeInstructions();
@@ -2547,6 +2569,9 @@ template<typename T> void CPUCore<T>::execute2(bool fastForward)
 				--slowInstructions;
 				executeSlow(getExecIRQ());
 			}
+			if (instrProfiler && (instrProfiler == profiler)) {
+				instrProfiler->endInstruction(getPC(), getSP(), T::getTimeFast(), freq);
+			}
 			// Don't use getTimeFast() here, we need a call to
 			// CPUClock::sync() 'once in a while'. (During a
 			// reverse fast-forward this wasn't always the case).
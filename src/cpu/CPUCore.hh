@@ -18,7 +18,10 @@
 
 namespace openmsx {
 
+class CodeCoverage;
+class InstructionTrace;
 class MSXCPUInterface;
+class Profiler;
 class Scheduler;
 class MSXMotherBoard;
 class TclCallback;
@@ -59,6 +62,9 @@ public:
 	        TclCallback& diHaltCallback, EmuTime time);
 
 	void setInterface(MSXCPUInterface* interface_) { interface = interface_; }
+	void setProfiler(Profiler* profiler_) { profiler = profiler_; }
+	void setInstructionTrace(InstructionTrace* trace) { instructionTrace = trace; }
+	void setCodeCoverage(CodeCoverage* coverage_) { coverage = coverage_; }
 
 	/**
 	 * Reset the CPU.
@@ -141,6 +147,9 @@ private:
 	MSXMotherBoard& motherboard;
 	Scheduler& scheduler;
 	MSXCPUInterface* interface = nullptr;
+	Profiler* profiler = nullptr;
+	InstructionTrace* instructionTrace = nullptr;
+	CodeCoverage* coverage = nullptr;
 
 	TclCallback& diHaltCallback;
 
@@ -75,6 +75,27 @@ void MSXCPU::setInterface(MSXCPUInterface* interface_)
 	if (r800) r800->setInterface(interface);
 }
 
+void MSXCPU::setProfiler(Profiler* profiler)
+{
+	          z80 ->setProfiler(profiler);
+	if (r800) r800->setProfiler(profiler);
+	exitCPULoopSync(); // re-evaluate between fast and slow CPU loop
+}
+
+void MSXCPU::setInstructionTrace(InstructionTrace* trace)
+{
+	          z80 ->setInstructionTrace(trace);
+	if (r800) r800->setInstructionTrace(trace);
+	exitCPULoopSync(); // re-evaluate between fast and slow CPU loop
+}
+
+void MSXCPU::setCodeCoverage(CodeCoverage* coverage)
+{
+	          z80 ->setCodeCoverage(coverage);
+	if (r800) r800->setCodeCoverage(coverage);
+	exitCPULoopSync(); // re-evaluate between fast and slow CPU loop
+}
+
 void MSXCPU::doReset(EmuTime time)
 {
 	          z80 ->doReset(time);
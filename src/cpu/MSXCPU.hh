@@ -19,7 +19,10 @@
 namespace openmsx {
 
 class MSXMotherBoard;
+class CodeCoverage;
+class InstructionTrace;
 class MSXCPUInterface;
+class Profiler;
 class CPUClock;
 class CPURegs;
 class Z80TYPE;
@@ -137,6 +140,18 @@ public:
 
 	void setInterface(MSXCPUInterface* interface);
 
+	/** Report each executed instruction to the given profiler (or stop
+	  * reporting when nullptr). See Profiler. */
+	void setProfiler(Profiler* profiler);
+
+	/** Record each executed instruction in the given trace (or stop
+	  * recording when nullptr). See InstructionTrace. */
+	void setInstructionTrace(InstructionTrace* trace);
+
+	/** Mark each executed instruction in the given coverage collector (or
+	  * stop collecting when nullptr). See CodeCoverage. */
+	void setCodeCoverage(CodeCoverage* coverage);
+
 	/** (un)pause CPU. During pause the CPU executes NOP instructions
 	  * continuously (just like during HALT). Used by turbor hw pause. */
 	void setPaused(bool paused);
@@ -225,7 +225,7 @@ void MSXCPUInterface::writeMemSlow(uint16_t address, uint8_t value, EmuTime time
 		visibleDevices[address>>14]->writeMem(address, value, time);
 	}
 	// something special in this region?
-	if (disallowWriteCache[address >> CacheLine::BITS]) [[unlikely]] {
+	if (auto disallow = disallowWriteCache[address >> CacheLine::BITS]) [[unlikely]] {
 		// slot-select-ignore writes (Super Lode Runner)
 		for (auto& g : globalWrites) {
 			// very primitive address selection mechanism,
@@ -239,10 +239,16 @@ void MSXCPUInterface::writeMemSlow(uint16_t address, uint8_t value, EmuTime time
 		// But first advance time for the tiniest amount, this makes
 		// sure that later on a possible replay we also replay recorded
 		// commands after the actual memory write (e.g. this matters
-		// when that command is also a memory write)
-		motherBoard.getScheduler().schedule(time + EmuDuration::epsilon());
-		if (writeWatchSet[address >> CacheLine::BITS]
-		                 [address &  CacheLine::LOW]) {
+		// when that command is also a memory write). When watchpoints
+		// are the only reason this cache line is not cached, this is
+		// only done for the watched addresses, so that writes to the
+		// other addresses in the same cache line remain cheap.
+		bool watched = writeWatchSet[address >> CacheLine::BITS]
+		                            [address &  CacheLine::LOW];
+		if (watched || (disallow != MEMORY_WATCH_BIT)) {
+			motherBoard.getScheduler().schedule(time + EmuDuration::epsilon());
+		}
+		if (watched) {
 			executeMemWatch(WatchPoint::Type::WRITE_MEM, address, value);
 		}
 	}
@@ -870,12 +876,14 @@ void MSXCPUInterface::insertBreakPoint(BreakPoint bp)
 {
 	cliComm.update(CliComm::UpdateType::DEBUG_UPDT, bp.getIdStr(), "add");
 	breakPoints.push_back(std::move(bp));
+	breakPointAddrsDirty = true;
 }
 
 void MSXCPUInterface::removeBreakPoint(const BreakPoint& bp)
 {
 	cliComm.update(CliComm::UpdateType::DEBUG_UPDT, bp.getIdStr(), "remove");
 	breakPoints.erase(find_unguarded(breakPoints, &bp, [](const BreakPoint& i) { return &i; }));
+	breakPointAddrsDirty = true;
 }
 void MSXCPUInterface::removeBreakPoint(unsigned id)
 {
@@ -884,11 +892,30 @@ void MSXCPUInterface::removeBreakPoint(unsigned id)
 	    it != breakPoints.end()) {
 		cliComm.update(CliComm::UpdateType::DEBUG_UPDT, it->getIdStr(), "remove");
 		breakPoints.erase(it);
+		breakPointAddrsDirty = true;
+	}
+}
+
+void MSXCPUInterface::updateBreakPointAddrs()
+{
+	breakPointAddrs.reset();
+	for (const auto& bp : breakPoints) {
+		if (auto addr = bp.getAddress()) breakPointAddrs.set(*addr);
 	}
+	breakPointAddrsDirty = false;
 }
 
 bool MSXCPUInterface::checkBreakPoints(unsigned pc)
 {
+	// Fast path: this is called after every instruction (as long as there
+	// are breakpoints or conditions), and usually there's nothing to do.
+	assert(pc < 0x10000);
+	if (breakPointAddrsDirty) updateBreakPointAddrs();
+	if (!breakPointAddrs[pc] &&
+	    std::ranges::none_of(conditions, &DebugCondition::isEnabled)) {
+		return false;
+	}
+
 	// create copy for the case that breakpoint/condition removes itself
 	//  - avoids iterating over a changing collection
 	std::vector<BreakPoint> bpCopy;
@@ -903,15 +930,16 @@ bool MSXCPUInterface::checkBreakPoints(unsigned pc)
 
 	auto& globalCliComm = motherBoard.getReactor().getGlobalCliComm();
 	auto& interp        = motherBoard.getReactor().getInterpreter();
+	auto& debugger      = motherBoard.getDebugger();
 	auto scopedBlock = motherBoard.getStateChangeDistributor().tempBlockNewEventsDuringReplay();
 	for (auto& p : bpCopy) {
-		bool remove = p.checkAndExecute(globalCliComm, interp);
+		bool remove = p.checkAndExecute(globalCliComm, interp, debugger);
 		if (remove) {
 			removeBreakPoint(p.getId());
 		}
 	}
 	for (auto& c : condCopy) {
-		bool remove = c.checkAndExecute(globalCliComm, interp);
+		bool remove = c.checkAndExecute(globalCliComm, interp, debugger);
 		if (remove) {
 			removeCondition(c.getId());
 		}
@@ -1013,8 +1041,11 @@ void MSXCPUInterface::removeCondition(unsigned id)
 
 void MSXCPUInterface::updateMemWatch(WatchPoint::Type type)
 {
+	bool read = type == WatchPoint::Type::READ_MEM;
 	std::span<std::bitset<CacheLine::SIZE>, CacheLine::NUM> watchSet =
-		(type == WatchPoint::Type::READ_MEM) ? readWatchSet : writeWatchSet;
+		read ? readWatchSet : writeWatchSet;
+	std::span<uint8_t, CacheLine::NUM> disallowCache =
+		read ? disallowReadCache : disallowWriteCache;
 	for (auto i : xrange(CacheLine::NUM)) {
 		watchSet[i].reset();
 	}
@@ -1030,19 +1061,21 @@ void MSXCPUInterface::updateMemWatch(WatchPoint::Type type)
 			}
 		}
 	}
+	// Only the cache lines that contain a watched address go through the
+	// slow path (where the exact address is checked against 'watchSet').
+	// Only invalidate the lines for which that changed, all other lines
+	// remain cached.
 	for (auto i : xrange(CacheLine::NUM)) {
-		if (readWatchSet [i].any()) {
-			disallowReadCache [i] |=  MEMORY_WATCH_BIT;
-		} else {
-			disallowReadCache [i] &= ~MEMORY_WATCH_BIT;
-		}
-		if (writeWatchSet[i].any()) {
-			disallowWriteCache[i] |=  MEMORY_WATCH_BIT;
+		bool watched = watchSet[i].any();
+		bool wasWatched = (disallowCache[i] & MEMORY_WATCH_BIT) != 0;
+		if (watched == wasWatched) continue;
+		if (watched) {
+			disallowCache[i] |=  MEMORY_WATCH_BIT;
 		} else {
-			disallowWriteCache[i] &= ~MEMORY_WATCH_BIT;
+			disallowCache[i] &= ~MEMORY_WATCH_BIT;
 		}
+		msxcpu.invalidateAllSlotsRWCache(narrow<uint16_t>(i << CacheLine::BITS), CacheLine::SIZE);
 	}
-	msxcpu.invalidateAllSlotsRWCache(0x0000, 0x10000);
 }
 
 void MSXCPUInterface::executeMemWatch(WatchPoint::Type type,
@@ -1065,7 +1098,7 @@ void MSXCPUInterface::executeMemWatch(WatchPoint::Type type,
 		if ((w->getBeginAddress() <= address) &&
 		    (w->getEndAddress()   >= address) &&
 		    (w->getType()         == type)) {
-			bool remove = w->checkAndExecute(globalCliComm, interp);
+			bool remove = w->checkAndExecute(globalCliComm, interp, motherBoard.getDebugger());
 			if (remove) {
 				removeWatchPoint(w);
 			}
@@ -1124,6 +1157,7 @@ void MSXCPUInterface::cleanup()
 	// TODO it would be nicer if breakpoints and conditions were not
 	//      global objects.
 	breakPoints.clear();
+	breakPointAddrsDirty = true;
 	conditions.clear();
 }
 
@@ -264,7 +264,11 @@ public:
 	void removeBreakPoint(const BreakPoint& bp);
 	void removeBreakPoint(unsigned id);
 	using BreakPoints = std::vector<BreakPoint>;
-	[[nodiscard]] static BreakPoints& getBreakPoints() { return breakPoints; }
+	[[nodiscard]] static BreakPoints& getBreakPoints() {
+		// caller may modify the breakpoints (e.g. change the address)
+		breakPointAddrsDirty = true;
+		return breakPoints;
+	}
 
 	void setWatchPoint(const std::shared_ptr<WatchPoint>& watchPoint);
 	void removeWatchPoint(std::shared_ptr<WatchPoint> watchPoint);
@@ -331,6 +335,8 @@ public:
 	void serialize(Archive& ar, unsigned version);
 
 private:
+	static void updateBreakPointAddrs();
+
 	uint8_t readMemSlow(uint16_t address, EmuTime time);
 	void writeMemSlow(uint16_t address, uint8_t value, EmuTime time);
 
@@ -460,6 +466,10 @@ private:
 
 	//  All CPUs (Z80 and R800) of all MSX machines share this state.
 	static inline BreakPoints breakPoints; // unsorted
+	// Addresses that (possibly) have a breakpoint. Lazily recalculated
+	// from 'breakPoints' after each (possible) change.
+	static inline std::bitset<0x10000> breakPointAddrs;
+	static inline bool breakPointAddrsDirty = false;
 	WatchPoints watchPoints; // ordered in creation order,  TODO must also be static
 	static inline Conditions conditions; // ordered in creation order
 	static inline bool breaked = false;
@@ -0,0 +1,198 @@
+#include "CodeCoverage.hh"
+
+#include "Debugger.hh"
+
+#include "CommandException.hh"
+#include "File.hh"
+#include "FileContext.hh"
+#include "FileOperations.hh"
+#include "MSXCPU.hh"
+#include "MSXException.hh"
+#include "TclObject.hh"
+
+#include <cassert>
+#include <fstream>
+#include <utility>
+
+using namespace std::literals;
+
+namespace openmsx {
+
+CodeCoverage::CodeCoverage(Debugger& debugger_)
+	: debugger(debugger_)
+	, locator(debugger_)
+{
+}
+
+CodeCoverage::~CodeCoverage()
+{
+	stop();
+}
+
+void CodeCoverage::start()
+{
+	if (active) return;
+	active = true;
+	locator.invalidate();
+	if (auto* cpu = debugger.cpu) {
+		cpu->setCodeCoverage(this);
+	}
+}
+
+void CodeCoverage::stop()
+{
+	if (!active) return;
+	active = false;
+	if (auto* cpu = debugger.cpu) {
+		cpu->setCodeCoverage(nullptr);
+	}
+}
+
+void CodeCoverage::transfer(CodeCoverage& other)
+{
+	coverage = std::move(other.coverage);
+	other.coverage.clear();
+
+	if (other.active) {
+		other.stop();
+		start();
+	}
+}
+
+void CodeCoverage::save(zstring_view filename) const
+{
+	std::ofstream os;
+	FileOperations::openOfStream(os, filename);
+	if (!os) throw MSXException("Cannot open file for writing: ", filename);
+	coverage.save(os);
+}
+
+void CodeCoverage::merge(zstring_view filename)
+{
+	auto buf = File(filename).mmap<const char>();
+	coverage.merge(std::string_view(buf.data(), buf.size()));
+}
+
+void CodeCoverage::execute(std::span<const TclObject> tokens, TclObject& result)
+{
+	auto& cmd = debugger.cmd;
+	cmd.checkNumArgs(tokens, Completer::AtLeast{3}, "subcommand ?arg ...?");
+	auto fileCommand = [&](auto action) {
+		cmd.checkNumArgs(tokens, 4, "filename");
+		try {
+			action(FileOperations::expandTilde(std::string(tokens[3].getString())));
+		} catch (MSXException& e) {
+			throw CommandException(e.getMessage());
+		}
+	};
+	cmd.executeSubCommand(tokens[2].getString(),
+		"start", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			start();
+		},
+		"stop", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			stop();
+		},
+		"clear", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			clear();
+		},
+		"status", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			result.addDictKeyValues("active", active,
+			                        "regions", coverage.numRegions(),
+			                        "instructions", coverage.count());
+		},
+		"save", [&]{
+			fileCommand([&](const std::string& filename) { save(filename); });
+		},
+		"merge", [&]{
+			fileCommand([&](const std::string& filename) { merge(filename); });
+		});
+}
+
+void CodeCoverage::tabCompletion(std::vector<std::string>& tokens) const
+{
+	static constexpr std::array cmds = {
+		"start"sv, "stop"sv, "clear"sv, "status"sv, "save"sv, "merge"sv,
+	};
+	auto& cmd = debugger.cmd;
+	if (tokens.size() == 3) {
+		cmd.completeString(tokens, cmds);
+	} else if ((tokens.size() == 4) && ((tokens[2] == "save") || (tokens[2] == "merge"))) {
+		cmd.completeFileName(tokens, userFileContext());
+	}
+}
+
+std::string CodeCoverage::help(std::span<const TclObject> tokens) const
+{
+	constexpr auto generalHelp =
+		"debug coverage <subcommand> [<arguments>]\n"
+		"  Collects which instructions are executed by the emulated CPU, separately\n"
+		"  for each slot and memory mapper or ROM mapper segment.\n"
+		"  Possible subcommands are:\n"
+		"    start   start collecting coverage data\n"
+		"    stop    stop collecting, the collected data is kept\n"
+		"    clear   discard all collected data\n"
+		"    status  returns a dict with info about the collected data\n"
+		"    save    write the collected data to a file\n"
+		"    merge   add the data from a previously saved file\n"
+		"  Type 'help debug coverage <subcommand>' for help about a specific subcommand.\n";
+
+	constexpr auto startHelp =
+		"debug coverage start\n"
+		"  Start collecting coverage data. For each executed instruction, its address\n"
+		"  together with the selected slot and segment is marked.\n"
+		"  Note: just like with breakpoints, emulation runs slower while collecting.\n";
+
+	constexpr auto stopHelp =
+		"debug coverage stop\n"
+		"  Stop collecting. The data collected so far is kept.\n";
+
+	constexpr auto clearHelp =
+		"debug coverage clear\n"
+		"  Discard all collected data.\n";
+
+	constexpr auto statusHelp =
+		"debug coverage status\n"
+		"  Returns a dict with the keys 'active' (is collecting active), 'regions'\n"
+		"  (the number of slot/segment combinations that contain executed code) and\n"
+		"  'instructions' (the number of distinct executed instruction addresses).\n";
+
+	constexpr auto saveHelp =
+		"debug coverage save <filename>\n"
+		"  Write the collected data in the lcov tracefile format. Each slot/segment\n"
+		"  combination is written as a source file (e.g. 'SF:1-2 segment 3') and the\n"
+		"  addresses (in decimal) of the executed instructions as its lines.\n";
+
+	constexpr auto mergeHelp =
+		"debug coverage merge <filename>\n"
+		"  Add the data from a file written by 'debug coverage save' to the collected\n"
+		"  data. E.g. to combine the coverage of several sessions.\n";
+
+	constexpr auto unknownHelp =
+		"Unknown subcommand, use 'help debug coverage' to see a list of valid subcommands.\n";
+
+	auto size = tokens.size();
+	assert(size >= 2);
+	if (size == 2) {
+		return generalHelp;
+	} else if (tokens[2] == "start") {
+		return startHelp;
+	} else if (tokens[2] == "stop") {
+		return stopHelp;
+	} else if (tokens[2] == "clear") {
+		return clearHelp;
+	} else if (tokens[2] == "status") {
+		return statusHelp;
+	} else if (tokens[2] == "save") {
+		return saveHelp;
+	} else if (tokens[2] == "merge") {
+		return mergeHelp;
+	} else {
+		return unknownHelp;
+	}
+}
+
+} // namespace openmsx
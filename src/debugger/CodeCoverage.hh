@@ -0,0 +1,68 @@
+#ifndef CODECOVERAGE_HH
+#define CODECOVERAGE_HH
+
+#include "CodeLocator.hh"
+#include "CoverageMap.hh"
+
+#include "zstring_view.hh"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class Debugger;
+class TclObject;
+
+/** Collects which instructions are executed by the emulated Z80/R800, per
+  * slot and memory/ROM mapper segment (see CoverageMap).
+  *
+  * Just like the Profiler, this hooks into the slower instruction-by-
+  * instruction CPU loop, so it has no overhead when not active.
+  */
+class CodeCoverage
+{
+public:
+	explicit CodeCoverage(Debugger& debugger);
+	CodeCoverage(const CodeCoverage&) = delete;
+	CodeCoverage(CodeCoverage&&) = delete;
+	CodeCoverage& operator=(const CodeCoverage&) = delete;
+	CodeCoverage& operator=(CodeCoverage&&) = delete;
+	~CodeCoverage();
+
+	void execute(std::span<const TclObject> tokens, TclObject& result);
+	[[nodiscard]] std::string help(std::span<const TclObject> tokens) const;
+	void tabCompletion(std::vector<std::string>& tokens) const;
+
+	void start();
+	void stop();
+	void clear() { coverage.clear(); }
+	[[nodiscard]] bool isActive() const { return active; }
+
+	/** Take over the collected coverage (and the active state) of another
+	  * machine, see Debugger::transfer(). */
+	void transfer(CodeCoverage& other);
+
+	[[nodiscard]] const CoverageMap& getCoverage() const { return coverage; }
+
+	// Called from CPUCore right before each instruction (only while active).
+	void record(uint16_t pc) { coverage.mark(locator.get(pc)); }
+	// Called from CPUCore at the start of each execution slice.
+	void invalidateCache() { locator.invalidate(); }
+
+private:
+	void save(zstring_view filename) const;
+	void merge(zstring_view filename);
+
+private:
+	Debugger& debugger;
+	CodeLocator locator;
+	CoverageMap coverage;
+	bool active = false;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,101 @@
+#include "CodeLocator.hh"
+
+#include "Debugger.hh"
+#include "SymbolManager.hh"
+
+#include "MSXCPUInterface.hh"
+#include "MSXMemoryMapperBase.hh"
+#include "MSXMotherBoard.hh"
+#include "MSXRom.hh"
+#include "RomBlockDebuggable.hh"
+#include "RomPlain.hh"
+
+#include "StringOp.hh"
+#include "strCat.hh"
+
+namespace openmsx {
+
+CodeLocator::Location CodeLocator::get(uint16_t addr)
+{
+	auto& interface = debugger.getMotherBoard().getCPUInterface();
+	int page = addr >> 14;
+	auto ps = interface.getPrimarySlot(page);
+	Location result = addr | (Location(ps) << 16);
+	if (interface.isExpanded(ps)) {
+		result |= (Location(interface.getSecondarySlot(page)) << 18) | (Location(1) << 20);
+	}
+
+	const auto* device = interface.getVisibleMSXDevice(page);
+	auto& cache = pageCache[page];
+	if (cache.device != device) {
+		cache.device = device;
+		cache.mapper = dynamic_cast<const MSXMemoryMapperBase*>(device);
+		cache.romBlocks = nullptr;
+		const auto* rom = dynamic_cast<const MSXRom*>(device);
+		if (rom && !dynamic_cast<const RomPlain*>(rom)) {
+			if (auto* debug8 = dynamic_cast<RomBlockDebuggableBase::Debuggable8*>(
+				debugger.findDebuggable(tmpStrCat(rom->getName(), " romblocks")))) {
+				cache.romBlocks = &debug8->getRomBlocks();
+			}
+		}
+	}
+	if (cache.mapper) {
+		result |= Location(cache.mapper->getSelectedSegment(uint8_t(page)) + 1) << 21;
+	} else if (cache.romBlocks) {
+		result |= ((Location(cache.romBlocks->readExt(addr)) + 1) & 0x1FFFF) << 21;
+	}
+	return result;
+}
+
+std::string CodeLocator::slotToString(Location loc)
+{
+	auto segment = getSegment(loc);
+	return strCat(getPrimarySlot(loc),
+	              strCat_if(isExpanded(loc), '-', STRCAT_LAZY(getSecondarySlot(loc))),
+	              strCat_if(segment, " segment ", STRCAT_LAZY(*segment)));
+}
+
+std::optional<CodeLocator::Location> CodeLocator::parseSlot(std::string_view str)
+{
+	auto [slot, rest] = StringOp::splitOnFirst(str, ' ');
+	auto [psStr, ssStr] = StringOp::splitOnFirst(slot, '-');
+	auto ps = StringOp::stringToBase<10, unsigned>(psStr);
+	if (!ps || (*ps > 3)) return {};
+	Location result = Location(*ps) << 16;
+	if (!ssStr.empty()) {
+		auto ss = StringOp::stringToBase<10, unsigned>(ssStr);
+		if (!ss || (*ss > 3)) return {};
+		result |= (Location(*ss) << 18) | (Location(1) << 20);
+	}
+	if (!rest.empty()) {
+		auto [keyword, segStr] = StringOp::splitOnFirst(rest, ' ');
+		if (keyword != "segment") return {};
+		auto seg = StringOp::stringToBase<10, unsigned>(segStr);
+		if (!seg || (*seg >= 0x1FFFF)) return {};
+		result |= Location(*seg + 1) << 21;
+	}
+	return result;
+}
+
+const std::string* CodeLocator::findSymbol(SymbolManager& symbols, Location loc)
+{
+	auto psSs = uint8_t((getSecondarySlot(loc) << 2) | getPrimarySlot(loc));
+	auto segment = getSegment(loc);
+	const Symbol* best = nullptr;
+	int bestPrio = -1;
+	for (const Symbol* symbol : symbols.lookupValue(getAddress(loc))) {
+		// skip symbols with any mismatch
+		if (symbol->slot && *symbol->slot != psSs) continue;
+		if (symbol->segment && symbol->segment != segment) continue;
+		int prio = (symbol->slot && symbol->segment == segment) ? 2
+		         : (!symbol->slot && !symbol->segment)         ? 0
+		                                                       : 1;
+		if (prio > bestPrio) {
+			best = symbol;
+			bestPrio = prio;
+		}
+	}
+	return best ? &best->name : nullptr;
+}
+
+} // namespace openmsx
@@ -0,0 +1,76 @@
+#ifndef CODELOCATOR_HH
+#define CODELOCATOR_HH
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace openmsx {
+
+class Debugger;
+class MSXDevice;
+class MSXMemoryMapperBase;
+class RomBlockDebuggableBase;
+class SymbolManager;
+
+/** Combines a CPU address with the currently selected slot and (if
+  * applicable) memory mapper or ROM mapper segment. The result is packed in
+  * one integer:
+  *   bits  0-15: address
+  *   bits 16-17: primary slot
+  *   bits 18-19: secondary slot
+  *   bit     20: slot is expanded
+  *   bits 21-37: segment + 1 (0 means no segment)
+  *
+  * Looking up the ROM mapper of a device is relatively expensive, so this is
+  * cached per page. The cache must be invalidated when devices can have been
+  * removed (typically at the start of each CPU execution slice).
+  */
+class CodeLocator
+{
+public:
+	using Location = uint64_t;
+	static constexpr unsigned BITS = 38;
+
+	explicit CodeLocator(Debugger& debugger_) : debugger(debugger_) {}
+
+	[[nodiscard]] Location get(uint16_t addr);
+	void invalidate() { pageCache.fill({}); }
+
+	[[nodiscard]] static uint16_t getAddress(Location loc) { return uint16_t(loc); }
+	[[nodiscard]] static unsigned getPrimarySlot(Location loc) { return unsigned(loc >> 16) & 3; }
+	[[nodiscard]] static unsigned getSecondarySlot(Location loc) { return unsigned(loc >> 18) & 3; }
+	[[nodiscard]] static bool isExpanded(Location loc) { return (loc >> 20) & 1; }
+	[[nodiscard]] static std::optional<uint16_t> getSegment(Location loc) {
+		auto seg = unsigned(loc >> 21);
+		if (seg == 0) return {};
+		return uint16_t(seg - 1);
+	}
+
+	/** E.g. "1-2" or "1-2 segment 3". */
+	[[nodiscard]] static std::string slotToString(Location loc);
+	/** The inverse of slotToString(), the address part of the result is
+	  * zero. Returns nullopt when the string cannot be parsed. */
+	[[nodiscard]] static std::optional<Location> parseSlot(std::string_view str);
+
+	/** Find the best matching symbol for this location: same priorities
+	  * as in the disassembly view, prefer symbols that match both slot and
+	  * segment. Returns nullptr if there's no match. */
+	[[nodiscard]] static const std::string* findSymbol(SymbolManager& symbols, Location loc);
+
+private:
+	struct PageCache {
+		const MSXDevice* device = nullptr;
+		const MSXMemoryMapperBase* mapper = nullptr;
+		RomBlockDebuggableBase* romBlocks = nullptr;
+	};
+
+	Debugger& debugger;
+	std::array<PageCache, 4> pageCache;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,481 @@
+#include "CompiledCondition.hh"
+
+#include "Debuggable.hh"
+#include "Debugger.hh"
+
+#include "StringOp.hh"
+#include "narrow.hh"
+#include "stl.hh"
+#include "unreachable.hh"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <initializer_list>
+#include <limits>
+#include <tuple>
+#include <utility>
+
+namespace openmsx {
+
+// Same register names and indices as in the 'reg' proc (_cpuregs.tcl).
+using RegName = std::pair<std::string_view, uint8_t>;
+static constexpr auto byteRegs = std::to_array<RegName>({
+	{"A",    0}, {"F",    1}, {"B",    2}, {"C",    3},
+	{"D",    4}, {"E",    5}, {"H",    6}, {"L",    7},
+	{"A2",   8}, {"F2",   9}, {"B2",  10}, {"C2",  11},
+	{"D2",  12}, {"E2",  13}, {"H2",  14}, {"L2",  15},
+	{"IXH", 16}, {"IXL", 17}, {"IYH", 18}, {"IYL", 19},
+	{"PCH", 20}, {"PCL", 21}, {"SPH", 22}, {"SPL", 23},
+	{"I",   24}, {"R",   25}, {"IM",  26}, {"IFF", 27},
+});
+static constexpr auto wordRegs = std::to_array<RegName>({
+	{"AF",   0}, {"BC",   2}, {"DE",   4}, {"HL",   6},
+	{"AF2",  8}, {"BC2", 10}, {"DE2", 12}, {"HL2", 14},
+	{"IX",  16}, {"IY",  18}, {"PC",  20}, {"SP",  22},
+});
+static constexpr unsigned NUM_REGS = 28; // size of the 'CPU regs' debuggable
+
+[[nodiscard]] static constexpr bool isSpace(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+[[nodiscard]] static constexpr bool isWordChar(char c)
+{
+	return ((c >= '0') && (c <= '9')) ||
+	       ((c >= 'a') && (c <= 'z')) ||
+	       ((c >= 'A') && (c <= 'Z')) ||
+	       (c == '_') || (c == '.');
+}
+
+class CompiledCondition::Parser
+{
+public:
+	explicit Parser(std::string_view expr_) : expr(expr_) {}
+
+	[[nodiscard]] std::optional<CompiledCondition> parse()
+	{
+		if (!parseTernary()) return {};
+		skipSpace();
+		if (!expr.empty()) return {}; // trailing garbage
+		assert(depth == 1);
+		return std::move(result);
+	}
+
+private:
+	void skipSpace()
+	{
+		while (!expr.empty() && isSpace(expr.front())) expr.remove_prefix(1);
+	}
+
+	// Consume the given operator. Fails if the operator is followed by one
+	// of the characters in 'notFollowedBy' (e.g. to distinguish '<' from
+	// '<<' or '<=').
+	[[nodiscard]] bool consume(std::string_view op, std::string_view notFollowedBy = {})
+	{
+		skipSpace();
+		if (!expr.starts_with(op)) return false;
+		if ((expr.size() > op.size()) &&
+		    contains(notFollowedBy, expr[op.size()])) {
+			return false;
+		}
+		expr.remove_prefix(op.size());
+		return true;
+	}
+
+	[[nodiscard]] std::string_view bareWord()
+	{
+		skipSpace();
+		size_t n = 0;
+		while ((n < expr.size()) && isWordChar(expr[n])) ++n;
+		auto word = expr.substr(0, n);
+		expr.remove_prefix(n);
+		return word;
+	}
+
+	// A word that's possibly enclosed in braces or double quotes (without
+	// any substitutions).
+	[[nodiscard]] std::optional<std::string_view> literalWord()
+	{
+		skipSpace();
+		if (expr.empty()) return {};
+		char close = (expr.front() == '{') ? '}'
+		           : (expr.front() == '"') ? '"'
+		           : 0;
+		if (!close) return bareWord();
+		auto end = expr.find(close, 1);
+		if (end == std::string_view::npos) return {};
+		auto word = expr.substr(1, end - 1);
+		if (word.find_first_of("{}[]$\\\"") != std::string_view::npos) return {};
+		expr.remove_prefix(end + 1);
+		return word;
+	}
+
+	// Tcl (8.6) integer syntax. Numbers with a leading zero are rejected,
+	// depending on the Tcl version these are interpreted as octal or as
+	// decimal.
+	[[nodiscard]] static std::optional<int64_t> parseInteger(std::string_view str)
+	{
+		if (str.size() > 2 && str[0] == '0') {
+			auto rest = str.substr(2);
+			switch (str[1]) {
+			case 'x': case 'X': return StringOp::stringToBase<16, int64_t>(rest);
+			case 'b': case 'B': return StringOp::stringToBase< 2, int64_t>(rest);
+			case 'o': case 'O': return StringOp::stringToBase< 8, int64_t>(rest);
+			default: return {};
+			}
+		}
+		if (str.size() > 1 && str[0] == '0') return {};
+		return StringOp::stringToBase<10, int64_t>(str);
+	}
+
+	void emit(Op op, int64_t arg = 0)
+	{
+		result.code.push_back({op, arg});
+	}
+	[[nodiscard]] bool push(Op op, int64_t arg = 0)
+	{
+		emit(op, arg);
+		++depth;
+		return depth <= STACK_SIZE;
+	}
+	void pop(Op op)
+	{
+		emit(op);
+		assert(depth > 0);
+		--depth;
+	}
+	[[nodiscard]] size_t emitJump(Op op)
+	{
+		emit(op);
+		return result.code.size() - 1;
+	}
+	void patchJump(size_t idx)
+	{
+		result.code[idx].arg = narrow<int64_t>(result.code.size());
+	}
+
+	// Command argument: an integer literal or a nested command.
+	[[nodiscard]] bool parseArgument()
+	{
+		skipSpace();
+		if (consume("[")) return parseCommand();
+		auto value = parseInteger(bareWord());
+		return value && push(Op::PUSH, *value);
+	}
+
+	// Called after the opening '['.
+	[[nodiscard]] bool parseCommand()
+	{
+		auto cmd = bareWord();
+		if (cmd == "reg") {
+			auto name = bareWord();
+			auto sameName = [&](const RegName& r) { return StringOp::casecmp{}(r.first, name); };
+			if (auto it = std::ranges::find_if(byteRegs, sameName); it != byteRegs.end()) {
+				if (!push(Op::REG8, it->second)) return false;
+			} else if (auto it2 = std::ranges::find_if(wordRegs, sameName); it2 != wordRegs.end()) {
+				if (!push(Op::REG16, it2->second)) return false;
+			} else {
+				return false;
+			}
+			result.usesRegs = true;
+		} else if ((cmd == "peek") || (cmd == "peek8") || (cmd == "peek_u8")) {
+			if (!parseArgument()) return false;
+			emit(Op::MEM);
+			result.usesMemory = true;
+		} else if ((cmd == "peek16") || (cmd == "peek_u16")) {
+			if (!parseArgument()) return false;
+			emit(Op::MEM16);
+			result.usesMemory = true;
+		} else if (cmd == "debug") {
+			if (bareWord() != "read") return false;
+			auto name = literalWord();
+			if (!name) return false;
+			if (*name == "memory") {
+				if (!parseArgument()) return false;
+				emit(Op::MEM);
+				result.usesMemory = true;
+			} else if (*name == "CPU regs") {
+				auto index = parseInteger(bareWord());
+				if (!index || (*index < 0) || (*index >= NUM_REGS)) return false;
+				if (!push(Op::REG8, *index)) return false;
+				result.usesRegs = true;
+			} else {
+				return false;
+			}
+		} else {
+			return false;
+		}
+		return consume("]");
+	}
+
+	[[nodiscard]] bool parsePrimary()
+	{
+		skipSpace();
+		if (consume("(")) {
+			return parseTernary() && consume(")");
+		}
+		if (consume("[")) {
+			return parseCommand();
+		}
+		auto value = parseInteger(bareWord());
+		return value && push(Op::PUSH, *value);
+	}
+
+	[[nodiscard]] bool parseUnary()
+	{
+		auto unary = [&](Op op) {
+			if (!parseUnary()) return false;
+			emit(op);
+			return true;
+		};
+		if (consume("-")) return unary(Op::NEG);
+		if (consume("+")) return parseUnary();
+		if (consume("!")) return unary(Op::NOT);
+		if (consume("~")) return unary(Op::INV);
+		return parsePrimary();
+	}
+
+	// Parse a left-associative chain of binary operators.
+	using BinOp = std::tuple<std::string_view, std::string_view, Op>; // operator, not-followed-by, opcode
+	template<typename SubExpr>
+	[[nodiscard]] bool parseBinary(SubExpr subExpr, std::initializer_list<BinOp> ops)
+	{
+		if (!subExpr()) return false;
+		while (true) {
+			auto it = std::ranges::find_if(ops, [&](const auto& o) {
+				return consume(std::get<0>(o), std::get<1>(o));
+			});
+			if (it == ops.end()) return true;
+			if (!subExpr()) return false;
+			pop(std::get<2>(*it));
+		}
+	}
+
+	[[nodiscard]] bool parseMul()
+	{
+		return parseBinary([&] { return parseUnary(); }, {
+			{"*", "*", Op::MUL}, {"/", "", Op::DIV}, {"%", "", Op::MOD}});
+	}
+	[[nodiscard]] bool parseAdd()
+	{
+		return parseBinary([&] { return parseMul(); }, {
+			{"+", "", Op::ADD}, {"-", "", Op::SUB}});
+	}
+	[[nodiscard]] bool parseShift()
+	{
+		return parseBinary([&] { return parseAdd(); }, {
+			{"<<", "", Op::SHL}, {">>", "", Op::SHR}});
+	}
+	[[nodiscard]] bool parseRelational()
+	{
+		return parseBinary([&] { return parseShift(); }, {
+			{"<=", "", Op::LE}, {">=", "", Op::GE},
+			{"<", "<", Op::LT}, {">", ">", Op::GT}});
+	}
+	[[nodiscard]] bool parseEquality()
+	{
+		return parseBinary([&] { return parseRelational(); }, {
+			{"==", "", Op::EQ}, {"!=", "", Op::NE}});
+	}
+	[[nodiscard]] bool parseBitAnd()
+	{
+		return parseBinary([&] { return parseEquality(); }, {
+			{"&", "&", Op::BIT_AND}});
+	}
+	[[nodiscard]] bool parseBitXor()
+	{
+		return parseBinary([&] { return parseBitAnd(); }, {
+			{"^", "", Op::BIT_XOR}});
+	}
+	[[nodiscard]] bool parseBitOr()
+	{
+		return parseBinary([&] { return parseBitXor(); }, {
+			{"|", "|", Op::BIT_OR}});
+	}
+
+	// Short-circuit evaluation, just like Tcl. Code for 'a && b':
+	//        <a>
+	//        JUMP_IF_FALSE L1
+	//        <b>
+	//        BOOL
+	//        JUMP L2
+	//   L1:  PUSH 0
+	//   L2:
+	template<typename SubExpr>
+	[[nodiscard]] bool parseLogical(SubExpr subExpr, std::string_view op, Op jumpOp, int64_t shortCircuitValue)
+	{
+		if (!subExpr()) return false;
+		while (consume(op)) {
+			auto j1 = emitJump(jumpOp);
+			--depth;
+			if (!subExpr()) return false;
+			emit(Op::BOOL);
+			auto j2 = emitJump(Op::JUMP);
+			patchJump(j1);
+			emit(Op::PUSH, shortCircuitValue); // depth already accounted for
+			patchJump(j2);
+		}
+		return true;
+	}
+	[[nodiscard]] bool parseAnd()
+	{
+		return parseLogical([&] { return parseBitOr(); }, "&&", Op::JUMP_IF_FALSE, 0);
+	}
+	[[nodiscard]] bool parseOr()
+	{
+		return parseLogical([&] { return parseAnd(); }, "||", Op::JUMP_IF_TRUE, 1);
+	}
+
+	[[nodiscard]] bool parseTernary()
+	{
+		if (!parseOr()) return false;
+		if (!consume("?")) return true;
+		auto j1 = emitJump(Op::JUMP_IF_FALSE);
+		--depth;
+		if (!parseTernary()) return false;
+		if (!consume(":")) return false;
+		auto j2 = emitJump(Op::JUMP);
+		--depth;
+		patchJump(j1);
+		if (!parseTernary()) return false;
+		patchJump(j2);
+		return true;
+	}
+
+private:
+	std::string_view expr;
+	CompiledCondition result;
+	size_t depth = 0;
+};
+
+std::optional<CompiledCondition> CompiledCondition::compile(std::string_view expr)
+{
+	return Parser(expr).parse();
+}
+
+std::optional<bool> CompiledCondition::evaluate(Debugger& debugger) const
+{
+	return evaluate(usesMemory ? debugger.findDebuggable("memory")   : nullptr,
+	                usesRegs   ? debugger.findDebuggable("CPU regs") : nullptr);
+}
+
+std::optional<bool> CompiledCondition::evaluate(Debuggable* memory, Debuggable* regs) const
+{
+	if ((usesMemory && !memory) || (usesRegs && !regs)) return {};
+
+	std::array<int64_t, STACK_SIZE> stack;
+	size_t sp = 0;
+	auto top = [&]() -> int64_t& { return stack[sp - 1]; };
+	auto readMem = [&](int64_t addr) -> std::optional<int64_t> {
+		if ((addr < 0) || (addr >= memory->getSize())) return {};
+		return memory->read(unsigned(addr));
+	};
+
+	size_t pc = 0;
+	while (pc < code.size()) {
+		const auto& instr = code[pc++];
+		switch (instr.op) {
+		using enum Op;
+		case PUSH:
+			stack[sp++] = instr.arg;
+			break;
+		case MEM: {
+			auto v = readMem(top());
+			if (!v) return {};
+			top() = *v;
+			break;
+		}
+		case MEM16: {
+			auto lo = readMem(top());
+			auto hi = readMem(top() + 1);
+			if (!lo || !hi) return {};
+			top() = *lo + 256 * *hi;
+			break;
+		}
+		case REG8:
+			stack[sp++] = regs->read(unsigned(instr.arg));
+			break;
+		case REG16:
+			stack[sp++] = 256 * regs->read(unsigned(instr.arg)) +
+			                    regs->read(unsigned(instr.arg + 1));
+			break;
+		case NEG:
+			if (top() == std::numeric_limits<int64_t>::min()) return {};
+			top() = -top();
+			break;
+		case NOT:
+			top() = (top() == 0);
+			break;
+		case INV:
+			top() = ~top();
+			break;
+		case BOOL:
+			top() = (top() != 0);
+			break;
+		case JUMP:
+			pc = size_t(instr.arg);
+			break;
+		case JUMP_IF_FALSE:
+			if (stack[--sp] == 0) pc = size_t(instr.arg);
+			break;
+		case JUMP_IF_TRUE:
+			if (stack[--sp] != 0) pc = size_t(instr.arg);
+			break;
+		default: {
+			// binary operators
+			int64_t b = stack[--sp];
+			int64_t& a = top();
+			switch (instr.op) {
+			case MUL:
+				if (__builtin_mul_overflow(a, b, &a)) return {};
+				break;
+			case DIV:
+			case MOD: {
+				// Tcl rounds towards negative infinity
+				if (b == 0) return {};
+				if ((a == std::numeric_limits<int64_t>::min()) && (b == -1)) return {};
+				auto q = a / b;
+				auto r = a % b;
+				if ((r != 0) && ((r < 0) != (b < 0))) {
+					--q;
+					r += b;
+				}
+				a = (instr.op == DIV) ? q : r;
+				break;
+			}
+			case ADD:
+				if (__builtin_add_overflow(a, b, &a)) return {};
+				break;
+			case SUB:
+				if (__builtin_sub_overflow(a, b, &a)) return {};
+				break;
+			case SHL:
+				if ((b < 0) || (b >= 63)) return {};
+				if (((a << b) >> b) != a) return {};
+				a <<= b;
+				break;
+			case SHR:
+				if (b < 0) return {};
+				a >>= std::min<int64_t>(b, 63);
+				break;
+			case LT: a = (a <  b); break;
+			case LE: a = (a <= b); break;
+			case GT: a = (a >  b); break;
+			case GE: a = (a >= b); break;
+			case EQ: a = (a == b); break;
+			case NE: a = (a != b); break;
+			case BIT_AND: a &= b; break;
+			case BIT_XOR: a ^= b; break;
+			case BIT_OR:  a |= b; break;
+			default: UNREACHABLE;
+			}
+		}
+		}
+	}
+	assert(sp == 1);
+	return stack[0] != 0;
+}
+
+} // namespace openmsx
@@ -0,0 +1,83 @@
+#ifndef COMPILEDCONDITION_HH
+#define COMPILEDCONDITION_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace openmsx {
+
+class Debuggable;
+class Debugger;
+
+/** Breakpoint (and watchpoint and debug-) conditions are Tcl expressions.
+  * Evaluating such an expression via the Tcl interpreter is relatively slow,
+  * and for a debug condition (or a conditional breakpoint that's often hit)
+  * this has to be done after every emulated instruction.
+  *
+  * This class recognizes a common subset of such expressions and translates
+  * it to a small bytecode that can be evaluated without Tcl. Supported are:
+  *  - integer literals (decimal, hexadecimal '0x', binary '0b', octal '0o')
+  *  - the unary operators   - + ! ~
+  *  - the binary operators  * / % + - << >> < <= > >= == != & ^ | && ||
+  *  - the ternary operator  ?:
+  *  - parentheses
+  *  - the commands          [reg <name>]
+  *                          [peek <addr>]   [peek8 <addr>]   [peek_u8 <addr>]
+  *                          [peek16 <addr>] [peek_u16 <addr>]
+  *                          [debug read memory <addr>]
+  *                          [debug read {CPU regs} <index>]
+  *    where the arguments are either integer literals or themselves one of
+  *    these commands.
+  * For anything else compile() fails and the caller should keep on using
+  * Tcl. This assumes the 'reg' and 'peek*' procs are the standard ones (as
+  * defined in the openMSX scripts).
+  */
+class CompiledCondition
+{
+public:
+	/** Try to compile the given expression. Returns std::nullopt when the
+	  * expression uses something outside of the supported subset.
+	  */
+	[[nodiscard]] static std::optional<CompiledCondition> compile(std::string_view expr);
+
+	/** Evaluate the expression, reading from the debuggables of the given
+	  * debugger. Returns std::nullopt when the result cannot be calculated
+	  * natively (e.g. division by zero, address out of range). In that case
+	  * the caller should evaluate the expression via Tcl, which then gives
+	  * the proper error message.
+	  */
+	[[nodiscard]] std::optional<bool> evaluate(Debugger& debugger) const;
+
+	/** Same as above, but with explicit debuggables (possibly nullptr). */
+	[[nodiscard]] std::optional<bool> evaluate(Debuggable* memory, Debuggable* regs) const;
+
+private:
+	enum class Op : uint8_t {
+		PUSH, MEM, MEM16, REG8, REG16,
+		NEG, NOT, INV,
+		MUL, DIV, MOD, ADD, SUB, SHL, SHR,
+		LT, LE, GT, GE, EQ, NE,
+		BIT_AND, BIT_XOR, BIT_OR,
+		BOOL, JUMP, JUMP_IF_FALSE, JUMP_IF_TRUE,
+	};
+	struct Instr {
+		Op op;
+		int64_t arg = 0; // constant, register index or jump target
+	};
+	static constexpr size_t STACK_SIZE = 16;
+	class Parser;
+
+	CompiledCondition() = default;
+
+private:
+	std::vector<Instr> code;
+	bool usesMemory = false;
+	bool usesRegs = false;
+};
+
+} // namespace openmsx
+
+#endif
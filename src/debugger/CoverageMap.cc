@@ -0,0 +1,77 @@
+#include "CoverageMap.hh"
+
+#include "MSXException.hh"
+
+#include "StringOp.hh"
+#include "xrange.hh"
+
+namespace openmsx {
+
+bool CoverageMap::isCovered(Location loc) const
+{
+	auto it = regions.find(loc >> 16);
+	return (it != regions.end()) && it->second[uint16_t(loc)];
+}
+
+void CoverageMap::clear()
+{
+	regions.clear();
+	lastRegion = Location(-1);
+	lastBitmap = nullptr;
+}
+
+size_t CoverageMap::count() const
+{
+	size_t result = 0;
+	for (const auto& [region, bitmap] : regions) {
+		result += bitmap.count();
+	}
+	return result;
+}
+
+void CoverageMap::save(std::ostream& os) const
+{
+	os << "TN:openMSX\n";
+	for (const auto& [region, bitmap] : regions) {
+		os << "SF:" << CodeLocator::slotToString(region << 16) << '\n';
+		for (auto addr : xrange(bitmap.size())) {
+			if (bitmap[addr]) os << "DA:" << addr << ",1\n";
+		}
+		auto num = bitmap.count();
+		os << "LH:" << num << "\n"
+		      "LF:" << num << "\n"
+		      "end_of_record\n";
+	}
+}
+
+void CoverageMap::merge(std::string_view text)
+{
+	Bitmap* bitmap = nullptr;
+	unsigned lineNr = 0;
+	for (std::string_view line : StringOp::split_view(text, '\n')) {
+		++lineNr;
+		StringOp::trimRight(line, '\r');
+		auto error = [&] {
+			return MSXException("Invalid coverage data at line ", lineNr, ": ", line);
+		};
+		if (line.starts_with("SF:")) {
+			auto loc = CodeLocator::parseSlot(line.substr(3));
+			if (!loc) throw error();
+			bitmap = &regions[*loc >> 16];
+		} else if (line.starts_with("DA:")) {
+			if (!bitmap) throw error();
+			// DA:<line number>,<execution count>[,<checksum>]
+			auto [addrStr, rest] = StringOp::splitOnFirst(line.substr(3), ',');
+			auto countStr = StringOp::splitOnFirst(rest, ',').first;
+			auto addr = StringOp::stringToBase<10, unsigned>(addrStr);
+			auto count = StringOp::stringToBase<10, unsigned>(countStr);
+			if (!addr || (*addr > 0xFFFF) || !count) throw error();
+			if (*count) (*bitmap)[*addr] = true;
+		} else if (line == "end_of_record") {
+			bitmap = nullptr;
+		}
+		// ignore all other records (TN, LF, LH, ...)
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,62 @@
+#ifndef COVERAGEMAP_HH
+#define COVERAGEMAP_HH
+
+#include "CodeLocator.hh"
+
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string_view>
+
+namespace openmsx {
+
+/** Stores which instructions have been executed. There's one bitmap (one bit
+  * per address) for each combination of slot and (memory mapper or ROM
+  * mapper) segment, so the coverage of the different banks of a megaROM is
+  * kept separately.
+  *
+  * The data can be exported in the lcov tracefile format. Each slot/segment
+  * combination is a 'source file' (e.g. "SF:1-2 segment 3") and the
+  * instruction addresses are the 'line numbers'. Such files can be merged
+  * back in, so that the coverage of several sessions can be combined.
+  */
+class CoverageMap
+{
+public:
+	using Location = CodeLocator::Location;
+	using Bitmap = std::bitset<0x10000>;
+
+	/** Mark the instruction at the given location as executed. */
+	void mark(Location loc) {
+		auto region = loc >> 16;
+		if (region != lastRegion) [[unlikely]] {
+			lastRegion = region;
+			lastBitmap = &regions[region];
+		}
+		(*lastBitmap)[uint16_t(loc)] = true;
+	}
+
+	[[nodiscard]] bool isCovered(Location loc) const;
+	void clear();
+
+	/** Number of slot/segment combinations that contain covered code. */
+	[[nodiscard]] size_t numRegions() const { return regions.size(); }
+	/** Total number of covered instruction addresses. */
+	[[nodiscard]] size_t count() const;
+
+	/** Write the data in the lcov tracefile format. */
+	void save(std::ostream& os) const;
+	/** Add the coverage data in the given lcov tracefile to this map.
+	  * Throws MSXException on a parse error. */
+	void merge(std::string_view text);
+
+private:
+	std::map<Location, Bitmap> regions; // indexed by 'Location >> 16'
+	Location lastRegion = Location(-1);
+	Bitmap* lastBitmap = nullptr;
+};
+
+} // namespace openmsx
+
+#endif
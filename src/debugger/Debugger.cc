@@ -39,6 +39,9 @@ Debugger::Debugger(MSXMotherBoard& motherBoard_)
 	      motherBoard.getStateChangeDistributor(),
 	      motherBoard.getScheduler())
 	, tracer(*this)
+	, profiler(*this)
+	, instructionTrace(*this)
+	, coverage(*this)
 {
 }
 
@@ -181,6 +184,11 @@ void Debugger::transfer(Debugger& other)
 
 	// Breakpoints and conditions are (currently) global, so no need to
 	// copy those.
+
+	// Continue profiling, tracing instructions and collecting coverage.
+	profiler.transfer(other.profiler);
+	instructionTrace.transfer(other.instructionTrace);
+	coverage.transfer(other.coverage);
 }
 
 Interpreter& Debugger::getInterpreter()
@@ -255,7 +263,10 @@ void Debugger::Cmd::execute(
 		"list_conditions",   [&]{ listConditions(tokens, result); },
 		"probe",             [&]{ probe(tokens, result); },
 		"symbols",           [&]{ symbols(tokens, result); },
-		"trace",             [&]{ auto& d = debugger(); d.tracer.execute(d, tokens, result, time); });
+		"trace",             [&]{ auto& d = debugger(); d.tracer.execute(d, tokens, result, time); },
+		"profile",           [&]{ debugger().profiler.execute(tokens, result); },
+		"cpu_trace",         [&]{ debugger().instructionTrace.execute(tokens, result); },
+		"coverage",          [&]{ debugger().coverage.execute(tokens, result); });
 }
 
 void Debugger::Cmd::list(TclObject& result)
@@ -1193,6 +1204,9 @@ std::string Debugger::Cmd::help(std::span<const TclObject> tokens) const
 		"    disasm_blob  disassemble a instruction in Tcl binary string\n"
 		"    symbols      manage debug symbols\n"
 		"    trace        trace related subcommands\n"
+		"    profile      profiler related subcommands\n"
+		"    cpu_trace    record the executed instructions\n"
+		"    coverage     code coverage related subcommands\n"
 		"  The arguments are specific for each subcommand.\n"
 		"  Type 'help debug <subcommand>' for help about a specific subcommand.\n";
 
@@ -1628,6 +1642,12 @@ std::string Debugger::Cmd::help(std::span<const TclObject> tokens) const
 		return symbolsHelp;
 	} else if (tokens[1] == "trace") {
 		return debugger().tracer.help(tokens);
+	} else if (tokens[1] == "profile") {
+		return debugger().profiler.help(tokens);
+	} else if (tokens[1] == "cpu_trace") {
+		return debugger().instructionTrace.help(tokens);
+	} else if (tokens[1] == "coverage") {
+		return debugger().coverage.help(tokens);
 	} else {
 		return unknownHelp;
 	}
@@ -1671,8 +1691,8 @@ void Debugger::Cmd::tabCompletion(std::vector<std::string>& tokens) const
 	};
 	static constexpr std::array otherCmds = {
 		"disasm"sv, "disasm_blob"sv, "set_bp"sv, "remove_bp"sv, "set_watchpoint"sv,
-		"remove_watchpoint"sv, "set_condition"sv, "remove_condition"sv, "trace"sv,
-		"probe"sv, "symbols"sv, "breakpoint"sv, "watchpoint"sv, "watchexpr"sv, "condition"sv,
+		"remove_watchpoint"sv, "set_condition"sv, "remove_condition"sv, "trace"sv, "profile"sv,
+		"cpu_trace"sv, "coverage"sv, "probe"sv, "symbols"sv, "breakpoint"sv, "watchpoint"sv, "watchexpr"sv, "condition"sv,
 	};
 	static constexpr std::array types = {
 		"read_io"sv, "write_io"sv, "read_mem"sv, "write_mem"sv,
@@ -1719,6 +1739,12 @@ void Debugger::Cmd::tabCompletion(std::vector<std::string>& tokens) const
 				completeString(tokens, subCmds);
 			} else if (tokens[1] == "trace") {
 				debugger().tracer.tabCompletion(debugger(), tokens);
+			} else if (tokens[1] == "profile") {
+				debugger().profiler.tabCompletion(tokens);
+			} else if (tokens[1] == "cpu_trace") {
+				debugger().instructionTrace.tabCompletion(tokens);
+			} else if (tokens[1] == "coverage") {
+				debugger().coverage.tabCompletion(tokens);
 			}
 		}
 		break;
@@ -1773,6 +1799,12 @@ void Debugger::Cmd::tabCompletion(std::vector<std::string>& tokens) const
 			}
 		} else if (tokens[1] == "trace") {
 			debugger().tracer.tabCompletion(debugger(), tokens);
+		} else if (tokens[1] == "profile") {
+			debugger().profiler.tabCompletion(tokens);
+		} else if (tokens[1] == "cpu_trace") {
+			debugger().instructionTrace.tabCompletion(tokens);
+		} else if (tokens[1] == "coverage") {
+			debugger().coverage.tabCompletion(tokens);
 		}
 		break;
 	}
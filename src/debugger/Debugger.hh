@@ -1,7 +1,10 @@
 #ifndef DEBUGGER_HH
 #define DEBUGGER_HH
 
+#include "CodeCoverage.hh"
+#include "InstructionTrace.hh"
 #include "Probe.hh"
+#include "Profiler.hh"
 #include "Tracer.hh"
 
 #include "ImGuiWatchExpr.hh"
@@ -57,6 +60,9 @@ public:
 
 	[[nodiscard]] auto& getProbes() { return probes; }
 	[[nodiscard]] Tracer& getTracer() { return tracer; }
+	[[nodiscard]] Profiler& getProfiler() { return profiler; }
+	[[nodiscard]] InstructionTrace& getInstructionTrace() { return instructionTrace; }
+	[[nodiscard]] CodeCoverage& getCodeCoverage() { return coverage; }
 
 private:
 	[[nodiscard]] Debuggable& getDebuggable(std::string_view name);
@@ -151,6 +157,12 @@ private:
 
 	Tracer tracer;
 	friend class Tracer;
+	Profiler profiler;
+	friend class Profiler;
+	InstructionTrace instructionTrace;
+	friend class InstructionTrace;
+	CodeCoverage coverage;
+	friend class CodeCoverage;
 
 	hash_map<std::string, Debuggable*, XXHasher> debuggables;
 	std::vector<ProbeBase*> probes; // sorted on name
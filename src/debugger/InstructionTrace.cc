@@ -0,0 +1,265 @@
+#include "InstructionTrace.hh"
+
+#include "Debugger.hh"
+
+#include "CPURegs.hh"
+#include "CommandException.hh"
+#include "Dasm.hh"
+#include "Interpreter.hh"
+#include "MSXCPU.hh"
+#include "MSXCPUInterface.hh"
+#include "MSXMotherBoard.hh"
+#include "TclArgParser.hh"
+#include "TclObject.hh"
+
+#include "join.hh"
+#include "strCat.hh"
+
+#include <cassert>
+#include <deque>
+#include <format>
+#include <ranges>
+#include <utility>
+
+using namespace std::literals;
+
+namespace openmsx {
+
+InstructionTrace::InstructionTrace(Debugger& debugger_)
+	: debugger(debugger_)
+	, locator(debugger_)
+{
+}
+
+InstructionTrace::~InstructionTrace()
+{
+	stop();
+}
+
+void InstructionTrace::start()
+{
+	if (active) return;
+	active = true;
+	locator.invalidate();
+	buffer.restart(); // don't delta-encode against stale data
+	if (auto* cpu = debugger.cpu) {
+		cpu->setInstructionTrace(this);
+	}
+}
+
+void InstructionTrace::stop()
+{
+	if (!active) return;
+	active = false;
+	if (auto* cpu = debugger.cpu) {
+		cpu->setInstructionTrace(nullptr);
+	}
+}
+
+void InstructionTrace::transfer(InstructionTrace& other)
+{
+	buffer = std::move(other.buffer);
+	other.buffer.clear();
+
+	if (other.active) {
+		other.stop();
+		start();
+	}
+}
+
+void InstructionTrace::record(const CPURegs& regs, bool irq, EmuTime time)
+{
+	Entry entry;
+	entry.time = time;
+	entry.location = locator.get(regs.getPC());
+	entry.regs = {regs.getAF(), regs.getBC(), regs.getDE(), regs.getHL(),
+	              regs.getIX(), regs.getIY(), regs.getSP()};
+	entry.irq = irq;
+	if (!irq) {
+		const auto& interface = debugger.getMotherBoard().getCPUInterface();
+		entry.opcodeLen = uint8_t(fetchInstruction(interface, regs.getPC(), entry.opcode, time).size());
+	}
+	buffer.push(entry);
+}
+
+std::string InstructionTrace::format(const Entry& entry)
+{
+	std::string mnemonic;
+	std::string opcodes;
+	if (entry.irq) {
+		mnemonic = "<interrupt>";
+	} else {
+		dasm(entry.getOpcode(), entry.getPC(), mnemonic);
+		opcodes = join(std::views::transform(entry.getOpcode(),
+			[](uint8_t b) { return hex_string<2>(b); }), ' ');
+	}
+	const auto& r = entry.regs;
+	return std::format("{:.9f} {:<12} {:04X}  {:<11}  {:<18}  "
+	                   "AF={:04X} BC={:04X} DE={:04X} HL={:04X} IX={:04X} IY={:04X} SP={:04X}",
+		entry.time.toDouble(), CodeLocator::slotToString(entry.location),
+		entry.getPC(), opcodes, mnemonic,
+		r[InstructionTraceBuffer::AF], r[InstructionTraceBuffer::BC],
+		r[InstructionTraceBuffer::DE], r[InstructionTraceBuffer::HL],
+		r[InstructionTraceBuffer::IX], r[InstructionTraceBuffer::IY],
+		r[InstructionTraceBuffer::SP]);
+}
+
+void InstructionTrace::dump(std::span<const TclObject> tokens, TclObject& result)
+{
+	int last = 100;
+	std::optional<int> from;
+	std::optional<int> to;
+	std::array info = {
+		valueArg("-last", last),
+		valueArg("-from", from),
+		valueArg("-to", to),
+	};
+	auto& cmd = debugger.cmd;
+	auto& interp = cmd.getInterpreter();
+	auto arguments = parseTclArgs(interp, tokens.subspan(3), info);
+	if (!arguments.empty()) {
+		interp.wrongNumArgs(3, tokens, "?-last <count>? ?-from <addr>? ?-to <addr>?");
+	}
+	if (last <= 0) throw CommandException("-last must be positive");
+
+	// Keep the last 'n' entries that pass the address filter.
+	auto minAddr = from.value_or(0);
+	auto maxAddr = to.value_or(0xFFFF);
+	std::deque<Entry> selected;
+	buffer.decode(0, buffer.size(), [&](size_t /*idx*/, const Entry& entry) {
+		auto pc = entry.getPC();
+		if ((pc < minAddr) || (pc > maxAddr)) return;
+		if (selected.size() == size_t(last)) selected.pop_front();
+		selected.push_back(entry);
+	});
+	for (const auto& entry : selected) {
+		result.addListElement(format(entry));
+	}
+}
+
+void InstructionTrace::execute(std::span<const TclObject> tokens, TclObject& result)
+{
+	auto& cmd = debugger.cmd;
+	cmd.checkNumArgs(tokens, Completer::AtLeast{3}, "subcommand ?arg ...?");
+	cmd.executeSubCommand(tokens[2].getString(),
+		"start", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			start();
+		},
+		"stop", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			stop();
+		},
+		"clear", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			clear();
+		},
+		"status", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			result.addDictKeyValues("active", active,
+			                        "entries", buffer.size(),
+			                        "memory", buffer.getMemoryUsage(),
+			                        "capacity", buffer.getCapacity());
+		},
+		"size", [&]{
+			cmd.checkNumArgs(tokens, Completer::Between{3, 4}, "?megabytes?");
+			if (tokens.size() == 4) {
+				int mb = tokens[3].getInt(cmd.getInterpreter());
+				if (mb <= 0) throw CommandException("size must be positive");
+				buffer.setCapacity(size_t(mb) * 1024 * 1024);
+			}
+			result = buffer.getCapacity() / (1024 * 1024);
+		},
+		"dump", [&]{ dump(tokens, result); });
+}
+
+void InstructionTrace::tabCompletion(std::vector<std::string>& tokens) const
+{
+	static constexpr std::array cmds = {
+		"start"sv, "stop"sv, "clear"sv, "status"sv, "size"sv, "dump"sv,
+	};
+	static constexpr std::array dumpArgs = {
+		"-last"sv, "-from"sv, "-to"sv,
+	};
+	auto& cmd = debugger.cmd;
+	if (tokens.size() == 3) {
+		cmd.completeString(tokens, cmds);
+	} else if (tokens[2] == "dump") {
+		cmd.completeString(tokens, dumpArgs);
+	}
+}
+
+std::string InstructionTrace::help(std::span<const TclObject> tokens) const
+{
+	constexpr auto generalHelp =
+		"debug cpu_trace <subcommand> [<arguments>]\n"
+		"  Records all instructions executed by the emulated CPU in a ring buffer.\n"
+		"  Possible subcommands are:\n"
+		"    start   start recording\n"
+		"    stop    stop recording, the recorded data is kept\n"
+		"    clear   discard all recorded data\n"
+		"    status  returns a dict with info about the recorded data\n"
+		"    size    query or change the size of the ring buffer\n"
+		"    dump    returns the recorded instructions\n"
+		"  Type 'help debug cpu_trace <subcommand>' for help about a specific subcommand.\n";
+
+	constexpr auto startHelp =
+		"debug cpu_trace start\n"
+		"  Start recording. For each instruction the program counter, the opcode,\n"
+		"  the selected slot and segment, the registers AF, BC, DE, HL, IX, IY and SP\n"
+		"  (right before the instruction is executed) and the time are recorded.\n"
+		"  When the buffer is full, the oldest data is dropped.\n"
+		"  Note: just like with breakpoints, emulation runs slower while recording.\n";
+
+	constexpr auto stopHelp =
+		"debug cpu_trace stop\n"
+		"  Stop recording. The data recorded so far is kept.\n";
+
+	constexpr auto clearHelp =
+		"debug cpu_trace clear\n"
+		"  Discard all recorded data.\n";
+
+	constexpr auto statusHelp =
+		"debug cpu_trace status\n"
+		"  Returns a dict with the keys 'active' (is recording active), 'entries'\n"
+		"  (the number of recorded instructions), 'memory' and 'capacity' (the used\n"
+		"  and the maximum amount of memory, in bytes).\n";
+
+	constexpr auto sizeHelp =
+		"debug cpu_trace size [<megabytes>]\n"
+		"  Query or change the size of the ring buffer (in megabytes, default 64).\n"
+		"  On average an instruction takes about 6 to 8 bytes.\n";
+
+	constexpr auto dumpHelp =
+		"debug cpu_trace dump [-last <count>] [-from <addr>] [-to <addr>]\n"
+		"  Returns a list with the last <count> (default 100) recorded instructions,\n"
+		"  oldest first. With -from and/or -to only instructions in the given\n"
+		"  address range (inclusive) are returned.\n"
+		"  Each element has the form:\n"
+		"    <time> <slot> <pc> <opcode> <mnemonic> <registers>\n";
+
+	constexpr auto unknownHelp =
+		"Unknown subcommand, use 'help debug cpu_trace' to see a list of valid subcommands.\n";
+
+	auto size = tokens.size();
+	assert(size >= 2);
+	if (size == 2) {
+		return generalHelp;
+	} else if (tokens[2] == "start") {
+		return startHelp;
+	} else if (tokens[2] == "stop") {
+		return stopHelp;
+	} else if (tokens[2] == "clear") {
+		return clearHelp;
+	} else if (tokens[2] == "status") {
+		return statusHelp;
+	} else if (tokens[2] == "size") {
+		return sizeHelp;
+	} else if (tokens[2] == "dump") {
+		return dumpHelp;
+	} else {
+		return unknownHelp;
+	}
+}
+
+} // namespace openmsx
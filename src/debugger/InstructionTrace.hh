@@ -0,0 +1,74 @@
+#ifndef INSTRUCTIONTRACE_HH
+#define INSTRUCTIONTRACE_HH
+
+#include "CodeLocator.hh"
+#include "EmuTime.hh"
+#include "InstructionTraceBuffer.hh"
+
+#include <span>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+class CPURegs;
+class Debugger;
+class TclObject;
+
+/** Records the instructions executed by the emulated Z80/R800.
+  *
+  * For each instruction the program counter, the opcode bytes, a selection of
+  * registers (the values right before the instruction executes), the selected
+  * slot/segment and the EmuTime are stored (in a compact format, see
+  * InstructionTraceBuffer). Accepted interrupts are recorded as well.
+  *
+  * Just like the Profiler, this hooks into the slower instruction-by-
+  * instruction CPU loop, so it has no overhead when not active.
+  */
+class InstructionTrace
+{
+public:
+	using Entry = InstructionTraceBuffer::Entry;
+
+	explicit InstructionTrace(Debugger& debugger);
+	InstructionTrace(const InstructionTrace&) = delete;
+	InstructionTrace(InstructionTrace&&) = delete;
+	InstructionTrace& operator=(const InstructionTrace&) = delete;
+	InstructionTrace& operator=(InstructionTrace&&) = delete;
+	~InstructionTrace();
+
+	void execute(std::span<const TclObject> tokens, TclObject& result);
+	[[nodiscard]] std::string help(std::span<const TclObject> tokens) const;
+	void tabCompletion(std::vector<std::string>& tokens) const;
+
+	void start();
+	void stop();
+	void clear() { buffer.clear(); }
+	[[nodiscard]] bool isActive() const { return active; }
+
+	/** Take over the recorded instructions (and the active state) of the
+	  * trace of another machine, see Debugger::transfer(). */
+	void transfer(InstructionTrace& other);
+
+	[[nodiscard]] const InstructionTraceBuffer& getBuffer() const { return buffer; }
+
+	// Called from CPUCore right before each instruction (only while active).
+	void record(const CPURegs& regs, bool irq, EmuTime time);
+	// Called from CPUCore at the start of each execution slice.
+	void invalidateCache() { locator.invalidate(); }
+
+	[[nodiscard]] static std::string format(const Entry& entry);
+
+private:
+	void dump(std::span<const TclObject> tokens, TclObject& result);
+
+private:
+	Debugger& debugger;
+	CodeLocator locator;
+	InstructionTraceBuffer buffer;
+	bool active = false;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,183 @@
+#include "InstructionTraceBuffer.hh"
+
+#include "xrange.hh"
+
+#include <algorithm>
+#include <cassert>
+
+namespace openmsx {
+
+// Layout of one encoded entry:
+//   header byte:
+//     bits 0-2: opcode length (0 for an accepted interrupt)
+//     bit    3: PC is stored (otherwise it's the address right after the
+//               previous instruction)
+//     bit    4: slot/segment is stored (otherwise same as previous entry)
+//     bit    5: register mask is stored
+//     bit    6: accepted interrupt
+//   varint: time since previous entry (in EmuTime ticks)
+//   optional: PC (2 bytes, little endian)
+//   optional: slot/segment (varint, location >> 16)
+//   optional: register mask (1 byte), followed by the modified registers
+//             (each 2 bytes, little endian)
+//   opcode bytes
+static constexpr uint8_t HAS_PC   = 0x08;
+static constexpr uint8_t HAS_SLOT = 0x10;
+static constexpr uint8_t HAS_REGS = 0x20;
+static constexpr uint8_t IS_IRQ   = 0x40;
+
+static void putVarInt(std::vector<uint8_t>& out, uint64_t value)
+{
+	while (value >= 0x80) {
+		out.push_back(uint8_t(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back(uint8_t(value));
+}
+
+static uint64_t getVarInt(const uint8_t*& p)
+{
+	uint64_t result = 0;
+	unsigned shift = 0;
+	while (true) {
+		uint8_t b = *p++;
+		result |= uint64_t(b & 0x7F) << shift;
+		if (!(b & 0x80)) return result;
+		shift += 7;
+	}
+}
+
+static void putWord(std::vector<uint8_t>& out, uint16_t value)
+{
+	out.push_back(uint8_t(value & 0xFF));
+	out.push_back(uint8_t(value >> 8));
+}
+
+static uint16_t getWord(const uint8_t*& p)
+{
+	auto result = uint16_t(p[0] | (p[1] << 8));
+	p += 2;
+	return result;
+}
+
+void InstructionTraceBuffer::clear()
+{
+	blocks.clear();
+	encoder = {};
+	totalCount = 0;
+}
+
+void InstructionTraceBuffer::setCapacity(size_t bytes)
+{
+	maxBlocks = std::max<size_t>(1, bytes / BLOCK_SIZE);
+	while (blocks.size() > maxBlocks) {
+		totalCount -= blocks.front().count;
+		blocks.pop_front();
+	}
+}
+
+void InstructionTraceBuffer::push(const Entry& entry)
+{
+	if (blocks.empty() || encoder.first || (entry.time < encoder.prev.time) ||
+	    ((blocks.back().data.size() + MAX_ENTRY_SIZE) > BLOCK_SIZE)) {
+		// start a new block, recycle the memory of the oldest block
+		std::vector<uint8_t> data;
+		if (blocks.size() >= maxBlocks) {
+			data = std::move(blocks.front().data);
+			totalCount -= blocks.front().count;
+			blocks.pop_front();
+			data.clear();
+		} else {
+			data.reserve(BLOCK_SIZE);
+		}
+		blocks.push_back(Block{.data = std::move(data), .startTime = entry.time, .count = 0});
+		encoder.first = true;
+		encoder.prev.time = entry.time;
+	}
+	encode(blocks.back(), entry);
+}
+
+void InstructionTraceBuffer::encode(Block& block, const Entry& entry)
+{
+	auto& out = block.data;
+	const auto& prev = encoder.prev;
+	bool first = encoder.first;
+
+	uint8_t header = entry.opcodeLen;
+	bool storePC = first || (entry.getPC() != encoder.nextPC);
+	bool storeSlot = first || ((entry.location >> 16) != (prev.location >> 16));
+	uint8_t mask = 0;
+	for (auto r : xrange(uint8_t(NUM_REGS))) {
+		if (first || (entry.regs[r] != prev.regs[r])) mask |= uint8_t(1 << r);
+	}
+	if (storePC)   header |= HAS_PC;
+	if (storeSlot) header |= HAS_SLOT;
+	if (mask)      header |= HAS_REGS;
+	if (entry.irq) header |= IS_IRQ;
+
+	out.push_back(header);
+	putVarInt(out, (entry.time - prev.time).toUint64());
+	if (storePC) putWord(out, entry.getPC());
+	if (storeSlot) putVarInt(out, entry.location >> 16);
+	if (mask) {
+		out.push_back(mask);
+		for (auto r : xrange(uint8_t(NUM_REGS))) {
+			if (mask & (1 << r)) putWord(out, entry.regs[r]);
+		}
+	}
+	out.insert(out.end(), entry.opcode.begin(), entry.opcode.begin() + entry.opcodeLen);
+	assert(out.size() <= BLOCK_SIZE);
+
+	encoder.prev = entry;
+	encoder.nextPC = uint16_t(entry.getPC() + entry.opcodeLen);
+	encoder.first = false;
+	++block.count;
+	++totalCount;
+}
+
+void InstructionTraceBuffer::decodeEntry(const uint8_t*& p, Entry& prev, uint16_t& nextPC)
+{
+	uint8_t header = *p++;
+	prev.time += EmuDuration(getVarInt(p));
+	uint16_t pc = (header & HAS_PC) ? getWord(p) : nextPC;
+	auto high = (header & HAS_SLOT) ? getVarInt(p) : (prev.location >> 16);
+	prev.location = (high << 16) | pc;
+	if (header & HAS_REGS) {
+		uint8_t mask = *p++;
+		for (auto r : xrange(uint8_t(NUM_REGS))) {
+			if (mask & (1 << r)) prev.regs[r] = getWord(p);
+		}
+	}
+	prev.opcodeLen = header & 7;
+	prev.irq = (header & IS_IRQ) != 0;
+	prev.opcode = {};
+	for (auto i : xrange(prev.opcodeLen)) prev.opcode[i] = *p++;
+	nextPC = uint16_t(pc + prev.opcodeLen);
+}
+
+void InstructionTraceBuffer::decode(size_t first, size_t num, function_ref<void(size_t, const Entry&)> callback) const
+{
+	size_t blockStart = 0;
+	for (const auto& block : blocks) {
+		if (num == 0) break;
+		if (first >= blockStart + block.count) {
+			// skip the whole block
+			blockStart += block.count;
+			continue;
+		}
+		Entry entry;
+		entry.time = block.startTime;
+		uint16_t nextPC = 0;
+		const uint8_t* p = block.data.data();
+		for (auto i : xrange(block.count)) {
+			decodeEntry(p, entry, nextPC);
+			auto idx = blockStart + i;
+			if (idx < first) continue;
+			callback(idx, entry);
+			if (--num == 0) break;
+		}
+		blockStart += block.count;
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,95 @@
+#ifndef INSTRUCTIONTRACEBUFFER_HH
+#define INSTRUCTIONTRACEBUFFER_HH
+
+#include "EmuTime.hh"
+
+#include "function_ref.hh"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+namespace openmsx {
+
+/** Ring buffer with a fixed memory budget that stores the instructions
+  * recorded by InstructionTrace.
+  *
+  * To fit many millions of instructions, entries are delta-encoded relative
+  * to the previous entry (e.g. the PC is only stored when it doesn't follow
+  * the previous instruction, only the modified registers are stored). The
+  * buffer is split in blocks, the first entry in each block is encoded
+  * completely, so when the buffer is full the oldest block can simply be
+  * dropped.
+  */
+class InstructionTraceBuffer
+{
+public:
+	enum Reg : uint8_t { AF, BC, DE, HL, IX, IY, SP, NUM_REGS };
+
+	struct Entry {
+		EmuTime time = EmuTime::zero();
+		uint64_t location = 0; // see CodeLocator, includes the PC
+		std::array<uint16_t, NUM_REGS> regs = {};
+		std::array<uint8_t, 4> opcode = {};
+		uint8_t opcodeLen = 0; // 0 for an accepted interrupt
+		bool irq = false;
+
+		[[nodiscard]] uint16_t getPC() const { return uint16_t(location); }
+		[[nodiscard]] std::span<const uint8_t> getOpcode() const { return {opcode.data(), opcodeLen}; }
+		[[nodiscard]] bool operator==(const Entry&) const = default;
+	};
+
+	static constexpr size_t BLOCK_SIZE = 64 * 1024;
+	static constexpr size_t DEFAULT_CAPACITY = 64 * 1024 * 1024; // in bytes
+
+public:
+	void push(const Entry& entry);
+	void clear();
+
+	/** The next entry won't be delta-encoded against the previous one.
+	  * E.g. when recording was interrupted. */
+	void restart() { encoder.first = true; }
+
+	/** Change the memory budget (in bytes). Drops the oldest data when
+	  * the new capacity is smaller. */
+	void setCapacity(size_t bytes);
+	[[nodiscard]] size_t getCapacity() const { return maxBlocks * BLOCK_SIZE; }
+	[[nodiscard]] size_t getMemoryUsage() const { return blocks.size() * BLOCK_SIZE; }
+
+	/** Number of stored entries. */
+	[[nodiscard]] size_t size() const { return totalCount; }
+
+	/** Decode the entries in the range [first, first + num), the oldest
+	  * entry has index 0. */
+	void decode(size_t first, size_t num, function_ref<void(size_t, const Entry&)> callback) const;
+
+private:
+	static constexpr size_t MAX_ENTRY_SIZE = 48;
+
+	struct Block {
+		std::vector<uint8_t> data;
+		EmuTime startTime = EmuTime::zero();
+		size_t count = 0;
+	};
+
+	struct Encoder {
+		Entry prev;
+		uint16_t nextPC = 0;
+		bool first = true;
+	};
+
+	void encode(Block& block, const Entry& entry);
+	static void decodeEntry(const uint8_t*& p, Entry& prev, uint16_t& nextPC);
+
+private:
+	std::deque<Block> blocks;
+	Encoder encoder;
+	size_t maxBlocks = DEFAULT_CAPACITY / BLOCK_SIZE;
+	size_t totalCount = 0;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,421 @@
+#include "Profiler.hh"
+
+#include "Debugger.hh"
+#include "SymbolManager.hh"
+
+#include "CommandException.hh"
+#include "FileContext.hh"
+#include "Interpreter.hh"
+#include "MSXCPU.hh"
+#include "MSXCPUInterface.hh"
+#include "MSXException.hh"
+#include "MSXMotherBoard.hh"
+#include "Reactor.hh"
+#include "TclObject.hh"
+
+#include "FileOperations.hh"
+#include "one_of.hh"
+#include "strCat.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <fstream>
+#include <utility>
+
+using namespace std::literals;
+
+namespace openmsx {
+
+static constexpr size_t MAX_CALL_DEPTH = 1024;
+
+Profiler::Profiler(Debugger& debugger_)
+	: debugger(debugger_)
+	, locator(debugger_)
+{
+	clear();
+}
+
+Profiler::~Profiler()
+{
+	stop();
+}
+
+void Profiler::start()
+{
+	if (active) return;
+	active = true;
+	locator.invalidate();
+	if (auto* cpu = debugger.cpu) {
+		cpu->setProfiler(this);
+	}
+}
+
+void Profiler::stop()
+{
+	if (!active) return;
+	active = false;
+	if (auto* cpu = debugger.cpu) {
+		cpu->setProfiler(nullptr);
+	}
+}
+
+void Profiler::transfer(Profiler& other)
+{
+	functions     = std::move(other.functions);
+	functionIndex = std::move(other.functionIndex);
+	instructions  = std::move(other.instructions);
+	edges         = std::move(other.edges);
+	totalCycles   = other.totalCycles;
+	totalCount    = other.totalCount;
+	// The new machine doesn't continue at the same point in the
+	// execution, so the shadow call stack is no longer valid.
+	stack.clear();
+	curKind = Kind::OTHER;
+	other.clear();
+
+	if (other.active) {
+		other.stop();
+		start();
+	}
+}
+
+void Profiler::clear()
+{
+	functions.assign(1, 0); // index 0: code outside of any tracked call
+	functionIndex.clear();
+	instructions.clear();
+	edges.clear();
+	stack.clear();
+	totalCycles = 0;
+	totalCount = 0;
+	curKind = Kind::OTHER;
+}
+
+unsigned Profiler::getFunction(Location loc)
+{
+	if (const auto* idx = lookup(functionIndex, loc)) {
+		return *idx;
+	}
+	auto idx = unsigned(functions.size());
+	functions.push_back(loc);
+	functionIndex.emplace(loc, idx);
+	return idx;
+}
+
+void Profiler::beginInstruction(uint16_t pc, uint16_t sp, bool irq, EmuTime time)
+{
+	curLocation = locator.get(pc);
+	curStart = time;
+	curSp = sp;
+	curIrq = irq;
+	if (irq) {
+		// accepting an IRQ/NMI is like a call to the interrupt handler
+		curKind = Kind::CALL;
+		return;
+	}
+	const auto& interface = debugger.getMotherBoard().getCPUInterface();
+	auto op = interface.peekMem(pc, time);
+	if (op == one_of(0xCD, 0xC4, 0xCC, 0xD4, 0xDC, 0xE4, 0xEC, 0xF4, 0xFC) ||
+	    ((op & 0xC7) == 0xC7)) { // CALL, CALL cc, RST
+		curKind = Kind::CALL;
+	} else if ((op == 0xC9) || ((op & 0xC7) == 0xC0)) { // RET, RET cc
+		curKind = Kind::RET;
+	} else if (op == 0xED) {
+		auto op2 = interface.peekMem(uint16_t(pc + 1), time);
+		curKind = ((op2 & 0xC7) == 0x45) ? Kind::RET : Kind::OTHER; // RETI, RETN
+	} else {
+		curKind = Kind::OTHER;
+	}
+}
+
+void Profiler::endInstruction(uint16_t pc, uint16_t sp, EmuTime time, unsigned freq)
+{
+	uint64_t cycles = (time - curStart).getTicksAt(freq);
+	uint64_t count = curIrq ? 0 : 1;
+	auto& counters = instructions[(uint64_t(currentFunction()) << LOCATION_BITS) | curLocation];
+	counters.count += count;
+	counters.cycles += cycles;
+	totalCount += count;
+	totalCycles += cycles;
+
+	// Only look at the stack pointer to decide whether a (conditional)
+	// call or return was actually taken.
+	if ((curKind == Kind::CALL) && (sp == uint16_t(curSp - 2))) {
+		if (stack.size() == MAX_CALL_DEPTH) {
+			// Most likely the program never returns via RET (e.g. it
+			// manipulates the stack). Forget the outermost frame.
+			stack.erase(stack.begin());
+		}
+		auto caller = currentFunction();
+		stack.push_back(Frame{
+			.function = getFunction(locator.get(pc)),
+			.caller = caller,
+			.callSite = curLocation,
+			.startCycles = totalCycles,
+			.startCount = totalCount,
+			.sp = sp});
+	} else if ((curKind == Kind::RET) && (sp == uint16_t(curSp + 2))) {
+		// Also drop frames that were skipped because the program
+		// discarded return addresses from the stack.
+		while (!stack.empty() && (stack.back().sp < sp)) {
+			popFrame();
+		}
+	}
+}
+
+void Profiler::popFrame()
+{
+	const auto& frame = stack.back();
+	auto& edge = edges[{frame.caller, frame.callSite, frame.function}];
+	edge.calls += 1;
+	edge.cycles += totalCycles - frame.startCycles;
+	edge.count += totalCount - frame.startCount;
+	stack.pop_back();
+}
+
+SymbolManager& Profiler::getSymbolManager()
+{
+	return debugger.getMotherBoard().getReactor().getSymbolManager();
+}
+
+std::string Profiler::getName(SymbolManager& symbols, unsigned function) const
+{
+	if (function == 0) return "<toplevel>";
+
+	auto loc = functions[function];
+	if (const auto* name = CodeLocator::findSymbol(symbols, loc)) {
+		return *name;
+	}
+	return strCat("0x", hex_string<4>(CodeLocator::getAddress(loc)),
+	              " (slot ", CodeLocator::slotToString(loc), ')');
+}
+
+std::string Profiler::flatReport(size_t maxLines)
+{
+	struct Entry {
+		uint64_t selfCycles = 0;
+		uint64_t selfCount = 0;
+		uint64_t calls = 0;
+		uint64_t inclCycles = 0;
+		unsigned function = 0;
+	};
+	std::vector<Entry> entries(functions.size());
+	for (auto i : xrange(entries.size())) entries[i].function = unsigned(i);
+	for (const auto& [key, counters] : instructions) {
+		auto& e = entries[key >> LOCATION_BITS];
+		e.selfCycles += counters.cycles;
+		e.selfCount += counters.count;
+	}
+	auto addEdge = [&](unsigned callee, uint64_t calls, uint64_t cycles) {
+		entries[callee].calls += calls;
+		entries[callee].inclCycles += cycles;
+	};
+	for (const auto& [key, edge] : edges) {
+		addEdge(std::get<2>(key), edge.calls, edge.cycles);
+	}
+	for (const auto& frame : stack) { // calls that haven't returned yet
+		addEdge(frame.function, 1, totalCycles - frame.startCycles);
+	}
+	entries[0].inclCycles = totalCycles;
+
+	std::ranges::sort(entries, std::greater{}, &Entry::selfCycles);
+
+	auto& symbols = getSymbolManager();
+	std::string result = std::format("{:>7} {:>14} {:>12} {:>9} {:>14}  {}\n",
+		"self%", "self cycles", "instructions", "calls", "incl cycles", "function");
+	for (const auto& e : entries) {
+		if (maxLines-- == 0) break;
+		if (e.selfCycles == 0 && e.inclCycles == 0) break;
+		double percent = totalCycles ? 100.0 * double(e.selfCycles) / double(totalCycles) : 0.0;
+		strAppend(result, std::format("{:>7.2f} {:>14} {:>12} {:>9} {:>14}  {}\n",
+			percent, e.selfCycles, e.selfCount, e.calls, e.inclCycles,
+			getName(symbols, e.function)));
+	}
+	return result;
+}
+
+void Profiler::exportCallgrind(zstring_view filename)
+{
+	std::ofstream os;
+	FileOperations::openOfStream(os, filename);
+	if (!os) throw MSXException("Cannot open file for writing: ", filename);
+
+	os << "# callgrind format\n"
+	      "version: 1\n"
+	      "creator: openMSX\n"
+	      "positions: instr\n"
+	      "events: Cycles Instructions\n"
+	      "summary: " << totalCycles << ' ' << totalCount << "\n\n";
+
+	// Use name compression: only the first occurrence of a function
+	// contains its name.
+	auto& symbols = getSymbolManager();
+	std::vector<bool> named(functions.size(), false);
+	auto fnName = [&](unsigned f) {
+		if (named[f]) return strCat('(', f + 1, ')');
+		named[f] = true;
+		return strCat('(', f + 1, ") ", getName(symbols, f));
+	};
+	auto hexAddr = [](Location loc) { return strCat("0x", hex_string<4>(uint16_t(loc))); };
+
+	// Group per function, sorted on address.
+	std::vector<std::pair<uint64_t, Counters>> sorted(instructions.begin(), instructions.end());
+	std::ranges::sort(sorted, {}, [](const auto& p) { return p.first; });
+
+	auto allEdges = edges;
+	for (const auto& frame : stack) {
+		auto& edge = allEdges[{frame.caller, frame.callSite, frame.function}];
+		edge.calls += 1;
+		edge.cycles += totalCycles - frame.startCycles;
+		edge.count += totalCount - frame.startCount;
+	}
+
+	auto instrIt = sorted.begin();
+	auto edgeIt = allEdges.begin();
+	for (auto f : xrange(unsigned(functions.size()))) {
+		auto instrEnd = std::find_if(instrIt, sorted.end(),
+			[&](const auto& p) { return (p.first >> LOCATION_BITS) != f; });
+		auto edgeEnd = std::find_if(edgeIt, allEdges.end(),
+			[&](const auto& p) { return std::get<0>(p.first) != f; });
+		if ((instrIt == instrEnd) && (edgeIt == edgeEnd)) continue;
+
+		os << "fn=" << fnName(f) << '\n';
+		for (; instrIt != instrEnd; ++instrIt) {
+			const auto& [key, counters] = *instrIt;
+			os << hexAddr(key) << ' ' << counters.cycles << ' ' << counters.count << '\n';
+		}
+		for (; edgeIt != edgeEnd; ++edgeIt) {
+			const auto& [key, edge] = *edgeIt;
+			const auto& [caller, callSite, callee] = key;
+			os << "cfn=" << fnName(callee) << '\n'
+			   << "calls=" << edge.calls << ' ' << hexAddr(functions[callee]) << '\n'
+			   << hexAddr(callSite) << ' ' << edge.cycles << ' ' << edge.count << '\n';
+		}
+		os << '\n';
+	}
+	if (!os) throw MSXException("Error while writing file: ", filename);
+}
+
+void Profiler::execute(std::span<const TclObject> tokens, TclObject& result)
+{
+	auto& cmd = debugger.cmd;
+	cmd.checkNumArgs(tokens, Completer::AtLeast{3}, "subcommand ?arg ...?");
+	cmd.executeSubCommand(tokens[2].getString(),
+		"start", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			start();
+		},
+		"stop", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			stop();
+		},
+		"clear", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			clear();
+		},
+		"status", [&]{
+			cmd.checkNumArgs(tokens, 3, "");
+			result = active;
+		},
+		"report", [&]{
+			cmd.checkNumArgs(tokens, Completer::Between{3, 4}, "?count?");
+			int count = (tokens.size() == 4) ? tokens[3].getInt(cmd.getInterpreter()) : 20;
+			if (count <= 0) throw CommandException("count must be positive");
+			result = flatReport(size_t(count));
+		},
+		"callgrind", [&]{
+			cmd.checkNumArgs(tokens, 4, "filename");
+			try {
+				exportCallgrind(FileOperations::expandTilde(std::string(tokens[3].getString())));
+			} catch (MSXException& e) {
+				throw CommandException(e.getMessage());
+			}
+		});
+}
+
+void Profiler::tabCompletion(std::vector<std::string>& tokens) const
+{
+	static constexpr std::array cmds = {
+		"start"sv, "stop"sv, "clear"sv, "status"sv, "report"sv, "callgrind"sv,
+	};
+	auto& cmd = debugger.cmd;
+	if (tokens.size() == 3) {
+		cmd.completeString(tokens, cmds);
+	} else if ((tokens.size() == 4) && (tokens[2] == "callgrind")) {
+		cmd.completeFileName(tokens, userFileContext());
+	}
+}
+
+std::string Profiler::help(std::span<const TclObject> tokens) const
+{
+	constexpr auto generalHelp =
+		"debug profile <subcommand> [<arguments>]\n"
+		"  Cycle accurate profiler for the code running on the emulated Z80/R800.\n"
+		"  Possible subcommands are:\n"
+		"    start      start collecting profile data\n"
+		"    stop       stop collecting profile data\n"
+		"    clear      discard all collected profile data\n"
+		"    status     returns whether the profiler is running\n"
+		"    report     returns a per-function summary\n"
+		"    callgrind  write the profile data in callgrind format\n"
+		"  Type 'help debug profile <subcommand>' for help about a specific subcommand.\n";
+
+	constexpr auto startHelp =
+		"debug profile start\n"
+		"  Start collecting profile data. While the profiler is running, for each\n"
+		"  instruction the number of executions and the number of CPU cycles is\n"
+		"  recorded. Addresses are distinguished by slot and by memory mapper or\n"
+		"  ROM mapper segment. CALL and RST instructions and interrupts are tracked\n"
+		"  to build a call graph.\n"
+		"  Note: just like with breakpoints, emulation runs slower while profiling.\n";
+
+	constexpr auto stopHelp =
+		"debug profile stop\n"
+		"  Stop collecting profile data. The data collected so far is kept.\n";
+
+	constexpr auto clearHelp =
+		"debug profile clear\n"
+		"  Discard all collected profile data.\n";
+
+	constexpr auto statusHelp =
+		"debug profile status\n"
+		"  Returns '1' when the profiler is running, '0' otherwise.\n";
+
+	constexpr auto reportHelp =
+		"debug profile report [<count>]\n"
+		"  Returns a table with the functions that took the most CPU cycles\n"
+		"  (excluding the functions they called). By default 20 lines are shown.\n"
+		"  Functions are named using the loaded debug symbols (see 'debug symbols').\n";
+
+	constexpr auto callgrindHelp =
+		"debug profile callgrind <filename>\n"
+		"  Write the collected profile data to a file in callgrind format. This\n"
+		"  file can be analyzed with tools like KCachegrind or QCachegrind.\n";
+
+	constexpr auto unknownHelp =
+		"Unknown subcommand, use 'help debug profile' to see a list of valid subcommands.\n";
+
+	auto size = tokens.size();
+	assert(size >= 2);
+	if (size == 2) {
+		return generalHelp;
+	} else if (tokens[2] == "start") {
+		return startHelp;
+	} else if (tokens[2] == "stop") {
+		return stopHelp;
+	} else if (tokens[2] == "clear") {
+		return clearHelp;
+	} else if (tokens[2] == "status") {
+		return statusHelp;
+	} else if (tokens[2] == "report") {
+		return reportHelp;
+	} else if (tokens[2] == "callgrind") {
+		return callgrindHelp;
+	} else {
+		return unknownHelp;
+	}
+}
+
+} // namespace openmsx
@@ -0,0 +1,138 @@
+#ifndef PROFILER_HH
+#define PROFILER_HH
+
+#include "CodeLocator.hh"
+#include "EmuTime.hh"
+
+#include "hash_map.hh"
+#include "zstring_view.hh"
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace openmsx {
+
+class Debugger;
+class SymbolManager;
+class TclObject;
+
+/** Native (cycle accurate) profiler for the emulated Z80/R800 code.
+  *
+  * While active, CPUCore reports each executed instruction. The profiler
+  * counts the number of executions and the number of emulated cycles per
+  * instruction address. Addresses include the selected slot and (if
+  * applicable) the selected memory mapper or ROM mapper segment, so that
+  * e.g. the same address in different segments of a MegaROM is kept
+  * apart.
+  *
+  * CALL, RST and RET instructions (and accepted interrupts) are tracked on
+  * a shadow stack. This gives a call graph with per-function inclusive
+  * costs. Function names are resolved via the SymbolManager when a report
+  * is generated.
+  *
+  * Just like breakpoints, profiling switches CPUCore to its slower
+  * instruction-by-instruction loop. When the profiler is not active there
+  * is no overhead at all.
+  */
+class Profiler
+{
+public:
+	explicit Profiler(Debugger& debugger);
+	Profiler(const Profiler&) = delete;
+	Profiler(Profiler&&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+	Profiler& operator=(Profiler&&) = delete;
+	~Profiler();
+
+	void execute(std::span<const TclObject> tokens, TclObject& result);
+	[[nodiscard]] std::string help(std::span<const TclObject> tokens) const;
+	void tabCompletion(std::vector<std::string>& tokens) const;
+
+	void start();
+	void stop();
+	void clear();
+	[[nodiscard]] bool isActive() const { return active; }
+
+	/** Take over the collected data (and the active state) of the
+	  * profiler of another machine, see Debugger::transfer(). */
+	void transfer(Profiler& other);
+
+	// Called from CPUCore, around each instruction (only while active).
+	void beginInstruction(uint16_t pc, uint16_t sp, bool irq, EmuTime time);
+	void endInstruction(uint16_t pc, uint16_t sp, EmuTime time, unsigned freq);
+	// Called from CPUCore at the start of each execution slice. (The set
+	// of devices can only change outside of such a slice.)
+	void invalidateCache() { locator.invalidate(); }
+
+	[[nodiscard]] std::string flatReport(size_t maxLines);
+	void exportCallgrind(zstring_view filename); // throws MSXException
+
+private:
+	using Location = CodeLocator::Location;
+	static constexpr unsigned LOCATION_BITS = CodeLocator::BITS;
+
+	enum class Kind : uint8_t { OTHER, CALL, RET };
+	struct Counters {
+		uint64_t count = 0;
+		uint64_t cycles = 0;
+	};
+	struct Frame {
+		unsigned function; // index in 'functions'
+		unsigned caller;   // idem
+		Location callSite;
+		uint64_t startCycles;
+		uint64_t startCount;
+		uint16_t sp; // stack pointer right after the call
+	};
+	struct Edge {
+		uint64_t calls = 0;
+		uint64_t cycles = 0; // inclusive
+		uint64_t count = 0;  // inclusive
+	};
+	struct Hasher {
+		[[nodiscard]] size_t operator()(uint64_t k) const {
+			return size_t((k * 0x9E3779B97F4A7C15) >> 32);
+		}
+	};
+
+	[[nodiscard]] unsigned getFunction(Location loc);
+	[[nodiscard]] unsigned currentFunction() const {
+		return stack.empty() ? 0 : stack.back().function;
+	}
+	void popFrame();
+	[[nodiscard]] std::string getName(SymbolManager& symbols, unsigned function) const;
+	[[nodiscard]] SymbolManager& getSymbolManager();
+
+private:
+	Debugger& debugger;
+	CodeLocator locator;
+
+	// Function entry points, index 0 is used for code that's not (yet)
+	// called from a tracked CALL instruction.
+	std::vector<Location> functions;
+	hash_map<Location, unsigned, Hasher> functionIndex;
+	// Self cost per (function, instruction), key is 'function << LOCATION_BITS | location'.
+	hash_map<uint64_t, Counters, Hasher> instructions;
+	// Inclusive cost per (caller, call-site, callee).
+	std::map<std::tuple<unsigned, Location, unsigned>, Edge> edges;
+	std::vector<Frame> stack; // shadow call stack
+	uint64_t totalCycles = 0;
+	uint64_t totalCount = 0;
+
+	// state of the current instruction
+	Location curLocation = 0;
+	EmuTime curStart = EmuTime::zero();
+	uint16_t curSp = 0;
+	Kind curKind = Kind::OTHER;
+	bool curIrq = false;
+
+	bool active = false;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,193 @@
+#include "TraceEvents.hh"
+
+#include "narrow.hh"
+#include "xrange.hh"
+
+namespace openmsx {
+
+[[nodiscard]] static bool isNumeric(const TraceValue& v)
+{
+	return v.holds_alternative<uint64_t>() || v.holds_alternative<double>();
+}
+
+[[nodiscard]] static bool numericLess(const TraceValue& a, const TraceValue& b)
+{
+	if (a.holds_alternative<uint64_t>() && b.holds_alternative<uint64_t>()) {
+		return a.get_u64() < b.get_u64(); // exact, also for large values
+	}
+	auto toDouble = [](const TraceValue& v) {
+		return v.holds_alternative<uint64_t>() ? double(v.get_u64()) : v.get_double();
+	};
+	return toDouble(a) < toDouble(b);
+}
+
+void TraceEvents::push_back(EmuTime time, TraceValue value)
+{
+	assert(empty() || (time >= getTime(size() - 1)));
+	auto index = size();
+	if ((index % BLOCK_SIZE) == 0) {
+		blockTimes.push_back(time.toUint64());
+		timeOffsets.push_back(0);
+	} else {
+		auto offset = time.toUint64() - blockTimes.back();
+		if (offset < LARGE_OFFSET) [[likely]] {
+			timeOffsets.push_back(uint32_t(offset));
+		} else {
+			timeOffsets.push_back(LARGE_OFFSET);
+			largeTimes.push_back({index, time});
+		}
+	}
+
+	if (runValues.empty() || !(runValues.back() == value)) {
+		runStarts.push_back(narrow<uint32_t>(index));
+		runValues.push_back(std::move(value));
+		if (runStarts.size() > 1) extendLod();
+	}
+	if ((index % BLOCK_SIZE) == 0) {
+		blockRuns.push_back(narrow<uint32_t>(runStarts.size() - 1));
+	}
+}
+
+void TraceEvents::clear()
+{
+	blockTimes.clear();
+	timeOffsets.clear();
+	largeTimes.clear();
+	runStarts.clear();
+	runValues.clear();
+	blockRuns.clear();
+	lod.clear();
+}
+
+void TraceEvents::truncate(EmuTime time)
+{
+	auto it = std::ranges::lower_bound(*this, time, {}, &Event::time);
+	auto num = it.getIndex();
+	if (num == size()) return;
+
+	timeOffsets.resize(num);
+	blockTimes.resize((num + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	blockRuns.resize(blockTimes.size());
+	while (!largeTimes.empty() && (largeTimes.back().index >= num)) {
+		largeTimes.pop_back();
+	}
+	while (!runStarts.empty() && (runStarts.back() >= num)) {
+		runStarts.pop_back();
+		runValues.pop_back();
+	}
+
+	auto completed = runStarts.empty() ? 0 : runStarts.size() - 1;
+	size_t bucketSize = LOD_FANOUT;
+	for (auto& level : lod) {
+		level.resize(std::min(level.size(), completed / bucketSize));
+		bucketSize *= LOD_FANOUT;
+	}
+}
+
+EmuTime TraceEvents::getLargeTime(size_t i) const
+{
+	auto it = std::ranges::lower_bound(largeTimes, i, {}, &LargeTime::index);
+	assert((it != largeTimes.end()) && (it->index == i));
+	return it->time;
+}
+
+uint64_t TraceEvents::runDuration(size_t run) const
+{
+	assert(run + 1 < runStarts.size());
+	return (getTime(runStarts[run + 1]) - getTime(runStarts[run])).toUint64();
+}
+
+TraceEvents::LodNode TraceEvents::runNode(size_t run, uint64_t duration) const
+{
+	auto r = narrow<uint32_t>(run);
+	auto numeric = isNumeric(runValues[run]) ? r : NO_RUN;
+	return {numeric, numeric, r, duration};
+}
+
+void TraceEvents::combine(LodNode& acc, const LodNode& node) const
+{
+	if (node.minRun != NO_RUN) {
+		if ((acc.minRun == NO_RUN) || numericLess(runValues[node.minRun], runValues[acc.minRun])) {
+			acc.minRun = node.minRun;
+		}
+		if ((acc.maxRun == NO_RUN) || numericLess(runValues[acc.maxRun], runValues[node.maxRun])) {
+			acc.maxRun = node.maxRun;
+		}
+	}
+	if ((acc.dominantRun == NO_RUN) || (node.dominantDuration > acc.dominantDuration)) {
+		acc.dominantRun = node.dominantRun;
+		acc.dominantDuration = node.dominantDuration;
+	}
+}
+
+void TraceEvents::combineRuns(LodNode& acc, size_t first, size_t last) const
+{
+	// Level 0 are the individual runs, level k > 0 are the nodes in lod[k - 1].
+	// At each level handle the unaligned units at both ends, the aligned
+	// middle part is handled (with fewer nodes) at the next level.
+	for (size_t level = 0; first < last; ++level) {
+		auto unit = [&](size_t i) {
+			return (level == 0) ? runNode(i, runDuration(i)) : lod[level - 1][i];
+		};
+		while ((first < last) && (first % LOD_FANOUT)) combine(acc, unit(first++));
+		while ((first < last) && (last  % LOD_FANOUT)) combine(acc, unit(--last));
+		first /= LOD_FANOUT;
+		last  /= LOD_FANOUT;
+	}
+}
+
+void TraceEvents::extendLod()
+{
+	// Called when a new run was started, so the run before it got completed.
+	// That may complete a bucket on one or more levels.
+	auto completed = runStarts.size() - 1;
+	size_t bucketSize = LOD_FANOUT; // in runs
+	for (size_t level = 0; (completed % bucketSize) == 0; ++level, bucketSize *= LOD_FANOUT) {
+		if (level == lod.size()) lod.emplace_back();
+		auto firstChild = (completed / bucketSize - 1) * LOD_FANOUT;
+		LodNode node;
+		for (auto i : xrange(firstChild, firstChild + LOD_FANOUT)) {
+			combine(node, (level == 0) ? runNode(i, runDuration(i)) : lod[level - 1][i]);
+		}
+		assert(lod[level].size() == completed / bucketSize - 1);
+		lod[level].push_back(node);
+	}
+}
+
+TraceEvents::Summary TraceEvents::summarize(size_t first, size_t last) const
+{
+	assert(first < last);
+	assert(last <= size());
+	auto firstRun = findRun(first);
+	auto lastRun = findRun(last - 1);
+
+	// the first and last run are possibly only partially inside the range
+	LodNode acc;
+	if (firstRun == lastRun) {
+		combine(acc, runNode(firstRun, 0));
+	} else {
+		combine(acc, runNode(firstRun, (getTime(runStarts[firstRun + 1]) - getTime(first)).toUint64()));
+		combineRuns(acc, firstRun + 1, lastRun);
+		combine(acc, runNode(lastRun, (getTime(last - 1) - getTime(runStarts[lastRun])).toUint64()));
+	}
+
+	auto value = [&](uint32_t run) {
+		return (run == NO_RUN) ? nullptr : &runValues[run];
+	};
+	return {lastRun - firstRun, value(acc.minRun), value(acc.maxRun), value(acc.dominantRun)};
+}
+
+size_t TraceEvents::getMemoryUsage() const
+{
+	size_t lodSize = 0;
+	for (const auto& level : lod) lodSize += level.capacity() * sizeof(LodNode);
+	return blockTimes.capacity() * sizeof(uint64_t) +
+	       timeOffsets.capacity() * sizeof(uint32_t) +
+	       largeTimes.capacity() * sizeof(LargeTime) +
+	       runStarts.capacity() * sizeof(uint32_t) +
+	       runValues.capacity() * sizeof(TraceValue) +
+	       blockRuns.capacity() * sizeof(uint32_t) +
+	       lodSize;
+}
+
+} // namespace openmsx
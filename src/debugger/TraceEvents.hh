@@ -0,0 +1,231 @@
+#ifndef TRACEEVENTS_HH
+#define TRACEEVENTS_HH
+
+#include "EmuTime.hh"
+#include "TraceValue.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace openmsx {
+
+/** Stores the (time, value) events of one Tracer::Trace.
+  *
+  * Instead of a vector of (time, value) pairs, times and values are stored in
+  * separate columns, each in a more compact form:
+  * - Times are grouped in blocks of BLOCK_SIZE events. Per block the time of
+  *   the first event is stored in full, for the other events only a 32-bit
+  *   offset relative to that. (In the rare case the offset doesn't fit, the
+  *   full time is stored separately.)
+  * - Values are run-length-encoded: consecutive events with the same value
+  *   share a single stored value. E.g. for void traces (like 'z80.accept.IRQ')
+  *   only the times remain.
+  * Random access is still possible: it's a random access range of 'Event'
+  * proxy objects (so binary searching on time still works).
+  *
+  * Additionally a level-of-detail pyramid is maintained (incrementally, while
+  * events are added). It allows to summarize an arbitrary range of events
+  * (number of value changes, min/max value, dominant value) in logarithmic
+  * time. E.g. the trace viewer uses this when many events map to the same
+  * screen pixel.
+  */
+class TraceEvents
+{
+public:
+	struct Event {
+		EmuTime time;
+		const TraceValue& value;
+	};
+
+	/** Summary of a range of events, see summarize(). */
+	struct Summary {
+		size_t transitions = 0;               // number of value changes
+		const TraceValue* min = nullptr;      // smallest and largest numeric (integer
+		const TraceValue* max = nullptr;      // or double) value, nullptr if none
+		const TraceValue* dominant = nullptr; // value that was held the longest
+	};
+
+	static constexpr size_t BLOCK_SIZE = 256;
+
+	class Iterator
+	{
+	public:
+		using difference_type = ptrdiff_t;
+		using value_type = Event;
+		using iterator_category = std::random_access_iterator_tag;
+
+		struct ArrowProxy {
+			Event event;
+			[[nodiscard]] const Event* operator->() const { return &event; }
+		};
+
+		Iterator() = default;
+		Iterator(const TraceEvents& events_, size_t index_)
+			: events(&events_), index(index_)
+			, run(index_ == 0 ? 0 : index_ < events_.size() ? UNKNOWN_RUN : events_.runStarts.size())
+		{
+		}
+
+		[[nodiscard]] Event operator*() const {
+			return {events->getTime(index), events->runValues[getRun()]};
+		}
+		[[nodiscard]] ArrowProxy operator->() const { return {**this}; }
+		[[nodiscard]] Event operator[](difference_type n) const { return *(*this + n); }
+
+		Iterator& operator++() {
+			++index;
+			if ((run != UNKNOWN_RUN) && (run + 1 < events->runStarts.size()) &&
+			    (index >= events->runStarts[run + 1])) ++run;
+			return *this;
+		}
+		Iterator operator++(int) { auto copy = *this; ++*this; return copy; }
+		Iterator& operator--() {
+			--index;
+			if ((run != UNKNOWN_RUN) &&
+			    ((run == events->runStarts.size()) || (index < events->runStarts[run]))) --run;
+			return *this;
+		}
+		Iterator operator--(int) { auto copy = *this; --*this; return copy; }
+
+		Iterator& operator+=(difference_type n) {
+			index += n;
+			if (index >= events->size()) {
+				run = events->runStarts.size();
+			} else if ((run != UNKNOWN_RUN) && !events->inRun(index, run)) {
+				// Only look up the run when it's needed. E.g. a binary
+				// search on time never needs it.
+				run = UNKNOWN_RUN;
+			}
+			return *this;
+		}
+		Iterator& operator-=(difference_type n) { return *this += -n; }
+
+		[[nodiscard]] friend Iterator operator+(Iterator i, difference_type n) { i += n; return i; }
+		[[nodiscard]] friend Iterator operator+(difference_type n, Iterator i) { i += n; return i; }
+		[[nodiscard]] friend Iterator operator-(Iterator i, difference_type n) { i -= n; return i; }
+		[[nodiscard]] friend difference_type operator-(const Iterator& i, const Iterator& j) {
+			return difference_type(i.index) - difference_type(j.index);
+		}
+
+		[[nodiscard]] bool operator==(const Iterator& other) const { return index == other.index; }
+		[[nodiscard]] auto operator<=>(const Iterator& other) const { return index <=> other.index; }
+
+		[[nodiscard]] size_t getIndex() const { return index; }
+
+	private:
+		[[nodiscard]] size_t getRun() const {
+			if (run == UNKNOWN_RUN) run = events->findRun(index);
+			return run;
+		}
+
+		static constexpr size_t UNKNOWN_RUN = size_t(-1);
+
+		const TraceEvents* events = nullptr;
+		size_t index = 0;
+		mutable size_t run = 0; // index in 'runStarts' of the run that contains 'index'
+	};
+
+public:
+	[[nodiscard]] size_t size() const { return timeOffsets.size(); }
+	[[nodiscard]] bool empty() const { return timeOffsets.empty(); }
+
+	[[nodiscard]] Iterator begin() const { return {*this, 0}; }
+	[[nodiscard]] Iterator end() const { return {*this, size()}; }
+	[[nodiscard]] Event operator[](size_t i) const { return *(begin() + ptrdiff_t(i)); }
+	[[nodiscard]] Event front() const { assert(!empty()); return {getTime(0), runValues.front()}; }
+	[[nodiscard]] Event back() const { assert(!empty()); return {getTime(size() - 1), runValues.back()}; }
+
+	[[nodiscard]] EmuTime getTime(size_t i) const {
+		assert(i < size());
+		auto offset = timeOffsets[i];
+		if (offset != LARGE_OFFSET) [[likely]] {
+			return EmuTime::fromUint64(blockTimes[i / BLOCK_SIZE] + offset);
+		}
+		return getLargeTime(i);
+	}
+
+	/** Add an event, 'time' must be >= the time of the last event. */
+	void push_back(EmuTime time, TraceValue value);
+	void clear();
+	/** Remove all events with time >= 'time'. */
+	void truncate(EmuTime time);
+
+	/** Number of value changes within the events [first, last), requires first < last.
+	  * This is a cheaper alternative for 'summarize(first, last).transitions'. */
+	[[nodiscard]] size_t numTransitions(size_t first, size_t last) const {
+		assert(first < last);
+		assert(last <= size());
+		return findRun(last - 1) - findRun(first);
+	}
+	/** Summarize the events with index in [first, last), requires first < last.
+	  * The cost is logarithmic in the number of value changes in that range. */
+	[[nodiscard]] Summary summarize(size_t first, size_t last) const;
+
+	/** Number of stored values (after run-length-encoding). */
+	[[nodiscard]] size_t numRuns() const { return runStarts.size(); }
+	/** Approximation of the amount of memory used (in bytes). */
+	[[nodiscard]] size_t getMemoryUsage() const;
+
+private:
+	[[nodiscard]] size_t findRun(size_t i) const {
+		assert(i < size());
+		// only search the runs that overlap with the block that contains 'i'
+		auto block = i / BLOCK_SIZE;
+		auto first = runStarts.begin() + blockRuns[block];
+		auto last = (block + 1 < blockRuns.size()) ? runStarts.begin() + blockRuns[block + 1] + 1
+		                                           : runStarts.end();
+		auto it = std::upper_bound(first, last, uint32_t(i));
+		assert(it != runStarts.begin());
+		return size_t(std::distance(runStarts.begin(), it)) - 1;
+	}
+	[[nodiscard]] bool inRun(size_t i, size_t run) const {
+		return (run < runStarts.size()) && (i >= runStarts[run]) &&
+		       ((run + 1 == runStarts.size()) || (i < runStarts[run + 1]));
+	}
+	[[nodiscard]] EmuTime getLargeTime(size_t i) const;
+
+	static constexpr uint32_t LARGE_OFFSET = uint32_t(-1);
+	static constexpr uint32_t NO_RUN = uint32_t(-1);
+	static constexpr size_t LOD_FANOUT = 16;
+
+	struct LodNode {
+		uint32_t minRun = NO_RUN;
+		uint32_t maxRun = NO_RUN;
+		uint32_t dominantRun = NO_RUN;
+		uint64_t dominantDuration = 0;
+	};
+	[[nodiscard]] uint64_t runDuration(size_t run) const;
+	[[nodiscard]] LodNode runNode(size_t run, uint64_t duration) const;
+	void combine(LodNode& acc, const LodNode& node) const;
+	void combineRuns(LodNode& acc, size_t first, size_t last) const;
+	void extendLod();
+
+	struct LargeTime {
+		size_t index;
+		EmuTime time;
+	};
+
+	// time column
+	std::vector<uint64_t> blockTimes;  // time of the first event in each block
+	std::vector<uint32_t> timeOffsets; // per event, relative to its block
+	std::vector<LargeTime> largeTimes; // events with offset == LARGE_OFFSET
+	// value column (run-length-encoded)
+	std::vector<uint32_t> runStarts;   // index of the first event of each run
+	std::vector<TraceValue> runValues; // value of each run
+	std::vector<uint32_t> blockRuns;   // run of the first event in each block
+	// Level-of-detail pyramid over the completed runs (all but the last run,
+	// the duration of that one is not yet known). lod[k][i] summarizes the
+	// runs [i * F^(k+1), (i+1) * F^(k+1)) with F = LOD_FANOUT. Only complete
+	// buckets are stored, so existing nodes never need to be updated.
+	std::vector<std::vector<LodNode>> lod;
+};
+
+static_assert(std::random_access_iterator<TraceEvents::Iterator>);
+
+} // namespace openmsx
+
+#endif
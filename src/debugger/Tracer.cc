@@ -47,7 +47,7 @@ void Tracer::Trace::addEvent(EmuTime t, TraceValue v, bool merge)
 		[](std::string_view) { return STRING; }
 	});
 	type = std::max(type, valueFormat);
-	events.emplace_back(t, std::move(v));
+	events.push_back(t, std::move(v));
 }
 
 void Tracer::Trace::clear()
@@ -124,8 +124,7 @@ void Tracer::stopReplay(EmuTime time) noexcept
 {
 	// when replay stops, drop all future events
 	for (auto& trace : traces) {
-		auto it = std::ranges::lower_bound(trace->events, time, {}, &Event::time);
-		trace->events.erase(it, trace->events.end());
+		trace->events.truncate(time);
 	}
 }
 
@@ -252,7 +251,7 @@ void Tracer::list(Command& cmd, std::span<const TclObject> tokens, TclObject& re
 		if (!trace) {
 			throw CommandException("No such trace: ", name);
 		}
-		for (const auto& event : trace->events) {
+		for (auto event : trace->events) {
 			result.addListElement(makeTclList(
 				event.time.toDouble(),
 				toTclObject(event.value)));
@@ -382,7 +381,8 @@ void Tracer::tabCompletion(const Debugger& debugger, std::vector<std::string>& t
 void Tracer::exportVCD(zstring_view filename)
 {
 	// k-way merge using a min-heap over traces to avoid collecting & sorting all events
-	std::vector<size_t> idx(traces.size(), 0);
+	// (sequentially walking TraceEvents is cheap, no need to decode them up front)
+	auto pos = to_vector(std::views::transform(traces, [](const auto& t) { return t->events.begin(); }));
 	using HeapEntry = std::pair<uint64_t, size_t>; // time, trace
 	std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
 	for (size_t i = 0; i < traces.size(); ++i) {
@@ -504,15 +504,14 @@ void Tracer::exportVCD(zstring_view filename)
 			os << '#' << time << '\n';
 		}
 
-		size_t pos = idx[tr];
+		auto& it = pos[tr];
 		const auto& t = *traces[tr];
-		const auto& val = t.events[pos].value;
-		emitValue(t.getType(), tr, val, true);
+		emitValue(t.getType(), tr, it->value, true);
 
-		// advance index and push next event for this trace
-		++idx[tr];
-		if (idx[tr] < t.events.size()) {
-			heap.emplace(t.events[idx[tr]].time.toUint64(), tr);
+		// advance iterator and push next event for this trace
+		++it;
+		if (it != t.events.end()) {
+			heap.emplace(it->time.toUint64(), tr);
 		}
 	}
 }
@@ -4,6 +4,7 @@
 #include "EmuTime.hh"
 #include "StateChangeListener.hh"
 #include "TclObject.hh"
+#include "TraceEvents.hh"
 #include "TraceValue.hh"
 
 #include "Observer.hh"
@@ -21,10 +22,7 @@ class StateChangeDistributor;
 class Tracer final : public StateChangeListener
 {
 public:
-	struct Event {
-		EmuTime time;
-		TraceValue value;
-	};
+	using Event = TraceEvents::Event;
 	struct Trace final : Observer<ProbeBase> {
 		// Type of values seen so far. Ordered from specific to general:
 		enum class Type : uint8_t { MONOSTATE = 0, BOOL = 1, INTEGER = 2, DOUBLE = 3, STRING = 4 };
@@ -49,7 +47,7 @@ public:
 
 		std::string name;
 		std::string description;
-		std::vector<Event> events;
+		TraceEvents events;
 		MSXMotherBoard* motherBoard = nullptr; // non-nullptr if attached to a Probe
 		Type type = Type::MONOSTATE;
 		Format format = Format::DEC;
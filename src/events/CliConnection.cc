@@ -10,8 +10,12 @@
 #include "Event.hh"
 #include "EventDistributor.hh"
 
-#include "CommandController.hh"
 #include "CommandException.hh"
+#include "Debuggable.hh"
+#include "Debugger.hh"
+#include "GlobalCommandController.hh"
+#include "MSXMotherBoard.hh"
+#include "Reactor.hh"
 #include "TclObject.hh"
 #include "XMLEscape.hh"
 
@@ -22,6 +26,7 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cassert>
 #include <iostream>
 
@@ -36,7 +41,7 @@ using namespace std::literals;
 
 // class CliConnection
 
-CliConnection::CliConnection(CommandController& commandController_,
+CliConnection::CliConnection(GlobalCommandController& commandController_,
                              EventDistributor& eventDistributor_)
 	: parser([this](const std::string& cmd) { execute(cmd); })
 	, commandController(commandController_)
@@ -49,9 +54,91 @@ CliConnection::CliConnection(CommandController& commandController_,
 
 CliConnection::~CliConnection()
 {
+	if (!binarySubscriptions.empty()) {
+		eventDistributor.unregisterEventListener(EventType::FINISH_FRAME, *this);
+	}
 	eventDistributor.unregisterEventListener(EventType::CLICOMMAND, *this);
 }
 
+unsigned CliConnection::subscribeBinary(std::string debuggable, unsigned address, unsigned size, bool changedOnly)
+{
+	if (binarySubscriptions.empty()) {
+		eventDistributor.registerEventListener(EventType::FINISH_FRAME, *this);
+	}
+	auto id = ++lastBinarySubscriptionId;
+	binarySubscriptions.push_back(BinarySubscription{
+		id, std::move(debuggable), address, size, changedOnly,
+		MemBuffer<uint8_t>(size), MemBuffer<uint8_t>(changedOnly ? size : 0)});
+	return id;
+}
+
+bool CliConnection::unsubscribeBinary(unsigned id)
+{
+	auto it = std::ranges::find(binarySubscriptions, id, &BinarySubscription::id);
+	if (it == binarySubscriptions.end()) return false;
+	binarySubscriptions.erase(it);
+	if (binarySubscriptions.empty()) {
+		eventDistributor.unregisterEventListener(EventType::FINISH_FRAME, *this);
+	}
+	return true;
+}
+
+void CliConnection::outputBinary(std::optional<unsigned> id, std::string_view debuggable,
+                                 unsigned address, std::span<const uint8_t> data)
+{
+	output(tmpStrCat("<binary",
+	                 strCat_if(id.has_value(), " id=\"", id.value_or(0), '"'),
+	                 " debuggable=\"", XMLEscape(debuggable),
+	                 "\" address=\"", address,
+	                 "\" length=\"", data.size(), "\">"));
+	// send the raw bytes directly, without escaping or copying
+	output(std::string_view(std::bit_cast<const char*>(data.data()), data.size()));
+	output("</binary>\n");
+}
+
+void CliConnection::sendBinarySubscriptions()
+{
+	auto* motherBoard = commandController.getReactor().getMotherBoard();
+	if (!motherBoard) return;
+	auto& debugger = motherBoard->getDebugger();
+
+	static constexpr unsigned CHUNK = 256;
+	for (auto& sub : binarySubscriptions) {
+		// e.g. after switching machines the debuggable may be gone
+		auto* device = debugger.findDebuggable(sub.debuggable);
+		if (!device || (device->getSize() < sub.address + sub.size)) continue;
+
+		if (sub.changedOnly) std::swap(sub.data, sub.prev);
+		device->readBlock(sub.address, sub.data);
+		std::span<const uint8_t> data = sub.data;
+		if (!sub.changedOnly || !sub.sent) {
+			outputBinary(sub.id, sub.debuggable, sub.address, data);
+			sub.sent = true;
+			continue;
+		}
+
+		// only send the changed chunks, adjacent chunks are merged
+		std::span<const uint8_t> prev = sub.prev;
+		auto chunkChanged = [&](unsigned pos) {
+			auto n = std::min(CHUNK, sub.size - pos);
+			return !std::ranges::equal(data.subspan(pos, n), prev.subspan(pos, n));
+		};
+		unsigned pos = 0;
+		while (pos < sub.size) {
+			if (!chunkChanged(pos)) {
+				pos += CHUNK;
+				continue;
+			}
+			auto start = pos;
+			do {
+				pos += CHUNK;
+			} while ((pos < sub.size) && chunkChanged(pos));
+			auto end = std::min(pos, sub.size);
+			outputBinary(sub.id, sub.debuggable, sub.address + start, data.subspan(start, end - start));
+		}
+	}
+}
+
 void CliConnection::log(CliComm::LogLevel level, std::string_view message, float fraction) noexcept
 {
 	std::string fullMessage{message};
@@ -110,6 +197,14 @@ static TemporaryString reply(std::string_view message, bool status)
 
 bool CliConnection::signalEvent(const Event& event)
 {
+	if (getType(event) == EventType::FINISH_FRAME) {
+		// once per frame, only for the active video source
+		if (const auto& ffe = get_event<FinishFrameEvent>(event);
+		    ffe.getSource() == ffe.getSelectedSource()) {
+			sendBinarySubscriptions();
+		}
+		return false;
+	}
 	assert(getType(event) == EventType::CLICOMMAND);
 	if (const auto& commandEvent = get_event<CliCommandEvent>(event);
 	    commandEvent.getId() == this) {
@@ -129,7 +224,7 @@ bool CliConnection::signalEvent(const Event& event)
 // class StdioConnection
 
 static constexpr int BUF_SIZE = 4096;
-StdioConnection::StdioConnection(CommandController& commandController_,
+StdioConnection::StdioConnection(GlobalCommandController& commandController_,
                                  EventDistributor& eventDistributor_)
 	: CliConnection(commandController_, eventDistributor_)
 {
@@ -178,7 +273,7 @@ void StdioConnection::close()
 // but that gives a old-style-cast warning
 static const HANDLE OPENMSX_INVALID_HANDLE_VALUE = reinterpret_cast<HANDLE>(-1);
 
-PipeConnection::PipeConnection(CommandController& commandController_,
+PipeConnection::PipeConnection(GlobalCommandController& commandController_,
                                EventDistributor& eventDistributor_,
                                std::string_view name)
 	: CliConnection(commandController_, eventDistributor_)
@@ -275,7 +370,7 @@ void PipeConnection::close()
 
 // class SocketConnection
 
-SocketConnection::SocketConnection(CommandController& commandController_,
+SocketConnection::SocketConnection(GlobalCommandController& commandController_,
                                    EventDistributor& eventDistributor_,
                                    SOCKET sd_)
 	: CliConnection(commandController_, eventDistributor_)
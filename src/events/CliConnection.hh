@@ -7,17 +7,22 @@
 #include "EventListener.hh"
 #include "Socket.hh"
 
+#include "MemBuffer.hh"
 #include "Poller.hh"
 #include "stl.hh"
 
+#include <cstdint>
 #include <mutex>
+#include <optional>
+#include <span>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace openmsx {
 
-class CommandController;
 class EventDistributor;
+class GlobalCommandController;
 
 class CliConnection : public CliListener, private EventListener
 {
@@ -29,6 +34,30 @@ public:
 		return updateEnabled[type];
 	}
 
+	/** A block of a debuggable that is sent once per frame, see the
+	  * 'openmsx_binary subscribe' command.
+	  */
+	struct BinarySubscription {
+		unsigned id;
+		std::string debuggable;
+		unsigned address;
+		unsigned size;
+		bool changedOnly;
+		MemBuffer<uint8_t> data; // content that was last sent
+		MemBuffer<uint8_t> prev; // only used for 'changedOnly'
+		bool sent = false;       // was 'data' sent at least once
+	};
+	unsigned subscribeBinary(std::string debuggable, unsigned address, unsigned size, bool changedOnly);
+	bool unsubscribeBinary(unsigned id);
+	[[nodiscard]] const auto& getBinarySubscriptions() const { return binarySubscriptions; }
+
+	/** Send a block of binary data, it's framed as
+	  *   <binary [id="<id>"] debuggable="<name>" address="<addr>" length="<n>">
+	  * followed by exactly <n> raw (not escaped) bytes and '</binary>'.
+	  */
+	void outputBinary(std::optional<unsigned> id, std::string_view debuggable,
+	                  unsigned address, std::span<const uint8_t> data);
+
 	/** Starts the helper thread.
 	  * Called when this CliConnection is added to GlobalCliComm (and
 	  * after it's allowed to respond to external commands).
@@ -37,7 +66,7 @@ public:
 	void start();
 
 protected:
-	CliConnection(CommandController& commandController,
+	CliConnection(GlobalCommandController& commandController,
 	              EventDistributor& eventDistributor);
 	~CliConnection() override;
 
@@ -74,21 +103,26 @@ private:
 	void update(CliComm::UpdateType type, std::string_view machine,
 	            std::string_view name, std::string_view value) noexcept override;
 
+	void sendBinarySubscriptions();
+
 	// EventListener
 	bool signalEvent(const Event& event) override;
 
-	CommandController& commandController;
+	GlobalCommandController& commandController;
 	EventDistributor& eventDistributor;
 
 	std::thread thread;
 
 	array_with_enum_index<CliComm::UpdateType, bool> updateEnabled;
+
+	std::vector<BinarySubscription> binarySubscriptions;
+	unsigned lastBinarySubscriptionId = 0;
 };
 
 class StdioConnection final : public CliConnection
 {
 public:
-	StdioConnection(CommandController& commandController,
+	StdioConnection(GlobalCommandController& commandController,
 	                EventDistributor& eventDistributor);
 	~StdioConnection() override;
 
@@ -103,7 +137,7 @@ private:
 class PipeConnection final : public CliConnection
 {
 public:
-	PipeConnection(CommandController& commandController,
+	PipeConnection(GlobalCommandController& commandController,
 	               EventDistributor& eventDistributor,
 	               std::string_view name);
 	~PipeConnection() override;
@@ -122,7 +156,7 @@ private:
 class SocketConnection final : public CliConnection
 {
 public:
-	SocketConnection(CommandController& commandController,
+	SocketConnection(GlobalCommandController& commandController,
 	                 EventDistributor& eventDistributor,
 	                 SOCKET sd);
 	~SocketConnection() override;
@@ -9,14 +9,14 @@
 
 namespace openmsx {
 
-class CommandController;
 class EventDistributor;
 class GlobalCliComm;
+class GlobalCommandController;
 
 class CliServer final
 {
 public:
-	CliServer(CommandController& commandController,
+	CliServer(GlobalCommandController& commandController,
 	          EventDistributor& eventDistributor,
 	          GlobalCliComm& cliComm);
 	~CliServer();
@@ -27,7 +27,7 @@ private:
 	void exitAcceptLoop();
 
 private:
-	CommandController& commandController;
+	GlobalCommandController& commandController;
 	EventDistributor& eventDistributor;
 	GlobalCliComm& cliComm;
 
@@ -8,6 +8,7 @@
 #include "xxhash.hh"
 
 #include <cstring>
+#include <mutex>
 
 namespace openmsx {
 
@@ -18,6 +19,10 @@ struct GetURLFromDecompressed {
 };
 static hash_set<std::unique_ptr<CompressedFileAdapter::Decompressed>,
                 GetURLFromDecompressed, XXHasher> decompressCache;
+// Files can be opened from multiple threads (e.g. the filepool calculates
+// sha1sums in parallel). This protects 'decompressCache' and the 'useCount'
+// of its elements.
+static std::mutex decompressCacheMutex;
 
 
 CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_, zstring_view filename_)
@@ -29,6 +34,7 @@ CompressedFileAdapter::CompressedFileAdapter(std::unique_ptr<FileBase> file_, zs
 CompressedFileAdapter::~CompressedFileAdapter()
 {
 	if (decompressed) {
+		std::scoped_lock lock(decompressCacheMutex);
 		auto it = decompressCache.find(decompressed->cachedURL);
 		assert(it != end(decompressCache));
 		assert(it->get() == decompressed);
@@ -44,16 +50,35 @@ void CompressedFileAdapter::decompress()
 {
 	if (decompressed) return;
 
-	auto it = decompressCache.find(filename);
-	if (it == end(decompressCache)) {
-		auto d = std::make_unique<Decompressed>();
-		decompress(*file, *d);
-		d->cachedModificationDate = getModificationDate();
-		d->cachedURL = filename;
-		it = decompressCache.insert_noDuplicateCheck(std::move(d));
+	auto use = [&](auto it) {
+		++(*it)->useCount;
+		decompressed = it->get();
+	};
+	{
+		std::scoped_lock lock(decompressCacheMutex);
+		if (auto it = decompressCache.find(filename); it != end(decompressCache)) {
+			use(it);
+			file.reset();
+			return;
+		}
+	}
+
+	// Don't hold the lock while decompressing, so that different files
+	// can be decompressed in parallel.
+	auto d = std::make_unique<Decompressed>();
+	decompress(*file, *d);
+	d->cachedModificationDate = getModificationDate();
+	d->cachedURL = filename;
+	{
+		std::scoped_lock lock(decompressCacheMutex);
+		// Another thread may have decompressed the same file in the
+		// meantime, if so use that one.
+		auto it = decompressCache.find(filename);
+		if (it == end(decompressCache)) {
+			it = decompressCache.insert_noDuplicateCheck(std::move(d));
+		}
+		use(it);
 	}
-	++(*it)->useCount;
-	decompressed = it->get();
 
 	// close original file after successful decompress
 	file.reset();
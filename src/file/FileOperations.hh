@@ -75,6 +75,10 @@ namespace openmsx::FileOperations {
 	  */
 	int deleteRecursive(zstring_view path);
 
+	/** Rename a file, (atomically) replaces 'to' if it already exists.
+	  */
+	int rename(zstring_view from, zstring_view to);
+
 	/** Call fopen() in a platform-independent manner
 	  * @param filename the file path
 	  * @param mode the mode parameter, same as fopen
@@ -1,20 +1,38 @@
 #include "FilePoolCore.hh"
 
 #include "FileException.hh"
+#include "WorkerThreads.hh"
 #include "foreach_file.hh"
 
 #include "Date.hh"
 #include "Timer.hh"
+#include "narrow.hh"
 #include "one_of.hh"
 #include "ranges.hh"
+#include "xrange.hh"
 
 #include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
 #include <fstream>
 #include <optional>
+#include <ranges>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 
 namespace openmsx {
 
+// Number of files for which the sha1sum is calculated in parallel.
+static constexpr size_t BATCH_SIZE = 64;
+
+// The sha1sum of (large) files is calculated in several steps so that we can
+// show progress information (and abort) in between. We take a fixed step size
+// for an efficient calculation.
+static constexpr size_t STEP_SIZE = 1024 * 1024; // 1MB
+
 struct GetSha1 {
 	const FilePoolCore::Pool& pool;
 
@@ -51,7 +69,7 @@ void FilePoolCore::insert(const Sha1Sum& sum, time_t time, std::string_view file
 	auto idx = pool.emplace(sum, time, stringBuffer.back()).idx;
 	auto it = std::ranges::upper_bound(sha1Index, sum, {}, GetSha1{pool});
 	sha1Index.insert(it, idx);
-	filenameIndex.insert(idx);
+	if (filenameIndexBuilt) filenameIndex.insert(idx);
 	needWrite = true;
 }
 
@@ -165,47 +183,166 @@ static std::optional<std::tuple<Sha1Sum, const char*, std::string_view>> parse(
 	return std::tuple{sha1, timeStr, filename};
 }
 
+// The .filecache file used to be a text file, with one line per entry. It's
+// now stored in a binary format that can be used (memory mapped) without
+// parsing (lookups directly search the sorted array of records):
+// - a header (see below)
+// - an array of 'CacheRecord's, sorted on sha1sum
+// - all filenames, concatenated
+// All values are stored in native byte order (it's a cache, it doesn't need to
+// be portable). The text format can still be read (it's converted to the
+// binary format on exit).
+static constexpr std::string_view CACHE_MAGIC = "openMSXfilecache";
+static constexpr uint32_t CACHE_VERSION = 1;
+static constexpr uint32_t CACHE_BYTE_ORDER = 0x01020304;
+struct CacheHeader {
+	std::array<char, 16> magic;
+	uint32_t version;
+	uint32_t byteOrder;
+	uint64_t count;
+};
+struct CacheRecord {
+	Sha1Sum sum;
+	uint32_t nameLen;
+	int64_t time;
+	uint64_t nameOffset; // relative to the start of the filenames
+};
+static_assert(std::is_trivially_copyable_v<Sha1Sum> && (sizeof(Sha1Sum) == 20));
+static_assert(sizeof(CacheHeader) == 32);
+static_assert(sizeof(CacheRecord) == 40);
+
+[[nodiscard]] static bool isBinaryCache(std::span<const uint8_t> data)
+{
+	return (data.size() >= sizeof(CacheHeader)) &&
+	       std::ranges::equal(data.first(CACHE_MAGIC.size()), CACHE_MAGIC, {}, {},
+	                          [](char c) { return uint8_t(c); });
+}
+
 void FilePoolCore::readSha1sums()
 {
 	assert(sha1Index.empty());
 	assert(fileMem.empty());
 
 	File file(fileCache);
-	auto size = file.getSize();
+	auto data = file.mmap<const uint8_t>();
+	if (isBinaryCache({data.data(), data.size()})) {
+		fileMap = std::move(data);
+		readSha1sumsBinary({fileMap.data(), fileMap.size()});
+		return;
+	}
+	readSha1sumsText({data.data(), data.size()});
+
+	if (!std::ranges::is_sorted(sha1Index, {}, GetSha1{pool})) {
+		// This should _rarely_ happen. In fact it should only happen
+		// when .filecache was manually edited. Though because it's
+		// very important that pool is indeed sorted I've added this
+		// safety mechanism.
+		std::ranges::sort(sha1Index, {}, GetSha1{pool});
+	}
+
+	// 'pool' is populated, 'sha1Index' is sorted. 'filenameIndex' is only
+	// built when it's needed, looking up files via their sha1sum (the
+	// common case when starting openMSX) doesn't need it.
+}
+
+void FilePoolCore::readSha1sumsText(std::span<const uint8_t> data)
+{
+	auto size = data.size();
 	fileMem.resize(size + 1);
-	file.read(fileMem.first(size));
+	copy_to_range(data, std::span{std::bit_cast<uint8_t*>(fileMem.data()), size});
 	fileMem[size] = '\n'; // ensure there's always a '\n' at the end
 
 	// Process each line.
 	// Assume lines are separated by "\n", "\r\n" or "\n\r" (but not "\r").
-	auto* data = fileMem.begin();
-	auto* data_end = fileMem.end();
-	while (data != data_end) {
+	auto* line = fileMem.begin();
+	auto* line_end = fileMem.end();
+	while (line != line_end) {
 		// memchr() seems better optimized than std::find_if()
-		auto* it = static_cast<char*>(memchr(data, '\n', data_end - data));
-		if (it == nullptr) it = data_end;
-		if ((it != data) && (it[-1] == '\r')) --it;
+		auto* it = static_cast<char*>(memchr(line, '\n', line_end - line));
+		if (it == nullptr) it = line_end;
+		if ((it != line) && (it[-1] == '\r')) --it;
 
-		if (auto r = parse({data, it})) {
+		if (auto r = parse({line, it})) {
 			auto [sum, timeStr, filename] = *r;
 			sha1Index.push_back(pool.emplace(sum, timeStr, filename).idx);
 			// sha1Index not yet guaranteed sorted
 		}
 
-		data = std::find_if(it + 1, data_end, [](char c) {
+		line = std::find_if(it + 1, line_end, [](char c) {
 			return c != one_of('\n', '\r');
 		});
 	}
+}
 
-	if (!std::ranges::is_sorted(sha1Index, {}, GetSha1{pool})) {
-		// This should _rarely_ happen. In fact it should only happen
-		// when .filecache was manually edited. Though because it's
-		// very important that pool is indeed sorted I've added this
-		// safety mechanism.
-		std::ranges::sort(sha1Index, {}, GetSha1{pool});
+void FilePoolCore::readSha1sumsBinary(std::span<const uint8_t> data)
+{
+	// Only check the header, the records are used in-place, see getRecord().
+	CacheHeader header;
+	memcpy(&header, data.data(), sizeof(header));
+	if ((header.version != CACHE_VERSION) || (header.byteOrder != CACHE_BYTE_ORDER)) {
+		return; // ignore, will be rebuilt
 	}
+	auto records = data.subspan(sizeof(header));
+	if ((header.count > (records.size() / sizeof(CacheRecord))) ||
+	    (header.count >= RecordIndex(-1))) {
+		return; // corrupt, ignore
+	}
+	numRecords = RecordIndex(header.count);
+	cacheRecords = records.first(numRecords * sizeof(CacheRecord));
+	cacheNames = records.subspan(numRecords * sizeof(CacheRecord));
+}
+
+// Returns the record, or nothing if it was removed or if it's corrupt.
+std::optional<FilePoolCore::Record> FilePoolCore::getRecord(RecordIndex r) const
+{
+	assert(r < numRecords);
+	if (!removedRecords.empty() && removedRecords[r]) return {};
+	CacheRecord rec;
+	memcpy(&rec, &cacheRecords[r * sizeof(CacheRecord)], sizeof(rec));
+	if ((rec.nameOffset > cacheNames.size()) ||
+	    (rec.nameLen > (cacheNames.size() - rec.nameOffset)) ||
+	    (rec.time == Date::INVALID_TIME_T)) {
+		return {};
+	}
+	return Record{
+		.sum = rec.sum,
+		.time = time_t(rec.time),
+		.filename = std::string_view(std::bit_cast<const char*>(cacheNames.data() + rec.nameOffset), rec.nameLen)};
+}
+
+std::string_view FilePoolCore::getRecordFilename(RecordIndex r) const
+{
+	// only called for records in 'recordNameIndex', those are valid
+	auto rec = getRecord(r);
+	assert(rec);
+	return rec->filename;
+}
+
+Sha1Sum FilePoolCore::getRecordSum(RecordIndex r) const
+{
+	Sha1Sum sum(Sha1Sum::UninitializedTag{});
+	memcpy(&sum, &cacheRecords[r * sizeof(CacheRecord) + offsetof(CacheRecord, sum)], sizeof(sum));
+	return sum;
+}
+
+void FilePoolCore::removeRecord(RecordIndex r)
+{
+	if (filenameIndexBuilt) {
+		// (in case of duplicate filenames, only the first is in the index)
+		if (auto* it = recordNameIndex.find(r); it && (*it == r)) {
+			recordNameIndex.erase(r);
+		}
+	}
+	if (removedRecords.empty()) removedRecords.resize(numRecords);
+	removedRecords[r] = true;
+	needWrite = true;
+}
+
+void FilePoolCore::buildFilenameIndex()
+{
+	if (filenameIndexBuilt) return;
+	filenameIndexBuilt = true;
 
-	// 'pool' is populated, 'sha1Index' is sorted, now build 'filenameIndex'
 	auto n = sha1Index.size();
 	filenameIndex.reserve(n);
 	while (n != 0) { // sha1Index might change while iterating ...
@@ -218,27 +355,73 @@ void FilePoolCore::readSha1sums()
 			remove(idx);
 		}
 	}
+
+	recordNameIndex.reserve(numRecords);
+	for (auto r : xrange(numRecords)) {
+		if (!getRecord(r)) continue;
+		bool inserted = recordNameIndex.insert(r);
+		if (!inserted) {
+			// ERROR: same as above
+			removeRecord(r);
+		}
+	}
 }
 
 void FilePoolCore::writeSha1sums()
 {
-	std::ofstream file;
-	FileOperations::openOfStream(file, fileCache);
-	if (!file.is_open()) {
-		return;
-	}
-	for (auto idx : sha1Index) {
-		const auto& entry = pool[idx];
-		file << entry.sum << "  ";
-		if (entry.timeStr) {
-			file << entry.timeStr;
-		} else {
-			assert(entry.time != Date::INVALID_TIME_T);
-			std::array<char, 24> buf;
-			file << Date::toString(entry.time, buf);
+	// Write to a temporary file and then rename it. Entries still point
+	// into the (memory mapped) old file, so we can't overwrite it in place.
+	auto tmpName = fileCache + ".tmp";
+	{
+		std::ofstream file;
+		FileOperations::openOfStream(file, tmpName, std::ios::binary);
+		if (!file.is_open()) {
+			return;
+		}
+
+		// Merge the entries in 'pool' with the (remaining) records of
+		// the old file.
+		std::vector<Record> all;
+		all.reserve(sha1Index.size() + numRecords);
+		for (auto idx : sha1Index) {
+			auto& entry = pool[idx];
+			auto time = entry.getTime();
+			if (time == Date::INVALID_TIME_T) continue;
+			all.push_back({.sum = entry.sum, .time = time, .filename = entry.filename});
+		}
+		for (auto r : xrange(numRecords)) {
+			if (auto rec = getRecord(r)) all.push_back(*rec);
+		}
+		std::ranges::sort(all, {}, &Record::sum);
+
+		CacheHeader header;
+		copy_to_range(CACHE_MAGIC, header.magic);
+		header.version = CACHE_VERSION;
+		header.byteOrder = CACHE_BYTE_ORDER;
+		header.count = all.size();
+		file.write(std::bit_cast<const char*>(&header), sizeof(header));
+
+		uint64_t nameOffset = 0;
+		for (const auto& rec : all) {
+			CacheRecord r;
+			r.sum = rec.sum;
+			r.nameLen = narrow<uint32_t>(rec.filename.size());
+			r.time = rec.time;
+			r.nameOffset = nameOffset;
+			file.write(std::bit_cast<const char*>(&r), sizeof(r));
+			nameOffset += r.nameLen;
+		}
+		for (const auto& rec : all) {
+			file.write(rec.filename.data(), narrow<std::streamsize>(rec.filename.size()));
+		}
+		if (!file) {
+			file.close();
+			FileOperations::unlink(tmpName);
+			return;
 		}
-		file << "  " << entry.filename << '\n';
 	}
+	fileMap = {}; // (windows) can't replace a file that's still mapped
+	FileOperations::rename(tmpName, fileCache);
 }
 
 FilePoolCore::Result FilePoolCore::getFile(FileType fileType, const Sha1Sum& sha1sum)
@@ -273,9 +456,7 @@ FilePoolCore::Result FilePoolCore::getFile(FileType fileType, const Sha1Sum& sha
 Sha1Sum FilePoolCore::calcSha1sum(File& file, std::string_view filename) const
 {
 	// Calculate sha1 in several steps so that we can show progress
-	// information. We take a fixed step size for an efficient calculation.
-	constexpr size_t STEP_SIZE = 1024 * 1024; // 1MB
-
+	// information.
 	auto data = file.mmap<const uint8_t>();
 
 	SHA1 sha1;
@@ -363,6 +544,34 @@ FilePoolCore::Result FilePoolCore::getFromPool(const Sha1Sum& sha1sum)
 			--last;
 		}
 	}
+
+	// Also search the records in the binary .filecache.
+	auto records = std::views::iota(RecordIndex(0), numRecords);
+	auto [rb, re] = std::ranges::equal_range(records, sha1sum, {},
+		[&](RecordIndex r) { return getRecordSum(r); });
+	for (auto r : std::ranges::subrange(rb, re)) {
+		auto rec = getRecord(r);
+		if (!rec) continue; // removed or corrupt
+		try {
+			File file(std::string(rec->filename));
+			auto newTime = file.getModificationDate();
+			if (rec->time == newTime) {
+				return {.file = std::move(file), .filename = std::string(rec->filename)};
+			}
+			// Entry changed: replace record with an entry in 'pool'
+			// (with the new timestamp and recalculated sha1sum).
+			auto newSum = calcSha1sum(file, rec->filename);
+			removeRecord(r);
+			insert(newSum, newTime, rec->filename);
+			if (newSum == sha1sum) {
+				return {.file = std::move(file), .filename = std::string(rec->filename)};
+			}
+		} catch (FileException&) {
+			// Error reading file: remove from db and continue
+			// searching.
+			removeRecord(r);
+		}
+	}
 	return {}; // not found
 }
 
@@ -383,6 +592,10 @@ FilePoolCore::Result FilePoolCore::scanDirectory(
 		return !result.file.is_open(); // abort traversal when found
 	};
 	foreach_file_recursive(directory, fileAction);
+	if (!result.file.is_open() && !stop) {
+		result = processPending(sha1sum, poolPath, progress);
+	}
+	progress.pending.clear();
 	return result;
 }
 
@@ -405,82 +618,217 @@ FilePoolCore::Result FilePoolCore::scanFile(const Sha1Sum& sha1sum, zstring_view
 	}
 
 	auto time = FileOperations::getModificationDate(st);
-	if (auto [idx, entry] = findInDatabase(filename); idx == Index(-1)) {
-		// not in pool
-		try {
-			File file(filename);
-			auto sum = calcSha1sum(file, filename);
-			insert(sum, time, filename);
-			if (sum == sha1sum) {
-				return {.file = std::move(file), .filename = std::string(filename)};
-			}
-		} catch (FileException&) {
-			// ignore
-		}
-	} else {
+	std::optional<FileId> id;
+	if (st.st_ino != 0) { // e.g. always zero on windows
+		id = FileId{.dev = uint64_t(st.st_dev), .ino = uint64_t(st.st_ino),
+		            .size = uint64_t(st.st_size), .time = time};
+	}
+
+	auto db = findInDatabase(filename);
+	if (db.found()) {
 		// already in pool
-		assert(filename == entry->filename);
-		try {
-			if (entry->getTime() == time) {
-				// db is still up to date
-				if (entry->sum == sha1sum) {
+		if (db.time == time) {
+			// db is still up to date
+			if (id) progress.knownSums.try_emplace(*id, db.sum);
+			if (db.sum == sha1sum) {
+				try {
 					return {.file = File(filename), .filename = std::string(filename)};
-				}
-			} else {
-				// db outdated
-				File file(filename);
-				auto sum = calcSha1sum(file, filename);
-				entry->setTime(time);
-				adjustSha1(idx, *entry, sum);
-				if (sum == sha1sum) {
-					return {.file = std::move(file), .filename = std::string(filename)};
+				} catch (FileException&) {
+					// error reading file, remove from db
+					removeFromDatabase(db);
 				}
 			}
+			return {};
+		}
+	}
+
+	if (id) {
+		if (auto it = progress.knownSums.find(*id); it != progress.knownSums.end()) {
+			// Same file as one we've already seen (e.g. a hard link),
+			// no need to calculate the sha1sum again.
+			auto sum = it->second;
+			updateDatabase(db, filename, time, sum);
+			return checkSum(sha1sum, sum, filename);
+		}
+	}
+
+	// Not in pool or db outdated: (re)calculate the sha1sum. This is
+	// batched, so that it can be done in parallel.
+	auto& pending = progress.pending;
+	PendingFile p{.filename = std::string(filename), .time = time, .id = id};
+	if (id) {
+		auto it = std::ranges::find(pending, id, &PendingFile::id);
+		if (it != pending.end()) p.dupOf = std::distance(pending.begin(), it);
+	}
+	pending.push_back(std::move(p));
+	if (pending.size() < BATCH_SIZE) return {};
+	auto result = processPending(sha1sum, poolPath, progress);
+	pending.clear();
+	return result;
+}
+
+FilePoolCore::Result FilePoolCore::checkSum(
+	const Sha1Sum& sha1sum, const Sha1Sum& sum, zstring_view filename)
+{
+	if (sum != sha1sum) return {};
+	try {
+		return {.file = File(filename), .filename = std::string(filename)};
+	} catch (FileException&) {
+		return {};
+	}
+}
+
+FilePoolCore::Result FilePoolCore::processPending(
+	const Sha1Sum& sha1sum, std::string_view poolPath, ScanProgress& progress)
+{
+	auto& pending = progress.pending;
+	if (pending.empty()) return {};
+
+	// Calculate the sha1sums in parallel: on a few helper threads plus
+	// this thread. Like in calcSha1sum() this is done in steps. In between
+	// the steps this thread reports progress (the callback can set 'stop').
+	if (!workers) {
+		workers = std::make_unique<WorkerThreads>(
+			std::max(std::thread::hardware_concurrency(), 1u) - 1);
+	}
+	struct Hasher {
+		File file; // keep alive, 'data' might point to its (decompressed) content
+		MappedFile<const uint8_t> data;
+		SHA1 sha1;
+		size_t done = 0;
+	};
+	std::vector<Hasher> hashers(pending.size());
+	std::vector<size_t> todo; // indices in 'pending' that still need work
+	for (auto i : xrange(pending.size())) {
+		if (pending[i].dupOf == size_t(-1)) todo.push_back(i);
+	}
+	workers->run(todo.size(), [&](size_t j) {
+		auto& h = hashers[todo[j]];
+		try {
+			h.file = File(pending[todo[j]].filename);
+			h.data = h.file.mmap<const uint8_t>();
 		} catch (FileException&) {
+			h.file = File(); // error reading file, p.ok remains false
+		}
+	});
+	std::erase_if(todo, [&](size_t i) { return !hashers[i].file.is_open(); });
+	uint64_t totalSize = 0;
+	for (auto i : todo) totalSize += hashers[i].data.size();
+
+	while (!todo.empty()) {
+		uint64_t doneSize = 0;
+		for (const auto& h : hashers) doneSize += h.done;
+		if (auto now = Timer::getTime();
+		    now > (progress.lastTime + 250'000)) { // 4Hz
+			progress.lastTime = now;
+			progress.printed = true;
+			reportProgress(tmpStrCat(
+				"Searching for file with sha1sum ", sha1sum,
+				"...\nIndexing filepool ", poolPath, ": [",
+				progress.amountScanned, "]: calculating sha1sums ",
+				pending.size() - todo.size(), '/', pending.size()),
+				totalSize ? float(doneSize) / float(totalSize) : 0.0f);
+		}
+		if (stop) return {};
+
+		workers->run(todo.size(), [&](size_t j) {
+			auto i = todo[j];
+			auto& h = hashers[i];
+			auto n = std::min(STEP_SIZE, h.data.size() - h.done);
+			h.sha1.update({h.data.data() + h.done, n});
+			h.done += n;
+			if (h.done == h.data.size()) {
+				auto& p = pending[i];
+				p.sum = h.sha1.digest();
+				p.ok = true;
+			}
+		});
+		std::erase_if(todo, [&](size_t i) { return pending[i].ok; });
+	}
+
+	// Update the database (in the original order).
+	Result result;
+	for (auto& p : pending) {
+		if (p.dupOf != size_t(-1)) {
+			const auto& orig = pending[p.dupOf];
+			p.sum = orig.sum;
+			p.ok = orig.ok;
+		}
+		auto db = findInDatabase(p.filename);
+		if (!p.ok) {
 			// error reading file, remove from db
-			remove(idx, *entry);
+			removeFromDatabase(db);
+			continue;
+		}
+		if (p.id) progress.knownSums.try_emplace(*p.id, p.sum);
+		updateDatabase(db, p.filename, p.time, p.sum);
+		if (!result.file.is_open()) {
+			result = checkSum(sha1sum, p.sum, p.filename);
 		}
 	}
-	return {}; // not found
+	return result;
 }
 
-std::pair<FilePoolCore::Index, FilePoolCore::Entry*> FilePoolCore::findInDatabase(std::string_view filename)
+FilePoolCore::DbEntry FilePoolCore::findInDatabase(std::string_view filename)
 {
-	auto it = filenameIndex.find(filename);
-	if (!it) return {Index(-1), nullptr};
+	buildFilenameIndex();
+	if (auto it = filenameIndex.find(filename)) {
+		Index idx = *it;
+		auto& entry = pool[idx];
+		assert(entry.filename == filename);
+		if (entry.getTime() == Date::INVALID_TIME_T) {
+			// invalid date/time string, remove from db
+			remove(idx, entry);
+			return {};
+		}
+		return {.idx = idx, .sum = entry.sum, .time = entry.getTime()};
+	}
+	if (auto it = recordNameIndex.find(filename)) {
+		RecordIndex r = *it;
+		auto rec = getRecord(r);
+		assert(rec && (rec->filename == filename));
+		return {.record = r, .sum = rec->sum, .time = rec->time};
+	}
+	return {};
+}
 
-	Index idx = *it;
-	auto& entry = pool[idx];
-	assert(entry.filename == filename);
-	if (entry.getTime() == Date::INVALID_TIME_T) {
-		// invalid date/time string, remove from db
-		remove(idx, entry);
-		return {Index(-1), nullptr};
+void FilePoolCore::removeFromDatabase(const DbEntry& db)
+{
+	if (db.idx != Index(-1)) {
+		remove(db.idx);
+	} else if (db.record != RecordIndex(-1)) {
+		removeRecord(db.record);
+	}
+}
+
+void FilePoolCore::updateDatabase(const DbEntry& db, std::string_view filename, time_t time, const Sha1Sum& sum)
+{
+	if (db.idx != Index(-1)) {
+		// was already in pool, but with wrong timestamp (and sha1sum)
+		auto& entry = pool[db.idx];
+		entry.setTime(time);
+		adjustSha1(db.idx, entry, sum);
+	} else {
+		// was not yet in pool (possibly in the binary .filecache), insert new entry
+		if (db.record != RecordIndex(-1)) removeRecord(db.record);
+		insert(sum, time, filename);
 	}
-	return {idx, &entry};
 }
 
 Sha1Sum FilePoolCore::getSha1Sum(File& file, std::string_view filename)
 {
 	auto time = file.getModificationDate();
 
-	auto [idx, entry] = findInDatabase(filename);
-	if ((idx != Index(-1)) && (entry->getTime() == time)) {
+	auto db = findInDatabase(filename);
+	if (db.found() && (db.time == time)) {
 		// in database and modification time matches,
 		// assume sha1sum also matches
-		return entry->sum;
+		return db.sum;
 	}
 
 	// not in database or timestamp mismatch
 	auto sum = calcSha1sum(file, filename);
-	if (idx == Index(-1)) {
-		// was not yet in database, insert new entry
-		insert(sum, time, filename);
-	} else {
-		// was already in database, but with wrong timestamp (and sha1sum)
-		entry->setTime(time);
-		adjustSha1(idx, *entry, sum);
-	}
+	updateDatabase(db, filename, time, sum);
 	return sum;
 }
 
@@ -3,6 +3,7 @@
 
 #include "File.hh"
 #include "FileOperations.hh"
+#include "MappedFile.hh"
 
 #include "MemBuffer.hh"
 #include "ObjectPool.hh"
@@ -10,10 +11,15 @@
 #include "sha1.hh"
 #include "xxhash.hh"
 
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <ctime>
 #include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -21,6 +27,7 @@
 namespace openmsx {
 
 class File;
+class WorkerThreads;
 
 enum class FileType : uint8_t {
 	NONE = 0,
@@ -76,10 +83,32 @@ public:
 	void abort() { stop = true; }
 
 private:
+	// Identifies the content of a file (on systems that have inodes):
+	// hard links or symlinks to the same file have the same id.
+	struct FileId {
+		uint64_t dev;
+		uint64_t ino;
+		uint64_t size;
+		time_t time;
+		[[nodiscard]] auto operator<=>(const FileId&) const = default;
+	};
+	// A file that needs a (new) sha1sum calculation.
+	struct PendingFile {
+		std::string filename;
+		time_t time;
+		std::optional<FileId> id;
+		size_t dupOf = size_t(-1); // same file as an earlier entry in the batch
+		Sha1Sum sum = {};
+		bool ok = false; // sha1sum was successfully calculated
+	};
+
 	struct ScanProgress {
 		uint64_t lastTime;
 		unsigned amountScanned = 0;
 		bool printed = false;
+
+		std::vector<PendingFile> pending = {}; // sha1sum calculation is batched
+		std::map<FileId, Sha1Sum> knownSums = {}; // already calculated (or cached)
 	};
 
 	struct Entry {
@@ -109,6 +138,27 @@ private:
 	using Index = Pool::Index;
 	using Sha1Index = std::vector<Index>; // sorted on sha1sum
 
+	// An entry in the (memory mapped) binary .filecache.
+	struct Record {
+		Sha1Sum sum;
+		time_t time;
+		std::string_view filename;
+	};
+	using RecordIndex = uint32_t;
+
+	// Result of a lookup via filename: either an entry in 'pool', or a
+	// record in the binary .filecache (or neither when not found).
+	struct DbEntry {
+		Index idx = Index(-1);
+		RecordIndex record = RecordIndex(-1);
+		Sha1Sum sum = {};
+		time_t time = Date::INVALID_TIME_T;
+
+		[[nodiscard]] bool found() const {
+			return (idx != Index(-1)) || (record != RecordIndex(-1));
+		}
+	};
+
 	class FilenameIndexHelper {
 	public:
 		explicit FilenameIndexHelper(const Pool& p) : pool(p) {}
@@ -134,6 +184,31 @@ private:
 	// Hash indexed by filename, points to a full object in 'pool'
 	using FilenameIndex = SimpleHashSet<Index(-1), FilenameIndexHash, FilenameIndexEqual>;
 
+	class RecordNameIndexHelper {
+	public:
+		explicit RecordNameIndexHelper(const FilePoolCore& c) : core(c) {}
+		[[nodiscard]] std::string_view get(std::string_view s) const { return s; }
+		[[nodiscard]] std::string_view get(RecordIndex r) const { return core.getRecordFilename(r); }
+	private:
+		const FilePoolCore& core;
+	};
+	struct RecordNameIndexHash : RecordNameIndexHelper {
+		using RecordNameIndexHelper::RecordNameIndexHelper;
+		template<typename T> [[nodiscard]] auto operator()(T t) const {
+			XXHasher hasher;
+			return hasher(get(t));
+		}
+	};
+	struct RecordNameIndexEqual : RecordNameIndexHelper {
+		using RecordNameIndexHelper::RecordNameIndexHelper;
+		template<typename T1, typename T2>
+		[[nodiscard]] bool operator()(T1 x, T2 y) const {
+			return get(x) == get(y);
+		}
+	};
+	// Hash indexed by filename, points to a record in the binary .filecache
+	using RecordNameIndex = SimpleHashSet<RecordIndex(-1), RecordNameIndexHash, RecordNameIndexEqual>;
+
 private:
 	void insert(const Sha1Sum& sum, time_t time, std::string_view filename);
 	[[nodiscard]] Sha1Index::iterator getSha1Iterator(Index idx, const Entry& entry);
@@ -143,8 +218,19 @@ private:
 	bool adjustSha1(Sha1Index::iterator it, Entry& entry, const Sha1Sum& newSum);
 	bool adjustSha1(Index idx,              Entry& entry, const Sha1Sum& newSum);
 
+	[[nodiscard]] std::optional<Record> getRecord(RecordIndex r) const;
+	[[nodiscard]] std::string_view getRecordFilename(RecordIndex r) const;
+	[[nodiscard]] Sha1Sum getRecordSum(RecordIndex r) const;
+	void removeRecord(RecordIndex r);
+
+	void removeFromDatabase(const DbEntry& db);
+	void updateDatabase(const DbEntry& db, std::string_view filename, time_t time, const Sha1Sum& sum);
+
 	void readSha1sums();
+	void readSha1sumsText(std::span<const uint8_t> data);
+	void readSha1sumsBinary(std::span<const uint8_t> data);
 	void writeSha1sums();
+	void buildFilenameIndex();
 
 	[[nodiscard]] Result getFromPool(const Sha1Sum& sha1sum);
 	[[nodiscard]] Result scanDirectory(
@@ -158,22 +244,41 @@ private:
 	        const FileOperations::Stat& st,
 	        std::string_view poolPath,
 	        ScanProgress& progress);
+	[[nodiscard]] Result processPending(
+		const Sha1Sum& sha1sum,
+	        std::string_view poolPath,
+	        ScanProgress& progress);
+	[[nodiscard]] Result checkSum(
+		const Sha1Sum& sha1sum, const Sha1Sum& sum, zstring_view filename);
 	[[nodiscard]] Sha1Sum calcSha1sum(File& file, std::string_view filename) const;
-	[[nodiscard]] std::pair<Index, Entry*> findInDatabase(std::string_view filename);
+	[[nodiscard]] DbEntry findInDatabase(std::string_view filename);
 
 private:
 	std::string fileCache; // path of the '.filecache' file.
 	std::function<Directories()> getDirectories;
 	std::function<void(std::string_view, float)> reportProgress;
 
-	MemBuffer<char> fileMem; // content of initial .filecache
+	// The initial (binary) .filecache is used in-place: the records in
+	// there are not copied to 'pool'. Only when such an entry changes, the
+	// record is marked as removed, and the new version is added to 'pool'.
+	MappedFile<const uint8_t> fileMap; // content of initial (binary) .filecache
+	std::span<const uint8_t> cacheRecords; // 'numRecords' records, sorted on sha1sum
+	std::span<const uint8_t> cacheNames; // all filenames, concatenated
+	RecordIndex numRecords = 0;
+	std::vector<bool> removedRecords; // only allocated on first removal
+	RecordNameIndex recordNameIndex{RecordNameIndexHash(*this), RecordNameIndexEqual(*this)}; // accessible via filename
+
+	MemBuffer<char> fileMem; // content of initial (text) .filecache
 	std::vector<std::string> stringBuffer; // owns strings that are not in 'fileMem'
 
-	Pool pool; // the actual entries
+	Pool pool; // the actual entries (apart from those in 'cacheRecords')
 	Sha1Index sha1Index; // entries accessible via sha1, sorted on 'CompareSha1'
 	FilenameIndex filenameIndex{FilenameIndexHash(pool), FilenameIndexEqual(pool)}; // accessible via filename
+	bool filenameIndexBuilt = false; // (also 'recordNameIndex') only built on first use, see buildFilenameIndex()
+
+	std::unique_ptr<WorkerThreads> workers; // to calculate sha1sums in parallel, created on first use
 
-	bool stop = false; // abort long search (set via reportProgress callback)
+	std::atomic<bool> stop = false; // abort long search (set via reportProgress callback)
 	bool needWrite = false; // dirty '.filecache'? write on exit
 
 	friend struct GetSha1;
@@ -45,6 +45,7 @@ MappedFileImpl::MappedFileImpl(LocalFile& file, size_t extra, bool is_const)
 	// Step 0: empty file (cannot be mmap()'ed).
 	if (fileSize == 0) {
 		ptr = calloc(extra, 1);
+		alloc = true;
 		return;
 	}
 
@@ -11,6 +11,7 @@
 #include "Debugger.hh"
 #include "Display.hh"
 #include "GlobalSettings.hh"
+#include "InstructionTrace.hh"
 #include "MSXCPU.hh"
 #include "MSXCPUInterface.hh"
 #include "MSXMemoryMapperBase.hh"
@@ -415,6 +416,10 @@ void ImGuiDisassembly::paint(MSXMotherBoard* motherBoard)
 								if (ImGui::MenuItem("Copy instructions to clipboard")) {
 									toClipboard = true;
 								}
+
+								ImGui::Separator();
+
+								ImGui::Checkbox("Show instruction trace", &showTrace);
 							});
 
 							enum class Priority : uint8_t {
@@ -533,6 +538,121 @@ void ImGuiDisassembly::paint(MSXMotherBoard* motherBoard)
 			cpuInterface.removeBreakPoint(*removeBpId);
 		}
 	});
+	paintInstructionTrace(*motherBoard);
+}
+
+void ImGuiDisassembly::paintInstructionTrace(MSXMotherBoard& motherBoard)
+{
+	if (!showTrace) return;
+
+	ImGui::SetNextWindowSize({600, 300}, ImGuiCond_FirstUseEver);
+	im::Window(tmpStrCat(title, " - instruction trace").c_str(), &showTrace, [&]{
+		auto& trace = motherBoard.getDebugger().getInstructionTrace();
+		const auto& buffer = trace.getBuffer();
+
+		if (trace.isActive()) {
+			if (ImGui::Button("Stop recording")) {
+				manager.executeDelayed(makeTclList("debug", "cpu_trace", "stop"));
+			}
+		} else {
+			if (ImGui::Button("Start recording")) {
+				manager.executeDelayed(makeTclList("debug", "cpu_trace", "start"));
+			}
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Clear")) {
+			manager.executeDelayed(makeTclList("debug", "cpu_trace", "clear"));
+		}
+		ImGui::SameLine();
+		ImGui::Checkbox("Follow", &followTrace);
+		simpleToolTip("Keep the most recent instruction in view.");
+		ImGui::SameLine();
+		ImGui::StrCat(buffer.size(), " instructions");
+
+		int flags = ImGuiTableFlags_RowBg |
+			ImGuiTableFlags_BordersV |
+			ImGuiTableFlags_BordersOuterV |
+			ImGuiTableFlags_Resizable |
+			ImGuiTableFlags_Hideable |
+			ImGuiTableFlags_Reorderable |
+			ImGuiTableFlags_ScrollY |
+			ImGuiTableFlags_ScrollX;
+		im::Table("trace", 6, flags, [&]{
+			ImGui::TableSetupScrollFreeze(0, 1); // Make top row always visible
+			ImGui::TableSetupColumn("time", ImGuiTableColumnFlags_DefaultHide);
+			ImGui::TableSetupColumn("slot");
+			ImGui::TableSetupColumn("address", ImGuiTableColumnFlags_NoHide);
+			ImGui::TableSetupColumn("opcode");
+			ImGui::TableSetupColumn("mnemonic", ImGuiTableColumnFlags_NoHide);
+			ImGui::TableSetupColumn("registers");
+			ImGui::TableHeadersRow();
+
+			im::ScopedFont sf(manager.fontMono);
+			std::string mnemonic;
+			std::optional<uint16_t> clickedAddr;
+			ImGuiListClipper clipper; // only decode the actually visible rows
+			clipper.Begin(narrow<int>(buffer.size()), ImGui::GetTextLineHeightWithSpacing());
+			while (clipper.Step()) {
+				buffer.decode(clipper.DisplayStart, clipper.DisplayEnd - clipper.DisplayStart,
+				              [&](size_t idx, const InstructionTrace::Entry& entry) {
+					im::ID(narrow<int>(idx), [&]{
+						ImGui::TableNextRow();
+						if (ImGui::TableNextColumn()) { // time
+							ImGui::StrCat(entry.time.toDouble());
+						}
+						if (ImGui::TableNextColumn()) { // slot
+							ImGui::TextUnformatted(CodeLocator::slotToString(entry.location));
+						}
+						if (ImGui::TableNextColumn()) { // address
+							auto pc = entry.getPC();
+							if (ImGui::Selectable(tmpStrCat(hex_string<4>(pc)).c_str(), false,
+							                      ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowOverlap)) {
+								clickedAddr = pc;
+							}
+						}
+						if (entry.irq) {
+							ImGui::TableNextColumn(); // opcode
+							if (ImGui::TableNextColumn()) { // mnemonic
+								ImGui::TextUnformatted("<interrupt>"sv);
+							}
+						} else {
+							if (ImGui::TableNextColumn()) { // opcode
+								ImGui::TextUnformatted(join(std::views::transform(entry.getOpcode(),
+									[](uint8_t b) { return hex_string<2>(b); }), ' '));
+							}
+							if (ImGui::TableNextColumn()) { // mnemonic
+								mnemonic.clear();
+								dasm(entry.getOpcode(), entry.getPC(), mnemonic,
+									[&](std::string& output, uint16_t a) {
+										auto labels = symbolManager.lookupValue(a);
+										if (!labels.empty()) {
+											strAppend(output, labels.front()->name);
+										} else {
+											appendAddrAsHex(output, a);
+										}
+									});
+								ImGui::TextUnformatted(mnemonic);
+							}
+						}
+						if (ImGui::TableNextColumn()) { // registers
+							using enum InstructionTraceBuffer::Reg;
+							const auto& r = entry.regs;
+							ImGui::StrCat("AF=", hex_string<4>(r[AF]), " BC=", hex_string<4>(r[BC]),
+							              " DE=", hex_string<4>(r[DE]), " HL=", hex_string<4>(r[HL]),
+							              " IX=", hex_string<4>(r[IX]), " IY=", hex_string<4>(r[IY]),
+							              " SP=", hex_string<4>(r[SP]));
+						}
+					});
+				});
+			}
+			if (clickedAddr) {
+				setGotoTarget(*clickedAddr);
+			}
+			if (followTrace && trace.isActive()) {
+				ImGui::SetScrollY(ImGui::GetScrollMaxY());
+			}
+		});
+	});
 }
 
 unsigned ImGuiDisassembly::disassemble(
@@ -46,6 +46,7 @@ private:
 	void disassembleToClipboard(
 		const MSXCPUInterface& cpuInterface, unsigned pc, EmuTime time,
 		unsigned minAddr, unsigned maxAddr);
+	void paintInstructionTrace(MSXMotherBoard& motherBoard);
 
 public:
 	bool show = true;
@@ -63,6 +64,8 @@ private:
 	std::optional<float> setDisassemblyScrollY;
 	bool followPC = false;
 	bool scrollToPcOnBreak = true;
+	bool showTrace = false;
+	bool followTrace = true;
 
 	bool syncDisassemblyWithPC = false;
 	float disassemblyScrollY = 0.0f;
@@ -72,6 +75,8 @@ private:
 		PersistentElement{"followPC",          &ImGuiDisassembly::followPC},
 		PersistentElement{"scrollToPcOnBreak", &ImGuiDisassembly::scrollToPcOnBreak},
 		PersistentElement{"disassemblyY",      &ImGuiDisassembly::disassemblyScrollY},
+		PersistentElement{"showTrace",         &ImGuiDisassembly::showTrace},
+		PersistentElement{"followTrace",       &ImGuiDisassembly::followTrace},
 	};
 };
 
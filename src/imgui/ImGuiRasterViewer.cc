@@ -534,7 +534,7 @@ void ImGuiRasterViewer::paintDisplay(MSXMotherBoard& motherBoard)
 						});
 						if (skip) continue;
 						auto mStart = std::max(from, it->time);
-						auto next = it + 1;
+						auto next = std::next(it);
 						auto mStop = std::min(to, (next == it1) ? to : next->time);
 						drawRegion(
 							timeToVdpPos(mStart + frameDuration), timeToVdpPos(mStop + frameDuration),
@@ -18,11 +18,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <optional>
+#include <ranges>
 
 namespace openmsx {
 
 using Traces = std::span<Tracer::Trace*>;
-using Events = std::span<const Tracer::Event>;
+using Events = std::ranges::subrange<TraceEvents::Iterator>;
 
 constexpr float splitterWidth = 7.0f; // should be odd
 
@@ -175,43 +177,86 @@ static void drawText(ImDrawList* drawList, gl::vec2 pos, ImU32 color, std::strin
 }
 
 struct DrawCoarse {
-	const Convertor* convertor;
+	const Convertor& convertor;
+	const TraceEvents& allEvents;
 	ImDrawList* drawList;
 	float x;
 	float y0, y1;
 	ImU32 colorNormal;
 	ImU32 colorHover;
+	Tracer::Trace::Type type;
 	Tracer::Trace::Format format;
 	bool rowHovered;
 
-	void operator()(float x0, float x1, auto first, auto last) const {
+	// Returns the events [first, last) that (partially) cover pixel column 'px'.
+	[[nodiscard]] std::pair<size_t, size_t> column(float px, TraceEvents::Iterator& first, TraceEvents::Iterator last) const {
+		auto next = std::ranges::upper_bound(std::next(first), last, convertor.xToTime(px + 1.0f), {}, &Tracer::Event::time);
+		auto result = std::pair(first.getIndex(), next.getIndex());
+		first = std::prev(next); // the event at the start of the next column
+		return result;
+	}
+
+	void operator()(float x0, float x1, TraceEvents::Iterator first, TraceEvents::Iterator last) const {
 		auto xf0 = std::floor(x0 + x);
 		auto xf1 = std::floor(x1 + x + 1.0f);
-		drawList->AddRectFilled({xf0, y0}, {xf1, y1}, colorNormal);
+		if (type == Tracer::Trace::Type::MONOSTATE) {
+			drawList->AddRectFilled({xf0, y0}, {xf1, y1}, colorNormal);
+		} else {
+			// Per pixel column: if the value doesn't change within that
+			// column, draw it similar to a (very narrow) detailed event,
+			// otherwise fill the whole column.
+			auto y2 = (y0 + y1) * 0.5f;
+			auto it = first;
+			for (auto px = std::floor(x0); (px < x1) && (it != last); px += 1.0f) {
+				auto [i, j] = column(px, it, last);
+				auto xp = px + x;
+				if (allEvents.numTransitions(i, j) != 0) {
+					drawList->AddRectFilled({xp, y0}, {xp + 1.0f, y1}, colorNormal);
+				} else if (const auto& value = allEvents[i].value; type == Tracer::Trace::Type::BOOL) {
+					auto y = value.get_as_bool() ? y0 : y1 - 1.0f;
+					drawList->AddRectFilled({xp, y}, {xp + 1.0f, y + 1.0f}, colorNormal);
+				} else if (value.holds_alternative<std::monostate>()) {
+					drawList->AddRectFilled({xp, y2}, {xp + 1.0f, y2 + 1.0f}, colorNormal);
+				} else {
+					drawList->AddRectFilled({xp, y0}, {xp + 1.0f, y0 + 1.0f}, colorNormal);
+					drawList->AddRectFilled({xp, y1 - 1.0f}, {xp + 1.0f, y1}, colorNormal);
+				}
+			}
+		}
 
 		if (!rowHovered) return;
 		auto mouseX = ImGui::GetIO().MousePos.x;
 		if (mouseX < xf0 || xf1 <= mouseX) return;
 		drawList->AddLine({mouseX, y0}, {mouseX, y1}, colorHover, 2.0f);
 
-		if (!convertor) return;
-		auto [it, _] = find_closest(
-			first, last, convertor->xToTime(mouseX), {}, &Tracer::Event::time);
+		if (type == Tracer::Trace::Type::MONOSTATE) return;
+		auto px = std::floor(mouseX - x);
+		auto it = std::ranges::upper_bound(first, last, convertor.xToTime(px), {}, &Tracer::Event::time);
+		if (it != first) --it;
 		if (it == last) return;
-		if (it->value.template holds_alternative<std::monostate>()) {
-			++it; // 2nd try
-			if (it == last) return;
-		}
-		std::array<char, 64> tmpBuf;
-		auto valueStr = ImGuiTraceViewer::formatTraceValue(it->value, tmpBuf, format);
+		auto [i, j] = column(px, it, last);
+		auto summary = allEvents.summarize(i, j);
 		im::Tooltip([&]{
-			ImGui::TextUnformatted(valueStr);
+			std::array<char, 64> tmpBuf;
+			auto str = [&](const TraceValue* value) {
+				return std::string(ImGuiTraceViewer::formatTraceValue(*value, tmpBuf, format));
+			};
+			if (summary.transitions == 0) {
+				ImGui::StrCat(str(summary.dominant));
+				return;
+			}
+			ImGui::StrCat(summary.transitions, " value changes");
+			if (summary.min) {
+				ImGui::StrCat("range: ", str(summary.min), " ... ", str(summary.max));
+			}
+			ImGui::StrCat("mostly: ", str(summary.dominant));
 		});
 	}
 };
 
 static void drawEventsVoid(
-	gl::vec2 topLeft, const Convertor& convertor, EmuTime maxT, Events events, bool rowHovered)
+	gl::vec2 topLeft, const Convertor& convertor, EmuTime maxT, const TraceEvents& allEvents, Events events,
+	bool rowHovered)
 {
 	auto* drawList = ImGui::GetWindowDrawList();
 	auto colorLine = ImGui::GetColorU32(ImGuiCol_PlotLines);
@@ -254,11 +299,13 @@ static void drawEventsVoid(
 	};
 	auto dummyFormat = Tracer::Trace::Format::DEC;
 	processTimeline(events, maxT, convertor, drawDetailed,
-	                DrawCoarse{nullptr, drawList, topLeft.x, y0, y1, colorNormal, colorHover, dummyFormat, rowHovered});
+	                DrawCoarse{convertor, allEvents, drawList, topLeft.x, y0, y1, colorNormal, colorHover,
+	                           Tracer::Trace::Type::MONOSTATE, dummyFormat, rowHovered});
 }
 
 static void drawEventsBool(
-	gl::vec2 topLeft, const Convertor& convertor, EmuTime maxT, Events events, bool rowHovered)
+	gl::vec2 topLeft, const Convertor& convertor, EmuTime maxT, const TraceEvents& allEvents, Events events,
+	bool rowHovered)
 {
 	if (events.empty()) return;
 
@@ -296,7 +343,8 @@ static void drawEventsBool(
 	};
 	auto dummyFormat = Tracer::Trace::Format::DEC;
 	processTimeline(events, maxT, convertor, drawDetailed,
-	                DrawCoarse{nullptr, drawList, topLeft.x, y0, y1, colorNormal, colorHover, dummyFormat, rowHovered});
+	                DrawCoarse{convertor, allEvents, drawList, topLeft.x, y0, y1, colorNormal, colorHover,
+	                           Tracer::Trace::Type::BOOL, dummyFormat, rowHovered});
 }
 
 [[nodiscard]] std::string_view ImGuiTraceViewer::formatTraceValue(const TraceValue& value, std::span<char, 64> tmpBuf,
@@ -348,8 +396,8 @@ static void drawEventsBool(
 }
 
 static void drawEventsValue(
-	gl::vec2 topLeft, const Convertor& convertor, EmuTime maxT, Events events, bool rowHovered,
-	Tracer::Trace::Format format)
+	gl::vec2 topLeft, const Convertor& convertor, EmuTime maxT, const TraceEvents& allEvents, Events events,
+	bool rowHovered, Tracer::Trace::Type type, Tracer::Trace::Format format)
 {
 	auto* drawList = ImGui::GetWindowDrawList();
 	const auto& style = ImGui::GetStyle();
@@ -405,7 +453,8 @@ static void drawEventsValue(
 		}
 	};
 	processTimeline(events, maxT, convertor, drawDetailed,
-	                DrawCoarse{&convertor, drawList, topLeft.x, y0, y1, colorNormal, colorHover, format, rowHovered});
+	                DrawCoarse{convertor, allEvents, drawList, topLeft.x, y0, y1, colorNormal, colorHover,
+	                           type, format, rowHovered});
 }
 
 static bool menuItemWithShortcut(ImGuiManager& manager, const char* label, Shortcuts::ID id, bool* p_selected = nullptr)
@@ -801,18 +850,18 @@ void ImGuiTraceViewer::scrollTo(EmuTime time)
 	}
 }
 
-[[nodiscard]] static const Tracer::Event* findStrictlySmaller(const Tracer::Trace& trace, EmuTime time)
+[[nodiscard]] static std::optional<Tracer::Event> findStrictlySmaller(const Tracer::Trace& trace, EmuTime time)
 {
 	auto it = std::ranges::lower_bound(trace.events, time, {}, &Tracer::Event::time);
-	if (it == trace.events.begin()) return nullptr;
-	return std::to_address(it - 1);
+	if (it == trace.events.begin()) return {};
+	return *(it - 1);
 }
 
-[[nodiscard]] static const Tracer::Event* findStrictlyBigger(const Tracer::Trace& trace, EmuTime time)
+[[nodiscard]] static std::optional<Tracer::Event> findStrictlyBigger(const Tracer::Trace& trace, EmuTime time)
 {
 	auto it = std::ranges::upper_bound(trace.events, time, {}, &Tracer::Event::time);
-	if (it == trace.events.end()) return nullptr;
-	return std::to_address(it);
+	if (it == trace.events.end()) return {};
+	return *it;
 }
 
 void ImGuiTraceViewer::gotoPrevNegEdge(EmuTime& selectedTime)
@@ -820,7 +869,7 @@ void ImGuiTraceViewer::gotoPrevNegEdge(EmuTime& selectedTime)
 	if (const auto* trace = getTrace(traces, selectedRow)) {
 		auto time = selectedTime;
 		while (true) {
-			const auto* event = findStrictlySmaller(*trace, time);
+			auto event = findStrictlySmaller(*trace, time);
 			if (!event) return;
 			time = event->time;
 			if (!trace->isBool() || event->value.get_u64() == 0) break;
@@ -835,7 +884,7 @@ void ImGuiTraceViewer::gotoPrevPosEdge(EmuTime& selectedTime)
 	if (const auto* trace = getTrace(traces, selectedRow)) {
 		auto time = selectedTime;
 		while (true) {
-			const auto* event = findStrictlySmaller(*trace, time);
+			auto event = findStrictlySmaller(*trace, time);
 			if (!event) return;
 			time = event->time;
 			if (!trace->isBool() || event->value.get_u64() != 0) break;
@@ -848,7 +897,7 @@ void ImGuiTraceViewer::gotoPrevPosEdge(EmuTime& selectedTime)
 void ImGuiTraceViewer::gotoPrevEdge(EmuTime& selectedTime)
 {
 	if (const auto* trace = getTrace(traces, selectedRow)) {
-		if (const auto* event = findStrictlySmaller(*trace, selectedTime)) {
+		if (auto event = findStrictlySmaller(*trace, selectedTime)) {
 			selectedTime = event->time;
 			scrollTo(event->time);
 		}
@@ -858,7 +907,7 @@ void ImGuiTraceViewer::gotoPrevEdge(EmuTime& selectedTime)
 void ImGuiTraceViewer::gotoNextEdge(EmuTime& selectedTime)
 {
 	if (const auto* trace = getTrace(traces, selectedRow)) {
-		if (const auto* event = findStrictlyBigger(*trace, selectedTime)) {
+		if (auto event = findStrictlyBigger(*trace, selectedTime)) {
 			selectedTime = event->time;
 			scrollTo(event->time);
 		}
@@ -870,7 +919,7 @@ void ImGuiTraceViewer::gotoNextNegEdge(EmuTime& selectedTime)
 	if (const auto* trace = getTrace(traces, selectedRow)) {
 		auto time = selectedTime;
 		while (true) {
-			const auto* event = findStrictlyBigger(*trace, time);
+			auto event = findStrictlyBigger(*trace, time);
 			if (!event) return;
 			time = event->time;
 			if (!trace->isBool() || event->value.get_u64() == 0) break;
@@ -885,7 +934,7 @@ void ImGuiTraceViewer::gotoNextPosEdge(EmuTime& selectedTime)
 	if (const auto* trace = getTrace(traces, selectedRow)) {
 		auto time = selectedTime;
 		while (true) {
-			const auto* event = findStrictlyBigger(*trace, time);
+			auto event = findStrictlyBigger(*trace, time);
 			if (!event) return;
 			time = event->time;
 			if (!trace->isBool() || event->value.get_u64() != 0) break;
@@ -1244,14 +1293,14 @@ void ImGuiTraceViewer::drawRuler(gl::vec2 size, const Convertor& convertor, EmuT
 	}
 }
 
-static EmuTime snapToEvent(EmuTime time, auto convertor, std::span<const Tracer::Event> events)
+static EmuTime snapToEvent(EmuTime time, auto convertor, Events events)
 {
 	auto [it, dist] = find_closest(events, time, {}, &Tracer::Event::time);
 	if (it == events.end()) return time;
 	auto h5 = ImGui::GetFrameHeight() * 0.20f;
 	return (dist < convertor.deltaXtoDuration(h5)) ? it->time : time;
 }
-static EmuTime snapToEvent(float mouseX, auto convertor, std::span<const Tracer::Event> events)
+static EmuTime snapToEvent(float mouseX, auto convertor, Events events)
 {
 	auto time = convertor.xToTime(mouseX);
 	return snapToEvent(time, convertor, events);
@@ -1332,7 +1381,7 @@ void ImGuiTraceViewer::drawGraphs(float rulerHeight, float rowHeight, int mouseR
 			if (it0 != trace.events.begin()) --it0;
 			auto graphEndTime = viewStartTime + viewDuration;
 			auto it1 = std::ranges::upper_bound(trace.events, graphEndTime, {}, &Tracer::Event::time);
-			std::span<const Tracer::Event> visibleEvents(it0, it1);
+			Events visibleEvents(it0, it1);
 
 			bool rowHovered = hovered && (row == mouseRow);
 			if (rowHovered && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
@@ -1352,13 +1401,14 @@ void ImGuiTraceViewer::drawGraphs(float rulerHeight, float rowHeight, int mouseR
 			tl.y += style.ItemSpacing.y;
 			switch (trace.getType()) {
 			case Tracer::Trace::Type::MONOSTATE:
-				drawEventsVoid(tl, convertor, maxT, visibleEvents, rowHovered);
+				drawEventsVoid(tl, convertor, maxT, trace.events, visibleEvents, rowHovered);
 				break;
 			case Tracer::Trace::Type::BOOL:
-				drawEventsBool(tl, convertor, maxT, visibleEvents, rowHovered);
+				drawEventsBool(tl, convertor, maxT, trace.events, visibleEvents, rowHovered);
 				break;
 			default:
-				drawEventsValue(tl, convertor, maxT, visibleEvents, rowHovered, trace.getFormat());
+				drawEventsValue(tl, convertor, maxT, trace.events, visibleEvents, rowHovered,
+				                trace.getType(), trace.getFormat());
 			}
 		});
 		auto drawLine = [&](EmuTime t, ImU32 color) {
@@ -1432,7 +1482,7 @@ void ImGuiTraceViewer::drawGraphs(float rulerHeight, float rowHeight, int mouseR
 				if (ImGui::MenuItem("Reverse emulation to here")) {
 					auto time = convertor.xToTime(ctxMouseX);
 					if (const auto* trace = getTrace(traces, ctxMouseRow)) {
-						time = snapToEvent(time, convertor, trace->events);
+						time = snapToEvent(time, convertor, Events(trace->events.begin(), trace->events.end()));
 					}
 					manager.executeDelayed(makeTclList("reverse", "goto", time.toDouble()));
 				}
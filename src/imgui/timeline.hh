@@ -5,7 +5,7 @@
 #include <cmath>
 #include <concepts>
 #include <optional>
-#include <span>
+#include <ranges>
 
 namespace openmsx {
 
@@ -52,7 +52,9 @@ concept TimelineMapper = requires(T c, Time time, float x) {
  * - The binary search allows efficient skipping of dense event clusters
  *
  * @tparam Time       Time type (e.g., int, std::chrono::duration, EmuTime)
- * @tparam Event      Event type (must satisfy HasTime<Event, Time> concept)
+ * @tparam Events     Random access range of events, the element type must satisfy
+ *                    the HasTime<Event, Time> concept. E.g. std::span<const Event>,
+ *                    but the elements may also be proxy objects (see TraceEvents).
  * @tparam Mapper     Mapper type (must satisfy TimelineMapper<Mapper, Time> concept)
  * @param events      Sorted list of events (must be sorted by time, ascending)
  * @param endTime     End time of the visible timeline (must be >= last event time)
@@ -72,19 +74,21 @@ concept TimelineMapper = requires(T c, Time time, float x) {
  * - events must be sorted by time (ascending order)
  * - endTime >= events.back().time (if events not empty)
  */
-template<typename Time, HasTime<Time> Event, TimelineMapper<Time> Mapper>
+template<typename Time, std::ranges::random_access_range Events, TimelineMapper<Time> Mapper>
+	requires HasTime<std::ranges::range_value_t<Events>, Time>
 void processTimeline(
-	std::span<const Event> events,
+	const Events& events,
 	Time endTime,
 	const Mapper& mapper,
-	std::invocable<float, float, const Event&> auto onDetailed,
-	std::invocable<float, float, typename std::span<const Event>::iterator, typename std::span<const Event>::iterator> auto onCoarse,
+	std::invocable<float, float, std::ranges::range_reference_t<const Events>> auto onDetailed,
+	std::invocable<float, float, std::ranges::iterator_t<const Events>, std::ranges::iterator_t<const Events>> auto onCoarse,
 	float threshold = 1.0)
 {
-	if (events.empty()) return;
+	using Element = std::ranges::range_value_t<Events>;
+	if (std::ranges::empty(events)) return;
 
 	std::optional<float> coarseStart; // start of current coarse region
-	decltype(events.begin()) coarseBeginIt;
+	std::ranges::iterator_t<const Events> coarseBeginIt;
 	auto flushCoarse = [&](float endPixel, auto endIt) {
 		if (coarseStart) {
 			onCoarse(*coarseStart, endPixel, coarseBeginIt, endIt);
@@ -93,12 +97,12 @@ void processTimeline(
 		}
 	};
 
-	auto currentIt = events.begin();
+	auto currentIt = std::ranges::begin(events);
 	auto currentPixel = mapper.timeToX(currentIt->time);
-	while (currentIt != events.end()) {
+	while (currentIt != std::ranges::end(events)) {
 		// get next time (either next event or endTime)
 		const auto nextIt = std::next(currentIt);
-		const auto nextTimestamp = (nextIt != events.end())
+		const auto nextTimestamp = (nextIt != std::ranges::end(events))
 		                         ? nextIt->time
 		                         : endTime;
 		const auto nextPixel = mapper.timeToX(nextTimestamp);
@@ -124,7 +128,7 @@ void processTimeline(
 			// Find last event at or before the next pixel boundary.
 			// upper_bound gives first event > targetTime, then back up one.
 			// Important: Start from next event to ensure we make progress.
-			if (auto it = std::ranges::upper_bound(nextIt, events.end(), targetTime, {}, &Event::time);
+			if (auto it = std::ranges::upper_bound(nextIt, std::ranges::end(events), targetTime, {}, &Element::time);
 			    it != nextIt) {
 				currentIt = std::prev(it);
 				currentPixel = mapper.timeToX(currentIt->time);
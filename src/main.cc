@@ -100,7 +100,7 @@ static int main(int argc, char **argv)
 				reactor.getEventDistributor().deliverEvents();
 			}
 
-			CliServer cliServer(reactor.getCommandController(),
+			CliServer cliServer(reactor.getGlobalCommandController(),
 			                    reactor.getEventDistributor(),
 			                    reactor.getGlobalCliComm());
 
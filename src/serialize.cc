@@ -102,6 +102,7 @@ unsigned InputArchiveBase2::getId(const void* ptr) const
 }
 
 template class InputArchiveBase<MemInputArchive>;
+template class InputArchiveBase<CheckedMemInputArchive>;
 template class InputArchiveBase<XmlInputArchive>;
 
 ////
@@ -116,10 +117,12 @@ void MemOutputArchive::save(std::string_view s)
 
 ////
 
-void MemInputArchive::load(std::string& s)
+template<typename Derived, typename Buffer>
+void MemInputArchiveBase<Derived, Buffer>::load(std::string& s)
 {
 	size_t length;
 	load(length);
+	if constexpr (CHECKED) buffer.check(length);
 	s.resize_and_overwrite(length, [&](char* dst, size_t /*n*/) {
 		//assert(length == n); <-- not true with gcc-12 (bug)
 		if (length) {
@@ -129,7 +132,8 @@ void MemInputArchive::load(std::string& s)
 	});
 }
 
-std::string_view MemInputArchive::loadStr()
+template<typename Derived, typename Buffer>
+std::string_view MemInputArchiveBase<Derived, Buffer>::loadStr()
 {
 	size_t length;
 	load(length);
@@ -162,8 +166,9 @@ void MemOutputArchive::serialize_blob(const char* /*tag*/, std::span<const uint8
 	}
 }
 
-void MemInputArchive::serialize_blob(const char* /*tag*/, std::span<uint8_t> data,
-                                     bool /*diff*/)
+template<typename Derived, typename Buffer>
+void MemInputArchiveBase<Derived, Buffer>::serialize_blob(
+	const char* /*tag*/, std::span<uint8_t> data, bool /*diff*/)
 {
 	if (data.size() > SMALL_SIZE) {
 		// Usually blobs are saved in the same order as they are loaded
@@ -175,13 +180,24 @@ void MemInputArchive::serialize_blob(const char* /*tag*/, std::span<uint8_t> dat
 		// is possible that certain blobs are stored in the savestate,
 		// but skipped while loading. That's why we do need the index.
 		unsigned deltaBlockIdx; load(deltaBlockIdx);
+		if constexpr (CHECKED) {
+			if (deltaBlockIdx >= deltaBlocks.size()) [[unlikely]] {
+				throw MSXException("Corrupt savestate: invalid blob index");
+			}
+		} else {
+			assert(deltaBlockIdx < deltaBlocks.size());
+		}
 		deltaBlocks[deltaBlockIdx]->apply(data);
 	} else {
-		copy_to_range(std::span{buffer.getCurrentPos(), data.size()}, data);
+		const uint8_t* p = buffer.getCurrentPos();
 		buffer.skip(data.size());
+		copy_to_range(std::span{p, data.size()}, data);
 	}
 }
 
+template class MemInputArchiveBase<MemInputArchive, InputBuffer>;
+template class MemInputArchiveBase<CheckedMemInputArchive, CheckedInputBuffer>;
+
 ////
 
 XmlOutputArchive::XmlOutputArchive(zstring_view filename_)
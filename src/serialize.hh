@@ -756,11 +756,18 @@ private:
 	const bool reverseSnapshot;
 };
 
-class MemInputArchive final : public InputArchiveBase<MemInputArchive>
+// Shared implementation of MemInputArchive and CheckedMemInputArchive, they
+// only differ in the type of input buffer.
+template<typename Derived, typename Buffer>
+class MemInputArchiveBase : public InputArchiveBase<Derived>
 {
+	// Input from a file (iso from a MemOutputArchive in this process)
+	// must be validated, see CheckedInputBuffer.
+	static constexpr bool CHECKED = std::is_same_v<Buffer, CheckedInputBuffer>;
+
 public:
-	MemInputArchive(std::span<const uint8_t> buf_,
-	                std::span<const std::shared_ptr<DeltaBlock>> deltaBlocks_)
+	MemInputArchiveBase(std::span<const uint8_t> buf_,
+	                    std::span<const std::shared_ptr<DeltaBlock>> deltaBlocks_)
 		: buffer(buf_)
 		, deltaBlocks(deltaBlocks_)
 	{
@@ -789,7 +796,23 @@ public:
 	void serialize_blob(const char* tag, std::span<uint8_t> data,
 	                    bool diff = true);
 
-	using InputArchiveBase<MemInputArchive>::serialize;
+	// Called (by CollectionLoader) before making room for 'n' elements
+	// of type T. Each element takes at least one byte in the stream
+	// (exactly sizeof(T) bytes for memcpy-able types), so a corrupt count
+	// is detected before it can cause a huge allocation.
+	template<typename T> void checkNumElements(int n) const
+	{
+		if constexpr (CHECKED) {
+			constexpr size_t minSize = SerializeAsMemcpy<T>::value ? sizeof(T) : 1;
+			if ((n < 0) || (size_t(n) > buffer.size() / minSize)) [[unlikely]] {
+				buffer.throwTruncated();
+			}
+		} else {
+			assert(n >= 0);
+		}
+	}
+
+	using InputArchiveBase<Derived>::serialize;
 	template<typename T, typename ...Args>
 	ALWAYS_INLINE void serialize(const char* tag, T& t, Args&& ...args)
 	{
@@ -834,10 +857,26 @@ private:
 	}
 
 private:
-	InputBuffer buffer;
+	Buffer buffer;
 	std::span<const std::shared_ptr<DeltaBlock>> deltaBlocks;
 };
 
+// For data produced by a MemOutputArchive in this process (reverse snapshots).
+class MemInputArchive final
+	: public MemInputArchiveBase<MemInputArchive, InputBuffer>
+{
+public:
+	using MemInputArchiveBase::MemInputArchiveBase;
+};
+
+// For data read from a file (binary savestates), see serialize_binary.hh.
+class CheckedMemInputArchive final
+	: public MemInputArchiveBase<CheckedMemInputArchive, CheckedInputBuffer>
+{
+public:
+	using MemInputArchiveBase::MemInputArchiveBase;
+};
+
 ////
 
 class XmlOutputArchive final : public OutputArchiveBase<XmlOutputArchive>
@@ -1012,6 +1051,7 @@ private:
 
 #define INSTANTIATE_SERIALIZE_METHODS(CLASS) \
 template void CLASS::serialize(MemInputArchive&,   unsigned); \
+template void CLASS::serialize(CheckedMemInputArchive&, unsigned); \
 template void CLASS::serialize(MemOutputArchive&,  unsigned); \
 template void CLASS::serialize(XmlInputArchive&,   unsigned); \
 template void CLASS::serialize(XmlOutputArchive&,  unsigned);
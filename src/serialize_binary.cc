@@ -0,0 +1,238 @@
+#include "serialize_binary.hh"
+
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "Version.hh"
+
+#include "MemBuffer.hh"
+#include "narrow.hh"
+#include "ranges.hh"
+#include "strCat.hh"
+#include "xrange.hh"
+
+#include "build-info.hh"
+
+#include <zlib.h>
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace openmsx {
+
+enum class BlobCodec : uint8_t { NONE = 0, ZLIB = 1 };
+
+static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+[[nodiscard]] static std::string getBuildId()
+{
+	return strCat(Version::full(), ' ', TARGET_PLATFORM);
+}
+
+// class BinaryOutputArchive
+
+BinaryOutputArchive::BinaryOutputArchive(zstring_view filename_)
+	: filename(filename_)
+	, archive(lastDeltaBlocks, deltaBlocks, false)
+{
+}
+
+void BinaryOutputArchive::close()
+{
+	auto file = FileOperations::openFile(filename, "wb");
+	if (!file) {
+		throw MSXException("Could not write \"", filename, '"');
+	}
+	auto write = [&](const void* data, size_t size) {
+		if (size && (fwrite(data, size, 1, file.get()) != 1)) {
+			throw MSXException("Error while writing \"", filename, '"');
+		}
+	};
+	auto write8  = [&](uint8_t  v) { write(&v, sizeof(v)); };
+	auto write32 = [&](uint32_t v) { write(&v, sizeof(v)); };
+	auto write64 = [&](uint64_t v) { write(&v, sizeof(v)); };
+
+	write(MAGIC.data(), MAGIC.size());
+	write32(FORMAT_VERSION);
+	write32(BYTE_ORDER_MARK);
+	write32(sizeof(size_t));
+	auto buildId = getBuildId();
+	write32(narrow<uint32_t>(buildId.size()));
+	write(buildId.data(), buildId.size());
+
+	// Compress with the fastest zlib setting: loading is what matters
+	// most. Store blobs uncompressed when that doesn't gain anything.
+	write32(narrow<uint32_t>(deltaBlocks.size()));
+	MemBuffer<uint8_t> raw;
+	MemBuffer<uint8_t> compressed;
+	for (const auto& block : deltaBlocks) {
+		auto size = block->getSize();
+		raw.resize(size);
+		block->apply(std::span{raw.data(), size});
+
+		auto dstLen = compressBound(uLong(size));
+		compressed.resize(dstLen);
+		if ((compress2(compressed.data(), &dstLen, raw.data(), uLong(size),
+		               Z_BEST_SPEED) == Z_OK) &&
+		    (dstLen < size)) {
+			write8(uint8_t(BlobCodec::ZLIB));
+			write64(size);
+			write64(dstLen);
+			write(compressed.data(), dstLen);
+		} else {
+			write8(uint8_t(BlobCodec::NONE));
+			write64(size);
+			write64(size);
+			write(raw.data(), size);
+		}
+	}
+
+	auto state = std::move(archive).releaseBuffer();
+	write64(state.size());
+	write(state.data(), state.size());
+
+	if (fflush(file.get()) != 0) {
+		throw MSXException("Error while writing \"", filename, '"');
+	}
+}
+
+
+// class BinaryInputArchive
+
+namespace {
+
+// A blob section in the memory mapped file.
+class MappedBlob final : public DeltaBlock
+{
+public:
+	MappedBlob(BlobCodec codec_, std::span<const uint8_t> stored_, size_t size_)
+		: stored(stored_), size(size_), codec(codec_) {}
+
+	void apply(std::span<uint8_t> dst) const override
+	{
+		if (dst.size() != size) {
+			throw MSXException("Corrupt savestate: blob size mismatch");
+		}
+		switch (codec) {
+		case BlobCodec::NONE:
+			copy_to_range(stored, dst);
+			break;
+		case BlobCodec::ZLIB: {
+			auto dstLen = uLong(size);
+			if ((uncompress(dst.data(), &dstLen, stored.data(), uLong(stored.size())) != Z_OK) ||
+			    (dstLen != size)) {
+				throw MSXException("Corrupt savestate: error while decompressing");
+			}
+			break;
+		}
+		}
+	}
+	[[nodiscard]] size_t getSize() const override { return size; }
+	[[nodiscard]] size_t getMemorySize(
+		std::unordered_set<const DeltaBlock*>& /*seen*/) const override { return 0; }
+	size_t compressStrong() override { return 0; }
+	[[nodiscard]] bool canCompressStrong() const override { return false; }
+
+private:
+	std::span<const uint8_t> stored;
+	size_t size;
+	BlobCodec codec;
+};
+
+[[nodiscard]] bool checkMagic(std::span<const uint8_t> buf)
+{
+	return std::ranges::equal(buf, BinaryOutputArchive::MAGIC, {}, {},
+	                          [](char c) { return uint8_t(c); });
+}
+
+// Bounds-checked reading from the memory mapped file.
+class Reader
+{
+public:
+	explicit Reader(std::span<const uint8_t> buf_) : buf(buf_) {}
+
+	[[nodiscard]] std::span<const uint8_t> get(size_t num)
+	{
+		if (num > buf.size()) {
+			throw MSXException("Corrupt savestate: unexpected end of file");
+		}
+		auto result = buf.first(num);
+		buf = buf.subspan(num);
+		return result;
+	}
+	template<typename T> [[nodiscard]] T read()
+	{
+		T t;
+		memcpy(&t, get(sizeof(T)).data(), sizeof(T));
+		return t;
+	}
+	[[nodiscard]] std::string_view readString()
+	{
+		auto len = read<uint32_t>();
+		auto s = get(len);
+		return {std::bit_cast<const char*>(s.data()), s.size()};
+	}
+
+private:
+	std::span<const uint8_t> buf;
+};
+
+} // namespace
+
+BinaryInputArchive::BinaryInputArchive(zstring_view filename)
+	: file(filename, "rb")
+	, mmap(file.mmap<const uint8_t>())
+{
+	Reader reader{std::span{mmap.data(), mmap.size()}};
+	if (!checkMagic(reader.get(BinaryOutputArchive::MAGIC.size()))) {
+		throw MSXException("Not a binary savestate");
+	}
+	if (auto version = reader.read<uint32_t>();
+	    version != BinaryOutputArchive::FORMAT_VERSION) {
+		throw MSXException("Unsupported binary savestate format version: ", version);
+	}
+	if ((reader.read<uint32_t>() != BYTE_ORDER_MARK) ||
+	    (reader.read<uint32_t>() != sizeof(size_t))) {
+		throw MSXException("Binary savestate was created on a different platform");
+	}
+	if (auto buildId = reader.readString(); buildId != getBuildId()) {
+		throw MSXException("Binary savestate was created by a different "
+		                   "openMSX build (", buildId, "), it can only "
+		                   "be loaded by that same build.");
+	}
+
+	auto numBlobs = reader.read<uint32_t>();
+	deltaBlocks.reserve(numBlobs);
+	repeat(numBlobs, [&] {
+		auto codec = reader.read<uint8_t>();
+		if (codec > uint8_t(BlobCodec::ZLIB)) {
+			throw MSXException("Corrupt savestate: unknown codec");
+		}
+		auto size = reader.read<uint64_t>();
+		auto storedSize = reader.read<uint64_t>();
+		auto stored = reader.get(narrow<size_t>(storedSize));
+		if ((codec == uint8_t(BlobCodec::NONE)) && (storedSize != size)) {
+			throw MSXException("Corrupt savestate: blob size mismatch");
+		}
+		deltaBlocks.push_back(std::make_shared<MappedBlob>(
+			BlobCodec(codec), stored, narrow<size_t>(size)));
+	});
+
+	auto stateSize = reader.read<uint64_t>();
+	archive.emplace(reader.get(narrow<size_t>(stateSize)), deltaBlocks);
+}
+
+bool BinaryInputArchive::isBinary(zstring_view filename)
+{
+	try {
+		File f(filename, "rb");
+		if (f.getSize() < BinaryOutputArchive::MAGIC.size()) return false;
+		std::array<uint8_t, BinaryOutputArchive::MAGIC.size()> buf;
+		f.read(buf);
+		return checkMagic(buf);
+	} catch (MSXException&) {
+		return false;
+	}
+}
+
+} // namespace openmsx
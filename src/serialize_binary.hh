@@ -0,0 +1,98 @@
+#ifndef SERIALIZE_BINARY_HH
+#define SERIALIZE_BINARY_HH
+
+#include "serialize.hh"
+
+#include "DeltaBlock.hh"
+#include "File.hh"
+#include "MappedFile.hh"
+#include "zstring_view.hh"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace openmsx {
+
+// Binary savestates.
+//
+// The XML savestate format is portable (between openMSX versions and between
+// platforms), but it's slow: all blobs are base64 encoded, the whole file is
+// gzip'ed and parsing XML isn't free either. This binary format instead reuses
+// MemOutputArchive (the archive used for the reverse snapshots). The blobs
+// (e.g. RAM content) are stored in separate, individually compressed sections,
+// all other data is stored in the same format as MemOutputArchive produces.
+// That way loading can use the (memory mapped) file content directly. Loading
+// uses CheckedMemInputArchive: unlike MemInputArchive it doesn't trust its
+// input, a corrupt file results in an MSXException.
+//
+// Just like for the in-memory archives, no class versions are stored. So a
+// binary savestate can only be loaded by the exact same openMSX build that
+// created it (this is checked via a header). Use the XML format for long term
+// storage.
+//
+// File layout (all values in native byte order):
+//   magic            16 bytes, see BinaryOutputArchive::MAGIC
+//   format version   uint32_t
+//   byte order mark  uint32_t (0x01020304)
+//   sizeof(size_t)   uint32_t
+//   build id         uint32_t length + characters (openMSX version + platform)
+//   number of blobs  uint32_t
+//   per blob:        uint8_t codec (0 = none, 1 = zlib),
+//                    uint64_t size, uint64_t stored size, stored data
+//   state size       uint64_t
+//   state            (uncompressed) MemOutputArchive content
+
+class BinaryOutputArchive
+{
+public:
+	static constexpr std::string_view MAGIC = "openMSX-binstate";
+	static constexpr uint32_t FORMAT_VERSION = 1;
+
+	explicit BinaryOutputArchive(zstring_view filename);
+
+	template<typename T> void serialize(const char* tag, const T& t)
+	{
+		archive.serialize(tag, t);
+	}
+
+	/** Write the file. Throws MSXException on error. */
+	void close();
+
+private:
+	std::string filename;
+	LastDeltaBlocks lastDeltaBlocks;
+	std::vector<std::shared_ptr<DeltaBlock>> deltaBlocks;
+	MemOutputArchive archive;
+};
+
+class BinaryInputArchive
+{
+public:
+	/** Open (memory map) the file and check the header.
+	  * Throws MSXException when the file is not a (compatible) binary
+	  * savestate.
+	  */
+	explicit BinaryInputArchive(zstring_view filename);
+
+	template<typename T> void serialize(const char* tag, T& t)
+	{
+		archive->serialize(tag, t);
+	}
+
+	/** Quick check whether the given file is a binary savestate (it only
+	  * checks the magic header, not whether it's compatible with this
+	  * build). */
+	[[nodiscard]] static bool isBinary(zstring_view filename);
+
+private:
+	File file;
+	MappedFile<const uint8_t> mmap;
+	std::vector<std::shared_ptr<DeltaBlock>> deltaBlocks;
+	std::optional<CheckedMemInputArchive> archive;
+};
+
+} // namespace openmsx
+
+#endif
@@ -33,6 +33,12 @@ unsigned loadVersionHelper(MemInputArchive& /*ar*/, const char* /*className*/,
 	UNREACHABLE;
 }
 
+unsigned loadVersionHelper(CheckedMemInputArchive& /*ar*/, const char* /*className*/,
+                           unsigned /*latestVersion*/)
+{
+	UNREACHABLE;
+}
+
 unsigned loadVersionHelper(XmlInputArchive& ar, const char* className,
                            unsigned latestVersion)
 {
@@ -569,6 +569,8 @@ template<typename T> struct EnumLoader
 
 unsigned loadVersionHelper(MemInputArchive& ar, const char* className,
                            unsigned latestVersion);
+unsigned loadVersionHelper(CheckedMemInputArchive& ar, const char* className,
+                           unsigned latestVersion);
 unsigned loadVersionHelper(XmlInputArchive& ar, const char* className,
                            unsigned latestVersion);
 template<typename T, typename Archive> unsigned loadVersion(Archive& ar)
@@ -755,6 +757,7 @@ template<typename TC> struct CollectionLoader
 				n = ar.countChildren();
 			} else {
 				ar.serialize("size", n);
+				ar.template checkNumElements<typename sac::value_type>(n);
 			}
 		}
 		sac::prepare(tc, n);
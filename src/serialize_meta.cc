@@ -89,6 +89,7 @@ void* PolymorphicLoaderRegistry<Archive>::load(
 }
 
 template class PolymorphicLoaderRegistry<MemInputArchive>;
+template class PolymorphicLoaderRegistry<CheckedMemInputArchive>;
 template class PolymorphicLoaderRegistry<XmlInputArchive>;
 
 ////
@@ -135,6 +136,7 @@ void PolymorphicInitializerRegistry<Archive>::init(
 }
 
 template class PolymorphicInitializerRegistry<MemInputArchive>;
+template class PolymorphicInitializerRegistry<CheckedMemInputArchive>;
 template class PolymorphicInitializerRegistry<XmlInputArchive>;
 
 } // namespace openmsx
@@ -292,6 +292,7 @@ template<> struct PolymorphicConstructorArgs<C> \
 { using type = std::tuple<T1,T2,T3>; };
 
 class MemInputArchive;
+class CheckedMemInputArchive;
 class MemOutputArchive;
 class XmlInputArchive;
 class XmlOutputArchive;
@@ -307,6 +308,7 @@ static RegisterSaverHelper <MemOutputArchive,  C> registerHelper6##C(N); \*/
 #define REGISTER_POLYMORPHIC_CLASS_HELPER(B,C,N) \
 static_assert(std::is_base_of_v<B,C>, "must be base and sub class"); \
 static const RegisterLoaderHelper<MemInputArchive,  C> registerHelper3##C(N); \
+static const RegisterLoaderHelper<CheckedMemInputArchive, C> registerHelper7##C(N); \
 static const RegisterSaverHelper <MemOutputArchive, C> registerHelper4##C(N); \
 static const RegisterLoaderHelper<XmlInputArchive,  C> registerHelper5##C(N); \
 static const RegisterSaverHelper <XmlOutputArchive, C> registerHelper6##C(N); \
@@ -315,6 +317,7 @@ template<> struct PolymorphicBaseClass<C> { using type = B; };
 #define REGISTER_POLYMORPHIC_INITIALIZER_HELPER(B,C,N) \
 static_assert(std::is_base_of_v<B,C>, "must be base and sub class"); \
 static const RegisterInitializerHelper<MemInputArchive,  C> registerHelper3##C(N); \
+static const RegisterInitializerHelper<CheckedMemInputArchive, C> registerHelper7##C(N); \
 static const RegisterSaverHelper      <MemOutputArchive, C> registerHelper4##C(N); \
 static const RegisterInitializerHelper<XmlInputArchive,  C> registerHelper5##C(N); \
 static const RegisterSaverHelper      <XmlOutputArchive, C> registerHelper6##C(N); \
@@ -1,5 +1,6 @@
 #include "MSXMixer.hh"
 
+#include "MixHelpers.hh"
 #include "Mixer.hh"
 #include "SoundDevice.hh"
 
@@ -16,6 +17,7 @@
 #include "StringSetting.hh"
 #include "TclObject.hh"
 #include "ThrottleManager.hh"
+#include "WorkerThreads.hh"
 
 #include "Math.hh"
 #include "aligned.hh"
@@ -172,256 +174,6 @@ void MSXMixer::updateStream(EmuTime time)
 }
 
 
-// Various (inner) loops that multiply one buffer by a constant and add the
-// result to a second buffer. Either buffer can be mono or stereo, so if
-// necessary the mono buffer is expanded to stereo. It's possible the
-// accumulation buffer is still empty (as-if it contains zeros), in that case
-// we skip the accumulation step.
-
-// buf[0:n] *= f
-static inline void mul(float* buf, size_t n, float f)
-{
-	// C++ version, unrolled 4x,
-	//   this allows gcc/clang to do much better auto-vectorization
-	// Note that this can process upto 3 samples too many, but that's OK.
-	size_t i = 0;
-	do {
-		buf[i + 0] *= f;
-		buf[i + 1] *= f;
-		buf[i + 2] *= f;
-		buf[i + 3] *= f;
-		i += 4;
-	} while (i < n);
-}
-static inline void mul(std::span<float> buf, float f)
-{
-	assert(!buf.empty());
-	mul(buf.data(), buf.size(), f);
-}
-static inline void mul(std::span<StereoFloat> buf, float f)
-{
-	assert(!buf.empty());
-	mul(&buf.data()->left, 2 * buf.size(), f);
-}
-
-// acc[0:n] += mul[0:n] * f
-static inline void mulAcc(
-	float* __restrict acc, const float* __restrict mul, size_t n, float f)
-{
-	// C++ version, unrolled 4x, see comments above.
-	size_t i = 0;
-	do {
-		acc[i + 0] += mul[i + 0] * f;
-		acc[i + 1] += mul[i + 1] * f;
-		acc[i + 2] += mul[i + 2] * f;
-		acc[i + 3] += mul[i + 3] * f;
-		i += 4;
-	} while (i < n);
-}
-static inline void mulAcc(std::span<float> acc, std::span<const float> mul, float f)
-{
-	assert(!acc.empty());
-	assert(acc.size() == mul.size());
-	mulAcc(acc.data(), mul.data(), acc.size(), f);
-}
-static inline void mulAcc(std::span<StereoFloat> acc, std::span<const StereoFloat> mul, float f)
-{
-	assert(!acc.empty());
-	assert(acc.size() == mul.size());
-	mulAcc(&acc.data()->left, &mul.data()->left, 2 * acc.size(), f);
-}
-
-// buf[0:2n+0:2] = buf[0:n] * l
-// buf[1:2n+1:2] = buf[0:n] * r
-static inline void mulExpand(float* buf, size_t n, float l, float r)
-{
-	size_t i = n;
-	do {
-		--i; // back-to-front
-		auto t = buf[i];
-		buf[2 * i + 0] = l * t;
-		buf[2 * i + 1] = r * t;
-	} while (i != 0);
-}
-static inline void mulExpand(std::span<StereoFloat> buf, float l, float r)
-{
-	mulExpand(&buf.data()->left, buf.size(), l, r);
-}
-
-// acc[0:2n+0:2] += mul[0:n] * l
-// acc[1:2n+1:2] += mul[0:n] * r
-static inline void mulExpandAcc(
-	float* __restrict acc, const float* __restrict mul, size_t n,
-	float l, float r)
-{
-	size_t i = 0;
-	do {
-		auto t = mul[i];
-		acc[2 * i + 0] += l * t;
-		acc[2 * i + 1] += r * t;
-	} while (++i < n);
-}
-static inline void mulExpandAcc(
-	std::span<StereoFloat> acc, std::span<const float> mul, float l, float r)
-{
-	assert(!acc.empty());
-	assert(acc.size() == mul.size());
-	mulExpandAcc(&acc.data()->left, mul.data(), acc.size(), l, r);
-}
-
-// buf[0:2n+0:2] = buf[0:2n+0:2] * l1 + buf[1:2n+1:2] * l2
-// buf[1:2n+1:2] = buf[0:2n+0:2] * r1 + buf[1:2n+1:2] * r2
-static inline void mulMix2(std::span<StereoFloat> buf, float l1, float l2, float r1, float r2)
-{
-	assert(!buf.empty());
-	for (auto& s : buf) {
-		auto t1 = s.left;
-		auto t2 = s.right;
-		s.left  = l1 * t1 + l2 * t2;
-		s.right = r1 * t1 + r2 * t2;
-	}
-}
-
-// acc[0:2n+0:2] += mul[0:2n+0:2] * l1 + mul[1:2n+1:2] * l2
-// acc[1:2n+1:2] += mul[0:2n+0:2] * r1 + mul[1:2n+1:2] * r2
-static inline void mulMix2Acc(
-	std::span<StereoFloat> acc, std::span<const StereoFloat> mul,
-	float l1, float l2, float r1, float r2)
-{
-	assert(!acc.empty());
-	assert(acc.size() == mul.size());
-	auto n = acc.size();
-	size_t i = 0;
-	do {
-		auto t1 = mul[i].left;
-		auto t2 = mul[i].right;
-		acc[i].left  += l1 * t1 + l2 * t2;
-		acc[i].right += r1 * t1 + r2 * t2;
-	} while (++i < n);
-}
-
-
-// DC removal filter routines:
-//
-//  formula:
-//     y(n) = x(n) - x(n-1) + R * y(n-1)
-//  implemented as:
-//     t1 = R * t0 + x(n)    mathematically equivalent, has
-//     y(n) = t1 - t0        the same number of operations but
-//     t0 = t1               requires only one state variable
-//    see: http://en.wikipedia.org/wiki/Digital_filter#Direct_Form_I
-//  with:
-//     R = 1 - (2*pi * cut-off-frequency / sample-rate)
-//  we take R = 511/512
-//   44100Hz --> cutoff freq = 14Hz
-//   22050Hz                     7Hz
-static constexpr auto R = 511.0f / 512.0f;
-
-// No new input, previous output was (non-zero) mono.
-static inline float filterMonoNull(float t0, std::span<StereoFloat> out)
-{
-	assert(!out.empty());
-	for (auto& o : out) {
-		auto t1 = R * t0;
-		auto s = t1 - t0;
-		o.left = s;
-		o.right = s;
-		t0 = t1;
-	}
-	return t0;
-}
-
-// No new input, previous output was (non-zero) stereo.
-static inline std::tuple<float, float> filterStereoNull(
-	float tl0, float tr0, std::span<StereoFloat> out)
-{
-	assert(!out.empty());
-	for (auto& o : out) {
-		float tl1 = R * tl0;
-		float tr1 = R * tr0;
-		o.left  = tl1 - tl0;
-		o.right = tr1 - tr0;
-		tl0 = tl1;
-		tr0 = tr1;
-	}
-	return {tl0, tr0};
-}
-
-// New input is mono, previous output was also mono.
-static inline float filterMonoMono(
-	float t0, std::span<const float> in, std::span<StereoFloat> out)
-{
-	assert(in.size() == out.size());
-	assert(!out.empty());
-	for (auto [i, o] : std::views::zip(in, out)) {
-		auto t1 = R * t0 + i;
-		auto s = t1 - t0;
-		o.left  = s;
-		o.right = s;
-		t0 = t1;
-	}
-	return t0;
-}
-
-// New input is mono, previous output was stereo
-static inline std::tuple<float, float>
-filterStereoMono(float tl0, float tr0,
-                 std::span<const float> in,
-                 std::span<StereoFloat> out)
-{
-	assert(in.size() == out.size());
-	assert(!out.empty());
-	for (auto [i, o] : std::views::zip(in, out)) {
-		auto tl1 = R * tl0 + i;
-		auto tr1 = R * tr0 + i;
-		o.left  = tl1 - tl0;
-		o.right = tr1 - tr0;
-		tl0 = tl1;
-		tr0 = tr1;
-	}
-	return {tl0, tr0};
-}
-
-// New input is stereo, (previous output either mono/stereo)
-static inline std::tuple<float, float>
-filterStereoStereo(float tl0, float tr0,
-                   std::span<const StereoFloat> in,
-                   std::span<StereoFloat> out)
-{
-	assert(in.size() == out.size());
-	assert(!out.empty());
-	for (auto [i, o] : std::views::zip(in, out)) {
-		auto tl1 = R * tl0 + i.left;
-		auto tr1 = R * tr0 + i.right;
-		o.left  = tl1 - tl0;
-		o.right = tr1 - tr0;
-		tl0 = tl1;
-		tr0 = tr1;
-	}
-	return {tl0, tr0};
-}
-
-// We have both mono and stereo input (and produce stereo output)
-static inline std::tuple<float, float>
-filterBothStereo(float tl0, float tr0,
-                 std::span<const float> inM,
-                 std::span<const StereoFloat> inS,
-                 std::span<StereoFloat> out)
-{
-	assert(inM.size() == out.size());
-	assert(inS.size() == out.size());
-	assert(!out.empty());
-	for (auto [im, is, o] : std::views::zip(inM, inS, out)) {
-		auto tl1 = R * tl0 + is.left  + im;
-		auto tr1 = R * tr0 + is.right + im;
-		o.left  = tl1 - tl0;
-		o.right = tr1 - tr0;
-		tl0 = tl1;
-		tr0 = tr1;
-	}
-	return {tl0, tr0};
-}
-
 static bool approxEqual(float x, float y)
 {
 	constexpr float threshold = 1.0f / 32768;
@@ -430,6 +182,7 @@ static bool approxEqual(float x, float y)
 
 void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 {
+	using namespace MixHelpers;
 	Math::DenormalGuard noDenormals; // flush denormals to zero in this scope
 
 	// The code below is specialized for a lot of cases (before this
@@ -465,13 +218,44 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 	auto tmpBufStereo = subspan(tmpBufExtra,    0, samples); // StereoFloat
 	auto tmpBufMono   = std::span{tmpBufPtr, samples};      // float
 
+	// Optionally first generate the output of all devices in parallel
+	// (see the 'sound_threads' setting). The mixing below is still done
+	// sequentially and in the same order, so the result is exactly the
+	// same as without threads.
+	auto numThreads = unsigned(mixer.getSoundThreadsSetting().getInt());
+	bool parallel = (numThreads != 0) && (infos.size() > 1);
+	auto stride = 2 * (samples + 3); // in floats, large enough for stereo
+	if (parallel) {
+		if (!workers || (workers->getNumThreads() != numThreads)) {
+			workers = std::make_unique<WorkerThreads>(numThreads);
+		}
+		if (parallelBuffer.size() < (infos.size() * stride)) {
+			parallelBuffer.resize(infos.size() * stride);
+		}
+		parallelResults.resize(infos.size());
+		workers->run(infos.size(), [&](size_t i) {
+			Math::DenormalGuard guard; // this is per thread
+			parallelResults[i] = infos[i].device->updateBuffer(
+				samples, &parallelBuffer[i * stride], time);
+		});
+	} else if (numThreads == 0) {
+		workers.reset();
+	}
+	auto updateBuffer = [&](size_t i, SoundDevice& device, float* buf) {
+		if (!parallel) return device.updateBuffer(samples, buf, time);
+		if (!parallelResults[i]) return false;
+		auto size = samples * (device.isStereo() ? 2 : 1);
+		std::ranges::copy(std::span{&parallelBuffer[i * stride], size}, buf);
+		return true;
+	};
+
 	constexpr unsigned HAS_MONO_FLAG = 1;
 	constexpr unsigned HAS_STEREO_FLAG = 2;
 	unsigned usedBuffers = 0;
 
 	// TODO: The Infos should be ordered such that all the mono
 	// devices are handled first
-	for (auto& info : infos) {
+	for (auto [i, info] : enumerate(infos)) {
 		SoundDevice& device = *info.device;
 		auto l1 = info.left1;
 		auto r1 = info.right1;
@@ -482,14 +266,14 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 				if (!(usedBuffers & HAS_MONO_FLAG)) {
 					// generate in 'monoBuf' (because it was still empty)
 					// then multiply in-place
-					if (device.updateBuffer(samples, monoBufPtr, time)) {
+					if (updateBuffer(i, device, monoBufPtr)) {
 						usedBuffers |= HAS_MONO_FLAG;
 						mul(monoBuf, l1);
 					}
 				} else {
 					// generate in 'tmpBuf' (as mono data)
 					// then multiply-accumulate into 'monoBuf'
-					if (device.updateBuffer(samples, tmpBufPtr, time)) {
+					if (updateBuffer(i, device, tmpBufPtr)) {
 						mulAcc(monoBuf, tmpBufMono, l1);
 					}
 				}
@@ -498,14 +282,14 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
 					// 'stereoBuf' (which is still empty) is first filled with mono-data,
 					// then in-place expanded to stereo-data
-					if (device.updateBuffer(samples, stereoBufPtr, time)) {
+					if (updateBuffer(i, device, stereoBufPtr)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mulExpand(stereoBuf, l1, r1);
 					}
 				} else {
 					// 'tmpBuf' is first filled with mono-data,
 					// then expanded to stereo and mul-acc into 'stereoBuf'
-					if (device.updateBuffer(samples, tmpBufPtr, time)) {
+					if (updateBuffer(i, device, tmpBufPtr)) {
 						mulExpandAcc(stereoBuf, tmpBufMono, l1, r1);
 					}
 				}
@@ -521,14 +305,14 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
 					// generate in 'stereoBuf' (because it was still empty)
 					// then multiply in-place
-					if (device.updateBuffer(samples, stereoBufPtr, time)) {
+					if (updateBuffer(i, device, stereoBufPtr)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mul(stereoBuf, l1);
 					}
 				} else {
 					// generate in 'tmpBuf' (as stereo data)
 					// then multiply-accumulate into 'stereoBuf'
-					if (device.updateBuffer(samples, tmpBufPtr, time)) {
+					if (updateBuffer(i, device, tmpBufPtr)) {
 						mulAcc(stereoBuf, tmpBufStereo, l1);
 					}
 				}
@@ -538,14 +322,14 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 				if (!(usedBuffers & HAS_STEREO_FLAG)) {
 					// generate in 'stereoBuf' (because it was still empty)
 					// then mix in-place
-					if (device.updateBuffer(samples, stereoBufPtr, time)) {
+					if (updateBuffer(i, device, stereoBufPtr)) {
 						usedBuffers |= HAS_STEREO_FLAG;
 						mulMix2(stereoBuf, l1, l2, r1, r2);
 					}
 				} else {
 					// 'tmpBuf' is first filled with stereo-data,
 					// then mixed into stereoBuf
-					if (device.updateBuffer(samples, tmpBufPtr, time)) {
+					if (updateBuffer(i, device, tmpBufPtr)) {
 						mulMix2Acc(stereoBuf, tmpBufStereo, l1, l2, r1, r2);
 					}
 				}
@@ -588,7 +372,8 @@ void MSXMixer::generate(std::span<StereoFloat> output, EmuTime time)
 		break;
 
 	default: // mono + stereo
-		std::tie(tl0, tr0) = filterBothStereo(tl0, tr0, monoBuf, stereoBuf, output);
+		mulExpandAcc(stereoBuf, monoBuf, 1.0f, 1.0f);
+		std::tie(tl0, tr0) = filterStereoStereo(tl0, tr0, stereoBuf, output);
 	}
 }
 
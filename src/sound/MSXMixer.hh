@@ -7,9 +7,12 @@
 #include "Mixer.hh"
 #include "Schedulable.hh"
 
+#include "MemBuffer.hh"
 #include "Observer.hh"
+#include "aligned.hh"
 #include "dynarray.hh"
 
+#include <cstdint>
 #include <memory>
 #include <span>
 #include <vector>
@@ -28,6 +31,7 @@ class StringSetting;
 class BooleanSetting;
 class Setting;
 class AviRecorder;
+class WorkerThreads;
 
 class MSXMixer final : private Schedulable, private Observer<Setting>
                      , private Observer<SpeedManager>
@@ -190,6 +194,11 @@ private:
 	AviRecorder* recorder = nullptr;
 	unsigned synchronousCounter = 0;
 
+	// see 'sound_threads' setting
+	std::unique_ptr<WorkerThreads> workers;
+	MemBuffer<float, SSE_ALIGNMENT> parallelBuffer;
+	std::vector<uint8_t> parallelResults;
+
 	unsigned muteCount = 1; // start muted
 	float tl0, tr0; // internal DC-filter state
 };
@@ -0,0 +1,399 @@
+#include "MixHelpers.hh"
+
+#include "inline.hh"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+#if defined(__AVX__) || (defined(__x86_64__) && defined(__GNUC__))
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace openmsx::MixHelpers {
+
+// On x86-64 not all CPUs have AVX (all have SSE2). When building with GCC or
+// Clang we can still use AVX by checking for it at run-time.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__AVX__)
+#define MIX_HELPERS_RUNTIME_AVX 1
+#else
+#define MIX_HELPERS_RUNTIME_AVX 0
+#endif
+
+// --- Thin wrappers around the SIMD instructions ---
+//
+// Each struct has a vector type 'V' holding 'N' floats, and the operations
+// needed by the routines below. 'NoSimd' has N=0, in that case only the
+// scalar loops (that otherwise handle the last few samples) are used.
+
+struct NoSimd {
+	static constexpr size_t N = 0;
+};
+
+#ifdef __SSE2__
+struct SSE {
+	using V = __m128;
+	static constexpr size_t N = 4;
+
+	static ALWAYS_INLINE V load(const float* p) { return _mm_loadu_ps(p); }
+	static ALWAYS_INLINE void store(float* p, V v) { _mm_storeu_ps(p, v); }
+	static ALWAYS_INLINE V set1(float f) { return _mm_set1_ps(f); }
+	static ALWAYS_INLINE V set2(float a, float b) { return _mm_setr_ps(a, b, a, b); }
+	static ALWAYS_INLINE V set4(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+	static ALWAYS_INLINE V add(V a, V b) { return _mm_add_ps(a, b); }
+	static ALWAYS_INLINE V sub(V a, V b) { return _mm_sub_ps(a, b); }
+	static ALWAYS_INLINE V mul(V a, V b) { return _mm_mul_ps(a, b); }
+	// (t0, t0, t1, t1) and (t2, t2, t3, t3)
+	static ALWAYS_INLINE void dup(V t, V& lo, V& hi) {
+		lo = _mm_unpacklo_ps(t, t);
+		hi = _mm_unpackhi_ps(t, t);
+	}
+	// (l0, r0, l1, r1) -> (l0, l0, l1, l1) and (r0, r0, r1, r1)
+	static ALWAYS_INLINE void splitLR(V v, V& l, V& r) {
+		l = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+		r = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+	}
+
+	// Only needed for the DC filter:
+	// (0, x0, x1, x2)
+	static ALWAYS_INLINE V shift1(V x) {
+		return _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4));
+	}
+	// (0, 0, x0, x1)
+	static ALWAYS_INLINE V shift2(V x) {
+		return _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8));
+	}
+	// (p3, t0, t1, t2), only called with p = (p3, p3, p3, p3)
+	static ALWAYS_INLINE V prevMono(V p, V t) { return _mm_move_ss(shift1(t), p); }
+	// (t3, t3, t3, t3)
+	static ALWAYS_INLINE V lastMono(V t) { return _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 3, 3, 3)); }
+	// (p0, p1, t0, t1)
+	static ALWAYS_INLINE V prevStereo(V p, V t) { return _mm_movelh_ps(p, t); }
+	// (t2, t3, t2, t3)
+	static ALWAYS_INLINE V lastStereo(V t) { return _mm_movehl_ps(t, t); }
+};
+using Simd4 = SSE;
+#define MIX_HELPERS_SIMD4 1
+
+#elif defined(__ARM_NEON)
+struct NEON {
+	using V = float32x4_t;
+	static constexpr size_t N = 4;
+
+	static ALWAYS_INLINE V load(const float* p) { return vld1q_f32(p); }
+	static ALWAYS_INLINE void store(float* p, V v) { vst1q_f32(p, v); }
+	static ALWAYS_INLINE V set1(float f) { return vdupq_n_f32(f); }
+	static ALWAYS_INLINE V set2(float a, float b) { return set4(a, b, a, b); }
+	static ALWAYS_INLINE V set4(float a, float b, float c, float d) {
+		std::array<float, 4> t = {a, b, c, d};
+		return vld1q_f32(t.data());
+	}
+	static ALWAYS_INLINE V add(V a, V b) { return vaddq_f32(a, b); }
+	static ALWAYS_INLINE V sub(V a, V b) { return vsubq_f32(a, b); }
+	static ALWAYS_INLINE V mul(V a, V b) { return vmulq_f32(a, b); }
+	static ALWAYS_INLINE void dup(V t, V& lo, V& hi) {
+		auto z = vzipq_f32(t, t);
+		lo = z.val[0];
+		hi = z.val[1];
+	}
+	static ALWAYS_INLINE void splitLR(V v, V& l, V& r) {
+		auto z = vtrnq_f32(v, v);
+		l = z.val[0];
+		r = z.val[1];
+	}
+
+	static ALWAYS_INLINE V shift1(V x) { return vextq_f32(vdupq_n_f32(0.0f), x, 3); }
+	static ALWAYS_INLINE V shift2(V x) { return vextq_f32(vdupq_n_f32(0.0f), x, 2); }
+	static ALWAYS_INLINE V prevMono(V p, V t) { return vextq_f32(p, t, 3); }
+	static ALWAYS_INLINE V lastMono(V t) { return vdupq_n_f32(vgetq_lane_f32(t, 3)); }
+	static ALWAYS_INLINE V prevStereo(V p, V t) {
+		return vcombine_f32(vget_low_f32(p), vget_low_f32(t));
+	}
+	static ALWAYS_INLINE V lastStereo(V t) {
+		return vcombine_f32(vget_high_f32(t), vget_high_f32(t));
+	}
+};
+using Simd4 = NEON;
+#define MIX_HELPERS_SIMD4 1
+
+#else
+using Simd4 = NoSimd;
+#define MIX_HELPERS_SIMD4 0
+#endif
+
+// With MIX_HELPERS_RUNTIME_AVX the AVX code (the struct below and the second
+// instantiation of MixHelpers.ii) is compiled with AVX enabled, while the rest
+// of this file is not.
+#if MIX_HELPERS_RUNTIME_AVX
+#ifdef __clang__
+#define MIX_HELPERS_AVX_BEGIN _Pragma("clang attribute push(__attribute__((target(\"avx\"))), apply_to = function)")
+#define MIX_HELPERS_AVX_END _Pragma("clang attribute pop")
+#else
+#define MIX_HELPERS_AVX_BEGIN _Pragma("GCC push_options") _Pragma("GCC target(\"avx\")")
+#define MIX_HELPERS_AVX_END _Pragma("GCC pop_options")
+#endif
+#else
+#define MIX_HELPERS_AVX_BEGIN
+#define MIX_HELPERS_AVX_END
+#endif
+
+#if defined(__AVX__) || MIX_HELPERS_RUNTIME_AVX
+MIX_HELPERS_AVX_BEGIN
+struct AVX {
+	using V = __m256;
+	static constexpr size_t N = 8;
+
+	static ALWAYS_INLINE V load(const float* p) { return _mm256_loadu_ps(p); }
+	static ALWAYS_INLINE void store(float* p, V v) { _mm256_storeu_ps(p, v); }
+	static ALWAYS_INLINE V set1(float f) { return _mm256_set1_ps(f); }
+	static ALWAYS_INLINE V set2(float a, float b) {
+		return _mm256_setr_ps(a, b, a, b, a, b, a, b);
+	}
+	static ALWAYS_INLINE V add(V a, V b) { return _mm256_add_ps(a, b); }
+	static ALWAYS_INLINE V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+	static ALWAYS_INLINE void dup(V t, V& lo, V& hi) {
+		// unpack works per 128-bit lane: (t0 t0 t1 t1 t4 t4 t5 t5) and
+		// (t2 t2 t3 t3 t6 t6 t7 t7), so combine the lanes afterwards
+		auto l = _mm256_unpacklo_ps(t, t);
+		auto h = _mm256_unpackhi_ps(t, t);
+		lo = _mm256_permute2f128_ps(l, h, 0x20);
+		hi = _mm256_permute2f128_ps(l, h, 0x31);
+	}
+	static ALWAYS_INLINE void splitLR(V v, V& l, V& r) {
+		l = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+		r = _mm256_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+	}
+};
+MIX_HELPERS_AVX_END
+#endif
+
+#if defined(__AVX__)
+using Simd = AVX;
+#else
+using Simd = Simd4;
+#endif
+
+#if MIX_HELPERS_RUNTIME_AVX
+[[nodiscard]] static bool useAVX()
+{
+	static const bool result = __builtin_cpu_supports("avx");
+	return result;
+}
+#endif
+
+
+namespace dflt {
+#include "MixHelpers.ii"
+}
+
+#if MIX_HELPERS_RUNTIME_AVX
+MIX_HELPERS_AVX_BEGIN
+namespace avx {
+#include "MixHelpers.ii"
+}
+MIX_HELPERS_AVX_END
+
+// Call the routine for the best available instruction set.
+#define MIX_HELPERS_CALL(NAME, ...) \
+	(useAVX() ? avx::NAME<AVX>(__VA_ARGS__) : dflt::NAME<Simd>(__VA_ARGS__))
+#else
+#define MIX_HELPERS_CALL(NAME, ...) dflt::NAME<Simd>(__VA_ARGS__)
+#endif
+
+void mul(std::span<float> buf, float f)
+{
+	assert(!buf.empty());
+	MIX_HELPERS_CALL(mulImpl, buf.data(), buf.size(), f);
+}
+void mul(std::span<StereoFloat> buf, float f)
+{
+	assert(!buf.empty());
+	MIX_HELPERS_CALL(mulImpl, &buf.data()->left, 2 * buf.size(), f);
+}
+
+void mulAcc(std::span<float> acc, std::span<const float> mul, float f)
+{
+	assert(!acc.empty());
+	assert(acc.size() == mul.size());
+	MIX_HELPERS_CALL(mulAccImpl, acc.data(), mul.data(), acc.size(), f);
+}
+void mulAcc(std::span<StereoFloat> acc, std::span<const StereoFloat> mul, float f)
+{
+	assert(!acc.empty());
+	assert(acc.size() == mul.size());
+	MIX_HELPERS_CALL(mulAccImpl, &acc.data()->left, &mul.data()->left, 2 * acc.size(), f);
+}
+
+void mulExpand(std::span<StereoFloat> buf, float l, float r)
+{
+	assert(!buf.empty());
+	MIX_HELPERS_CALL(mulExpandImpl, &buf.data()->left, buf.size(), l, r);
+}
+
+void mulExpandAcc(std::span<StereoFloat> acc, std::span<const float> mul, float l, float r)
+{
+	assert(!acc.empty());
+	assert(acc.size() == mul.size());
+	MIX_HELPERS_CALL(mulExpandAccImpl, &acc.data()->left, mul.data(), acc.size(), l, r);
+}
+
+void mulMix2(std::span<StereoFloat> buf, float l1, float l2, float r1, float r2)
+{
+	assert(!buf.empty());
+	MIX_HELPERS_CALL(mulMix2Impl, &buf.data()->left, buf.size(), l1, l2, r1, r2);
+}
+
+void mulMix2Acc(std::span<StereoFloat> acc, std::span<const StereoFloat> mul,
+                float l1, float l2, float r1, float r2)
+{
+	assert(!acc.empty());
+	assert(acc.size() == mul.size());
+	MIX_HELPERS_CALL(mulMix2AccImpl, &acc.data()->left, &mul.data()->left, acc.size(),
+	                   l1, l2, r1, r2);
+}
+
+
+// --- DC removal filter ---
+//
+// Unrolling the recursion for a block of 4 samples gives:
+//   t[k] = R^(k+1) * t[-1] + sum_{j=0..k} R^(k-j) * x[j]
+// The sum (a prefix sum weighted with powers of R) can be calculated with two
+// shift+multiply+add steps. Only the last step depends on the previous block,
+// so the serial dependency chain becomes 4 times shorter (for stereo 2 stereo
+// samples are processed per block, so there the gain is only 2x).
+
+float filterMonoNull(float t0, std::span<StereoFloat> out)
+{
+	assert(!out.empty());
+	for (auto& o : out) {
+		auto t1 = R * t0;
+		auto s = t1 - t0;
+		o.left = s;
+		o.right = s;
+		t0 = t1;
+	}
+	return t0;
+}
+
+std::tuple<float, float> filterStereoNull(
+	float tl0, float tr0, std::span<StereoFloat> out)
+{
+	assert(!out.empty());
+	for (auto& o : out) {
+		float tl1 = R * tl0;
+		float tr1 = R * tr0;
+		o.left  = tl1 - tl0;
+		o.right = tr1 - tr0;
+		tl0 = tl1;
+		tr0 = tr1;
+	}
+	return {tl0, tr0};
+}
+
+float filterMonoMono(
+	float t0, std::span<const float> in, std::span<StereoFloat> out)
+{
+	assert(in.size() == out.size());
+	assert(!out.empty());
+	size_t n = in.size();
+	size_t i = 0;
+#if MIX_HELPERS_SIMD4
+	{
+		using S = Simd4;
+		static constexpr float R2 = R * R;
+		static constexpr float R3 = R2 * R;
+		static constexpr float R4 = R3 * R;
+		auto vR  = S::set1(R);
+		auto vR2 = S::set1(R2);
+		auto vRp = S::set4(R, R2, R3, R4);
+		auto t0v = S::set1(t0);
+		auto* o = &out.data()->left;
+		for (; (i + 4) <= n; i += 4) {
+			auto x = S::load(&in[i]);
+			x = S::add(x, S::mul(vR,  S::shift1(x)));
+			x = S::add(x, S::mul(vR2, S::shift2(x)));
+			auto t = S::add(x, S::mul(vRp, t0v));
+			auto s = S::sub(t, S::prevMono(t0v, t));
+			S::V lo, hi;
+			S::dup(s, lo, hi);
+			S::store(o + 2 * i + 0, lo);
+			S::store(o + 2 * i + 4, hi);
+			t0v = S::lastMono(t);
+		}
+		std::array<float, 4> tmp;
+		S::store(tmp.data(), t0v);
+		t0 = tmp[0];
+	}
+#endif
+	for (; i < n; ++i) {
+		auto t1 = R * t0 + in[i];
+		auto s = t1 - t0;
+		out[i].left  = s;
+		out[i].right = s;
+		t0 = t1;
+	}
+	return t0;
+}
+
+std::tuple<float, float> filterStereoMono(
+	float tl0, float tr0, std::span<const float> in, std::span<StereoFloat> out)
+{
+	// This only happens for one fragment after the output switched from
+	// stereo to mono, not worth optimizing.
+	assert(in.size() == out.size());
+	assert(!out.empty());
+	for (size_t i = 0; i < in.size(); ++i) {
+		auto tl1 = R * tl0 + in[i];
+		auto tr1 = R * tr0 + in[i];
+		out[i].left  = tl1 - tl0;
+		out[i].right = tr1 - tr0;
+		tl0 = tl1;
+		tr0 = tr1;
+	}
+	return {tl0, tr0};
+}
+
+std::tuple<float, float> filterStereoStereo(
+	float tl0, float tr0, std::span<const StereoFloat> in, std::span<StereoFloat> out)
+{
+	assert(in.size() == out.size());
+	assert(!out.empty());
+	size_t n = in.size();
+	size_t i = 0;
+#if MIX_HELPERS_SIMD4
+	{
+		using S = Simd4;
+		auto vR  = S::set1(R);
+		auto vRp = S::set4(R, R, R * R, R * R);
+		auto tlr = S::set2(tl0, tr0);
+		const auto* x0 = &in.data()->left;
+		auto* o = &out.data()->left;
+		for (; (i + 2) <= n; i += 2) {
+			auto x = S::load(x0 + 2 * i);
+			x = S::add(x, S::mul(vR, S::shift2(x)));
+			auto t = S::add(x, S::mul(vRp, tlr));
+			S::store(o + 2 * i, S::sub(t, S::prevStereo(tlr, t)));
+			tlr = S::lastStereo(t);
+		}
+		std::array<float, 4> tmp;
+		S::store(tmp.data(), tlr);
+		tl0 = tmp[0];
+		tr0 = tmp[1];
+	}
+#endif
+	for (; i < n; ++i) {
+		auto tl1 = R * tl0 + in[i].left;
+		auto tr1 = R * tr0 + in[i].right;
+		out[i].left  = tl1 - tl0;
+		out[i].right = tr1 - tr0;
+		tl0 = tl1;
+		tr0 = tr1;
+	}
+	return {tl0, tr0};
+}
+
+} // namespace openmsx::MixHelpers
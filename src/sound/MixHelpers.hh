@@ -0,0 +1,93 @@
+#ifndef MIXHELPERS_HH
+#define MIXHELPERS_HH
+
+#include "Mixer.hh"
+
+#include <span>
+#include <tuple>
+
+// Inner loops of MSXMixer::generate().
+//
+// The mixing routines multiply one buffer by a constant and (optionally) add
+// the result to a second buffer. Either buffer can be mono or stereo, so if
+// necessary the mono buffer is expanded to stereo. It's possible the
+// accumulation buffer is still empty (as-if it contains zeros), in that case
+// the non-accumulating variant is used.
+//
+// These routines use SIMD instructions (SSE2, AVX or NEON). On x86-64 AVX is
+// detected at run-time. The results are exactly the same as for the
+// straightforward scalar implementation.
+//
+// The DC removal filter is a recursive filter, so it has a dependency from
+// one sample to the next. The SIMD versions process blocks of samples, and
+// because the calculations are done in a different order the result is only
+// approximately the same as for the scalar implementation (the difference is
+// far below what's audible).
+namespace openmsx::MixHelpers {
+
+// buf[0:n] *= f
+void mul(std::span<float> buf, float f);
+void mul(std::span<StereoFloat> buf, float f);
+
+// acc[0:n] += mul[0:n] * f
+void mulAcc(std::span<float> acc, std::span<const float> mul, float f);
+void mulAcc(std::span<StereoFloat> acc, std::span<const StereoFloat> mul, float f);
+
+// In-place expand mono to stereo: on entry the first half of 'buf' contains
+// mono samples.
+// buf[0:2n+0:2] = buf[0:n] * l
+// buf[1:2n+1:2] = buf[0:n] * r
+void mulExpand(std::span<StereoFloat> buf, float l, float r);
+
+// acc[0:2n+0:2] += mul[0:n] * l
+// acc[1:2n+1:2] += mul[0:n] * r
+void mulExpandAcc(std::span<StereoFloat> acc, std::span<const float> mul, float l, float r);
+
+// buf[0:2n+0:2] = buf[0:2n+0:2] * l1 + buf[1:2n+1:2] * l2
+// buf[1:2n+1:2] = buf[0:2n+0:2] * r1 + buf[1:2n+1:2] * r2
+void mulMix2(std::span<StereoFloat> buf, float l1, float l2, float r1, float r2);
+
+// acc[0:2n+0:2] += mul[0:2n+0:2] * l1 + mul[1:2n+1:2] * l2
+// acc[1:2n+1:2] += mul[0:2n+0:2] * r1 + mul[1:2n+1:2] * r2
+void mulMix2Acc(std::span<StereoFloat> acc, std::span<const StereoFloat> mul,
+                float l1, float l2, float r1, float r2);
+
+
+// DC removal filter routines:
+//
+//  formula:
+//     y(n) = x(n) - x(n-1) + R * y(n-1)
+//  implemented as:
+//     t1 = R * t0 + x(n)    mathematically equivalent, has
+//     y(n) = t1 - t0        the same number of operations but
+//     t0 = t1               requires only one state variable
+//    see: http://en.wikipedia.org/wiki/Digital_filter#Direct_Form_I
+//  with:
+//     R = 1 - (2*pi * cut-off-frequency / sample-rate)
+//  we take R = 511/512
+//   44100Hz --> cutoff freq = 14Hz
+//   22050Hz                     7Hz
+inline constexpr auto R = 511.0f / 512.0f;
+
+// No new input, previous output was (non-zero) mono.
+[[nodiscard]] float filterMonoNull(float t0, std::span<StereoFloat> out);
+
+// No new input, previous output was (non-zero) stereo.
+[[nodiscard]] std::tuple<float, float> filterStereoNull(
+	float tl0, float tr0, std::span<StereoFloat> out);
+
+// New input is mono, previous output was also mono.
+[[nodiscard]] float filterMonoMono(
+	float t0, std::span<const float> in, std::span<StereoFloat> out);
+
+// New input is mono, previous output was stereo.
+[[nodiscard]] std::tuple<float, float> filterStereoMono(
+	float tl0, float tr0, std::span<const float> in, std::span<StereoFloat> out);
+
+// New input is stereo, (previous output either mono/stereo).
+[[nodiscard]] std::tuple<float, float> filterStereoStereo(
+	float tl0, float tr0, std::span<const StereoFloat> in, std::span<StereoFloat> out);
+
+} // namespace openmsx::MixHelpers
+
+#endif
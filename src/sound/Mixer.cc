@@ -50,6 +50,11 @@ Mixer::Mixer(Reactor& reactor_, CommandController& commandController_)
 	, samplesSetting(
 		commandController, "samples",
 		"mixer samples", defaultSamples, 64, 8192)
+	, soundThreadsSetting(
+		commandController, "sound_threads",
+		"number of helper threads used to generate the sound of the "
+		"emulated sound chips in parallel, 0 means all sound is "
+		"generated on the emulation thread", 0, 0, 16)
 {
 	muteSetting       .attach(*this);
 	frequencySetting  .attach(*this);
@@ -57,6 +57,7 @@ public:
 
 	[[nodiscard]] IntegerSetting& getMasterVolume() { return masterVolume; }
 	[[nodiscard]] BooleanSetting& getMuteSetting() { return muteSetting; }
+	[[nodiscard]] IntegerSetting& getSoundThreadsSetting() { return soundThreadsSetting; }
 
 private:
 	void reloadDriver();
@@ -77,6 +78,7 @@ private:
 	IntegerSetting masterVolume;
 	IntegerSetting frequencySetting;
 	IntegerSetting samplesSetting;
+	IntegerSetting soundThreadsSetting;
 
 	int muteCount = 0;
 };
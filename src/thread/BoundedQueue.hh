@@ -0,0 +1,77 @@
+#ifndef BOUNDEDQUEUE_HH
+#define BOUNDEDQUEUE_HH
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace openmsx {
+
+/** A FIFO queue to pass work items from one thread to another.
+  *
+  * The queue holds at most 'capacity' items: push() blocks while the queue
+  * is full. This limits the amount of memory used for pending items, and it
+  * slows down the producer when the consumer can't keep up.
+  */
+template<typename T> class BoundedQueue
+{
+public:
+	explicit BoundedQueue(size_t capacity_)
+		: capacity(capacity_)
+	{
+		assert(capacity > 0);
+	}
+
+	/** Add an item at the back of the queue. Blocks while the queue is
+	  * full. Must not be called anymore after close().
+	  */
+	void push(T t)
+	{
+		std::unique_lock lock(mutex);
+		notFull.wait(lock, [&] { return items.size() < capacity; });
+		assert(!closed);
+		items.push_back(std::move(t));
+		notEmpty.notify_one();
+	}
+
+	/** Remove the item at the front of the queue. Blocks while the queue
+	  * is empty. Returns std::nullopt when the queue is both empty and
+	  * closed.
+	  */
+	[[nodiscard]] std::optional<T> pop()
+	{
+		std::unique_lock lock(mutex);
+		notEmpty.wait(lock, [&] { return !items.empty() || closed; });
+		if (items.empty()) return std::nullopt;
+		std::optional<T> result(std::move(items.front()));
+		items.pop_front();
+		notFull.notify_one();
+		return result;
+	}
+
+	/** Signal that no more items will be pushed. Items that are still in
+	  * the queue can still be popped.
+	  */
+	void close()
+	{
+		std::lock_guard lock(mutex);
+		closed = true;
+		notEmpty.notify_all();
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable notFull;
+	std::condition_variable notEmpty;
+	std::deque<T> items;
+	const size_t capacity;
+	bool closed = false;
+};
+
+} // namespace openmsx
+
+#endif
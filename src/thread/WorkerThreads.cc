@@ -0,0 +1,88 @@
+#include "WorkerThreads.hh"
+
+#include "xrange.hh"
+
+#include <cassert>
+#include <utility>
+
+namespace openmsx {
+
+WorkerThreads::WorkerThreads(unsigned numThreads)
+{
+	threads.reserve(numThreads);
+	repeat(numThreads, [&] {
+		threads.emplace_back([this] { workerLoop(); });
+	});
+}
+
+WorkerThreads::~WorkerThreads()
+{
+	{
+		std::lock_guard lock(mutex);
+		stop = true;
+	}
+	startCond.notify_all();
+	for (auto& t : threads) t.join();
+}
+
+void WorkerThreads::run(size_t count_, function_ref<void(size_t)> job_)
+{
+	{
+		std::lock_guard lock(mutex);
+		assert(busy == 0);
+		job = &job_;
+		count = count_;
+		next = 0;
+		busy = getNumThreads();
+		++generation;
+	}
+	startCond.notify_all();
+
+	executeJobs();
+
+	// Wait till all helper threads are done with this generation, also
+	// those that didn't get any job. After this, no thread refers to
+	// 'job_' anymore.
+	std::unique_lock lock(mutex);
+	doneCond.wait(lock, [&] { return busy == 0; });
+	job = nullptr;
+	if (auto e = std::exchange(exception, nullptr)) {
+		std::rethrow_exception(e);
+	}
+}
+
+void WorkerThreads::executeJobs()
+{
+	while (true) {
+		auto i = next.fetch_add(1);
+		if (i >= count) break;
+		try {
+			(*job)(i);
+		} catch (...) {
+			std::lock_guard lock(mutex);
+			if (!exception) exception = std::current_exception();
+			next = count; // don't start new jobs
+		}
+	}
+}
+
+void WorkerThreads::workerLoop()
+{
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock lock(mutex);
+			startCond.wait(lock, [&] { return stop || (generation != seen); });
+			if (stop) return;
+			seen = generation;
+		}
+		executeJobs();
+		{
+			std::lock_guard lock(mutex);
+			--busy;
+		}
+		doneCond.notify_one();
+	}
+}
+
+} // namespace openmsx
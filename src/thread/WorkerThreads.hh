@@ -0,0 +1,69 @@
+#ifndef WORKERTHREADS_HH
+#define WORKERTHREADS_HH
+
+#include "function_ref.hh"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace openmsx {
+
+/** A fixed set of helper threads to execute a number of independent jobs in
+  * parallel.
+  *
+  * The threads are started once (in the constructor) and then reused for
+  * each run() call, so that run() can be called at a high rate (e.g. for
+  * each sound fragment).
+  */
+class WorkerThreads
+{
+public:
+	explicit WorkerThreads(unsigned numThreads);
+	WorkerThreads(const WorkerThreads&) = delete;
+	WorkerThreads(WorkerThreads&&) = delete;
+	WorkerThreads& operator=(const WorkerThreads&) = delete;
+	WorkerThreads& operator=(WorkerThreads&&) = delete;
+	~WorkerThreads();
+
+	/** Execute job(0) ... job(count - 1). The calling thread also executes
+	  * jobs, this method only returns after all jobs are finished. The
+	  * jobs may run in any order.
+	  * When a job throws, no new jobs are started, and (after the jobs
+	  * that are already running are finished) this method rethrows that
+	  * exception (only the first one, when multiple jobs throw).
+	  */
+	void run(size_t count, function_ref<void(size_t)> job);
+
+	/** The number of helper threads (not including the calling thread). */
+	[[nodiscard]] unsigned getNumThreads() const { return unsigned(threads.size()); }
+
+private:
+	void workerLoop();
+	void executeJobs();
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable startCond;
+	std::condition_variable doneCond;
+
+	// current run() call
+	const function_ref<void(size_t)>* job = nullptr;
+	size_t count = 0;
+	std::atomic<size_t> next = 0;
+	std::exception_ptr exception; // first exception thrown by a job
+
+	uint64_t generation = 0; // incremented on each run() call
+	unsigned busy = 0; // number of threads still working on this generation
+	bool stop = false;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,185 @@
+#include "catch.hpp"
+#include "BitmapConverter.hh"
+
+#include "xrange.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace openmsx;
+using Pixel = BitmapConverter::Pixel;
+
+// Straightforward pixel-at-a-time versions of the conversions, the (possibly
+// SIMD) routines in BitmapConverter must produce exactly the same output.
+struct Palettes {
+	std::array<Pixel, 16 * 2> palette16;
+	std::array<Pixel, 256> palette256;
+	std::vector<Pixel> palette32768 = std::vector<Pixel>(32768);
+};
+
+static int yjkColor(unsigned p, int j, int k)
+{
+	int y = int(p >> 3);
+	int r = std::clamp(y + j,                       0, 31);
+	int g = std::clamp(y + k,                       0, 31);
+	int b = std::clamp((5 * y - 2 * j - k + 2) / 4, 0, 31);
+	return (r << 10) + (g << 5) + b;
+}
+
+static std::vector<Pixel> referenceLine(
+	uint8_t mode, const Palettes& pal,
+	std::span<const uint8_t, 128> vram0, std::span<const uint8_t, 128> vram1)
+{
+	std::vector<Pixel> result;
+	switch (mode) {
+	case DisplayMode::GRAPHIC4:
+		for (auto i : xrange(128)) {
+			result.push_back(pal.palette16[vram0[i] >> 4]);
+			result.push_back(pal.palette16[vram0[i] & 15]);
+		}
+		break;
+	case DisplayMode::GRAPHIC5:
+		for (auto i : xrange(128)) {
+			for (auto n : xrange(4)) {
+				unsigned idx = (vram0[i] >> (6 - 2 * n)) & 3;
+				result.push_back(pal.palette16[idx + ((n & 1) ? 16 : 0)]);
+			}
+		}
+		break;
+	case DisplayMode::GRAPHIC6:
+		for (auto i : xrange(128)) {
+			result.push_back(pal.palette16[vram0[i] >> 4]);
+			result.push_back(pal.palette16[vram0[i] & 15]);
+			result.push_back(pal.palette16[vram1[i] >> 4]);
+			result.push_back(pal.palette16[vram1[i] & 15]);
+		}
+		break;
+	case DisplayMode::GRAPHIC7:
+		for (auto i : xrange(128)) {
+			result.push_back(pal.palette256[vram0[i]]);
+			result.push_back(pal.palette256[vram1[i]]);
+		}
+		break;
+	case DisplayMode::GRAPHIC7 | DisplayMode::YJK:
+	case DisplayMode::GRAPHIC7 | DisplayMode::YJK | DisplayMode::YAE:
+		for (auto i : xrange(64)) {
+			std::array<unsigned, 4> p = {
+				vram0[2 * i + 0], vram1[2 * i + 0],
+				vram0[2 * i + 1], vram1[2 * i + 1],
+			};
+			auto sext6 = [](unsigned lo, unsigned hi) {
+				int v = int((lo & 7) | ((hi & 7) << 3));
+				return (v >= 32) ? (v - 64) : v;
+			};
+			int k = sext6(p[0], p[1]);
+			int j = sext6(p[2], p[3]);
+			for (auto n : xrange(4)) {
+				bool yae = (mode & DisplayMode::YAE) && (p[n] & 8);
+				result.push_back(yae ? pal.palette16[p[n] >> 4]
+				                     : pal.palette32768[yjkColor(p[n], j, k)]);
+			}
+		}
+		break;
+	default:
+		REQUIRE(false);
+	}
+	return result;
+}
+
+static constexpr std::array<uint8_t, 6> modes = {
+	DisplayMode::GRAPHIC4,
+	DisplayMode::GRAPHIC5,
+	DisplayMode::GRAPHIC6,
+	DisplayMode::GRAPHIC7,
+	DisplayMode::GRAPHIC7 | DisplayMode::YJK,
+	DisplayMode::GRAPHIC7 | DisplayMode::YJK | DisplayMode::YAE,
+};
+
+// Only for the (bitmap) modes above: M1 and M2 are zero.
+static DisplayMode makeDisplayMode(uint8_t mode)
+{
+	return {uint8_t((mode & 0x1C) >> 1), 0, uint8_t((mode & 0x60) >> 2)};
+}
+
+static void convert(BitmapConverter& converter, uint8_t mode, std::span<Pixel> buf,
+                    std::span<const uint8_t, 128> vram0, std::span<const uint8_t, 128> vram1)
+{
+	if (makeDisplayMode(mode).isPlanar()) {
+		converter.convertLinePlanar(buf, vram0, vram1);
+	} else {
+		converter.convertLine(buf, vram0);
+	}
+}
+
+static void randomize(std::mt19937& rng, std::span<Pixel> pixels)
+{
+	for (auto& p : pixels) p = Pixel(rng());
+}
+
+TEST_CASE("BitmapConverter")
+{
+	std::mt19937 rng(1234);
+	Palettes pal;
+	randomize(rng, pal.palette16);
+	randomize(rng, pal.palette256);
+	randomize(rng, pal.palette32768);
+	BitmapConverter converter(pal.palette16, pal.palette256,
+	                          std::span<const Pixel, 32768>(pal.palette32768));
+
+	for (auto mode : modes) {
+		converter.setDisplayMode(makeDisplayMode(mode));
+		for (auto iter : xrange(100)) {
+			if ((iter % 10) == 0) {
+				// also when the 16-color palette changes
+				randomize(rng, pal.palette16);
+				converter.palette16Changed();
+			}
+			std::array<uint8_t, 128> vram0, vram1;
+			for (auto& b : vram0) b = uint8_t(rng());
+			for (auto& b : vram1) b = uint8_t(rng());
+
+			auto expected = referenceLine(mode, pal, vram0, vram1);
+			// detect pixels that are not written
+			std::vector<Pixel> buf(expected.size() + 1, 0x12345678);
+			convert(converter, mode, buf, vram0, vram1);
+			CHECK(buf.back() == 0x12345678);
+			buf.pop_back();
+			CHECK(buf == expected);
+		}
+	}
+}
+
+TEST_CASE("BitmapConverter: benchmark", "[.][benchmark]")
+{
+	// Convert 212 lines, 60 frames (one second of emulated time).
+	std::mt19937 rng(42);
+	Palettes pal;
+	randomize(rng, pal.palette16);
+	randomize(rng, pal.palette256);
+	randomize(rng, pal.palette32768);
+	BitmapConverter converter(pal.palette16, pal.palette256,
+	                          std::span<const Pixel, 32768>(pal.palette32768));
+	std::vector<uint8_t> vram(0x20000);
+	for (auto& b : vram) b = uint8_t(rng());
+	std::array<Pixel, 512> buf;
+
+	for (auto mode : modes) {
+		converter.setDisplayMode(makeDisplayMode(mode));
+		BENCHMARK("mode " + std::to_string(mode) + ", 212 lines x 60 frames") {
+			for (auto frame : xrange(60)) {
+				for (auto line : xrange(212)) {
+					auto offset = 128 * ((frame + line) % 512);
+					std::span<const uint8_t, 128> vram0{&vram[offset], 128};
+					std::span<const uint8_t, 128> vram1{&vram[offset + 0x10000], 128};
+					convert(converter, mode, buf, vram0, vram1);
+				}
+			}
+			return buf[0];
+		};
+	}
+}
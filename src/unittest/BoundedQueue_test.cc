@@ -0,0 +1,43 @@
+#include "catch.hpp"
+#include "BoundedQueue.hh"
+
+#include "xrange.hh"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace openmsx;
+
+TEST_CASE("BoundedQueue: single thread")
+{
+	BoundedQueue<std::unique_ptr<int>> queue(3);
+	queue.push(std::make_unique<int>(1));
+	queue.push(std::make_unique<int>(2));
+	CHECK(*queue.pop().value() == 1);
+	queue.push(std::make_unique<int>(3));
+	queue.push(std::make_unique<int>(4));
+	queue.close();
+	// remaining items can still be popped after close()
+	CHECK(*queue.pop().value() == 2);
+	CHECK(*queue.pop().value() == 3);
+	CHECK(*queue.pop().value() == 4);
+	CHECK(!queue.pop());
+	CHECK(!queue.pop());
+}
+
+TEST_CASE("BoundedQueue: producer/consumer")
+{
+	// A small queue, so the producer regularly has to wait.
+	BoundedQueue<int> queue(2);
+	std::vector<int> received;
+	std::thread consumer([&] {
+		while (auto i = queue.pop()) received.push_back(*i);
+	});
+	for (auto i : xrange(1000)) queue.push(i);
+	queue.close();
+	consumer.join();
+
+	REQUIRE(received.size() == 1000);
+	for (auto i : xrange(1000)) CHECK(received[i] == i);
+}
@@ -0,0 +1,115 @@
+#include "catch.hpp"
+#include "CompiledCondition.hh"
+
+#include "Debuggable.hh"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+using namespace openmsx;
+
+namespace {
+
+class TestDebuggable final : public Debuggable
+{
+public:
+	explicit TestDebuggable(unsigned size) : data(size) {}
+	[[nodiscard]] unsigned getSize() const override { return unsigned(data.size()); }
+	[[nodiscard]] std::string_view getDescription() const override { return "test"; }
+	[[nodiscard]] uint8_t read(unsigned address) override { return data[address]; }
+	void write(unsigned address, uint8_t value) override { data[address] = value; }
+
+	std::vector<uint8_t> data;
+};
+
+} // namespace
+
+static std::optional<bool> eval(std::string_view expr, Debuggable* memory = nullptr, Debuggable* regs = nullptr)
+{
+	auto c = CompiledCondition::compile(expr);
+	REQUIRE(c);
+	return c->evaluate(memory, regs);
+}
+
+TEST_CASE("CompiledCondition: unsupported")
+{
+	// these must be handled by Tcl
+	for (std::string_view expr : {
+		"", "1 +", "(1", "1)", "1 2", "1 = 1", "1 ** 2", "1.5", "1e3", "010",
+		"0x", "abc", "\"a\" eq \"b\"", "$x == 1", "[foo]", "[reg]",
+		"[reg XYZ]", "[peek]", "[peek 1 memory]", "[peek $a]", "[reg A",
+		"[debug read vram 0]", "[debug read {CPU regs} 28]", "abs(-1)",
+		"1 ? 2", "[pc_in_slot 1]",
+	}) {
+		INFO(expr);
+		CHECK(!CompiledCondition::compile(expr));
+	}
+}
+
+TEST_CASE("CompiledCondition: arithmetic")
+{
+	CHECK(eval("1") == true);
+	CHECK(eval("0") == false);
+	CHECK(eval(" 0x10 == 16 ") == true);
+	CHECK(eval("0b101 == 5 && 0o17 == 15") == true);
+	CHECK(eval("1 + 2 * 3 == 7") == true);
+	CHECK(eval("(1 + 2) * 3 == 9") == true);
+	CHECK(eval("10 - 2 - 3 == 5") == true); // left associative
+	CHECK(eval("-3 + +4 == 1") == true);
+	CHECK(eval("!0 == 1 && !5 == 0") == true);
+	CHECK(eval("~0 == -1") == true);
+	CHECK(eval("1 << 4 == 16 && 256 >> 4 == 16 && -16 >> 2 == -4") == true);
+	CHECK(eval("(6 & 3) == 2 && (6 | 3) == 7 && (6 ^ 3) == 5") == true);
+	CHECK(eval("1 < 2 && 2 <= 2 && 3 > 2 && 3 >= 3 && 1 != 2") == true);
+	CHECK(eval("2 < 1") == false);
+	CHECK(eval("1 == 2 || 3 == 3") == true);
+	CHECK(eval("1 ? 0 : 1") == false);
+	CHECK(eval("0 ? 0 : 1") == true);
+	CHECK(eval("0 ? 1 : 0 ? 0 : 1") == true);
+	// Tcl rounds integer division towards negative infinity
+	CHECK(eval("7 / 2 == 3 && -7 / 2 == -4 && 7 / -2 == -4") == true);
+	CHECK(eval("7 % 3 == 1 && -7 % 3 == 2 && 7 % -3 == -2") == true);
+	// short-circuit evaluation
+	CHECK(eval("0 && (1 / 0)") == false);
+	CHECK(eval("1 || (1 / 0)") == true);
+	// errors (and overflow) are handled by falling back to Tcl
+	CHECK(eval("1 / 0") == std::nullopt);
+	CHECK(eval("1 % 0") == std::nullopt);
+	CHECK(eval("1 << -1") == std::nullopt);
+	CHECK(eval("0x7fffffffffffffff + 1") == std::nullopt);
+	CHECK(eval("0x100000000 * 0x100000000") == std::nullopt);
+}
+
+TEST_CASE("CompiledCondition: registers and memory")
+{
+	TestDebuggable memory(0x10000);
+	TestDebuggable regs(28);
+	regs.data[0] = 0x12; // A
+	regs.data[1] = 0x34; // F
+	regs.data[6] = 0xC0; // H
+	regs.data[7] = 0x00; // L
+	memory.data[0xC000] = 0x78;
+	memory.data[0xC001] = 0x56;
+	memory.data[0xFFFF] = 0x99;
+
+	CHECK(eval("[reg A] == 0x12", &memory, &regs) == true);
+	CHECK(eval("[reg a] == 0x12", &memory, &regs) == true);
+	CHECK(eval("[reg AF] == 0x1234", &memory, &regs) == true);
+	CHECK(eval("[reg A]==3", &memory, &regs) == false);
+	CHECK(eval("[debug read {CPU regs} 1] == 0x34", &memory, &regs) == true);
+	CHECK(eval("[debug read \"CPU regs\" 1] == 0x34", &memory, &regs) == true);
+	CHECK(eval("[peek 0xC000] == 0x78", &memory, &regs) == true);
+	CHECK(eval("[peek16 0xC000] == 0x5678", &memory, &regs) == true);
+	CHECK(eval("[peek [reg HL]] == 0x78", &memory, &regs) == true);
+	CHECK(eval("[peek_u16 [reg HL]] == 0x5678", &memory, &regs) == true);
+	CHECK(eval("[debug read memory 65535] == 0x99", &memory, &regs) == true);
+	CHECK(eval("[reg A] == 0x12 && [peek 0xC001] != 0", &memory, &regs) == true);
+	// out of range
+	CHECK(eval("[peek16 0xFFFF]", &memory, &regs) == std::nullopt);
+	CHECK(eval("[peek 0x10000]", &memory, &regs) == std::nullopt);
+	// debuggable not available
+	CHECK(eval("[reg A]", &memory, nullptr) == std::nullopt);
+	CHECK(eval("[peek 0]", nullptr, &regs) == std::nullopt);
+}
@@ -0,0 +1,84 @@
+#include "catch.hpp"
+#include "CoverageMap.hh"
+
+#include "MSXException.hh"
+
+#include <sstream>
+
+using namespace openmsx;
+using Location = CoverageMap::Location;
+
+static Location loc(unsigned ps, std::optional<unsigned> ss, std::optional<unsigned> segment, uint16_t addr)
+{
+	Location result = addr | (Location(ps) << 16);
+	if (ss) result |= (Location(*ss) << 18) | (Location(1) << 20);
+	if (segment) result |= Location(*segment + 1) << 21;
+	return result;
+}
+
+TEST_CASE("CodeLocator: parseSlot")
+{
+	auto check = [](Location l) {
+		auto str = CodeLocator::slotToString(l);
+		auto parsed = CodeLocator::parseSlot(str);
+		REQUIRE(parsed);
+		CHECK(*parsed == (l & ~Location(0xFFFF)));
+	};
+	check(loc(0, {}, {}, 0));
+	check(loc(3, 2, {}, 0));
+	check(loc(1, {}, 17, 0));
+	check(loc(2, 1, 255, 0));
+
+	CHECK(!CodeLocator::parseSlot(""));
+	CHECK(!CodeLocator::parseSlot("4"));
+	CHECK(!CodeLocator::parseSlot("1-4"));
+	CHECK(!CodeLocator::parseSlot("1 page 3"));
+	CHECK(!CodeLocator::parseSlot("1 segment x"));
+}
+
+TEST_CASE("CoverageMap")
+{
+	CoverageMap map;
+	map.mark(loc(0, {}, {}, 0x0000));
+	map.mark(loc(0, {}, {}, 0x0003));
+	map.mark(loc(1, {}, 2, 0x4010)); // same address, different segments
+	map.mark(loc(1, {}, 3, 0x4010));
+	map.mark(loc(0, {}, {}, 0x0003)); // already marked
+	map.mark(loc(3, 2, 7, 0xC000));
+	CHECK(map.numRegions() == 4);
+	CHECK(map.count() == 5);
+	CHECK( map.isCovered(loc(1, {}, 2, 0x4010)));
+	CHECK(!map.isCovered(loc(1, {}, 4, 0x4010)));
+	CHECK(!map.isCovered(loc(0, {}, {}, 0x0001)));
+
+	// save + merge results in the same data
+	std::ostringstream os;
+	map.save(os);
+	CoverageMap map2;
+	map2.merge(os.str());
+	CHECK(map2.numRegions() == 4);
+	CHECK(map2.count() == 5);
+	std::ostringstream os2;
+	map2.save(os2);
+	CHECK(os.str() == os2.str());
+
+	// merging adds to the existing data
+	map2.merge("SF:1 segment 2\n"
+	           "DA:16400,3\n"
+	           "DA:16401,0\n"         // not executed
+	           "DA:16402,1,abcdef\n"  // with checksum
+	           "end_of_record\r\n");
+	CHECK(map2.count() == 6);
+	CHECK( map2.isCovered(loc(1, {}, 2, 16402)));
+	CHECK(!map2.isCovered(loc(1, {}, 2, 16401)));
+
+	CHECK_THROWS_AS(map2.merge("DA:1,1\n"), MSXException);
+	CHECK_THROWS_AS(map2.merge("SF:foo\n"), MSXException);
+	CHECK_THROWS_AS(map2.merge("SF:1\nDA:65536,1\n"), MSXException);
+
+	map.clear();
+	CHECK(map.numRegions() == 0);
+	CHECK(map.count() == 0);
+	map.mark(loc(0, {}, {}, 0x0038));
+	CHECK(map.count() == 1);
+}
@@ -0,0 +1,226 @@
+#include "catch.hpp"
+#include "DeltaBlock.hh"
+
+#include "strCat.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <span>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace openmsx;
+
+// Straightforward byte-at-a-time version of the delta encoding, only used to
+// calculate the expected size of the (optimized) encoding.
+static size_t ulebSize(size_t value)
+{
+	size_t result = 1;
+	while (value >>= 7) ++result;
+	return result;
+}
+
+static size_t referenceDeltaSize(std::span<const uint8_t> oldBuf, std::span<const uint8_t> newBuf)
+{
+	REQUIRE(oldBuf.size() == newBuf.size());
+	auto size = newBuf.size();
+	size_t i = 0;
+	while ((i != size) && (oldBuf[i] == newBuf[i])) ++i;
+	size_t result = ulebSize(i);
+	while (i != size) {
+		auto start = i;
+		size_t n2 = 0, n3 = 0;
+		while (true) {
+			++i; // skip the known different byte
+			while ((i != size) && (oldBuf[i] != newBuf[i])) ++i;
+			auto equalStart = i;
+			while ((i != size) && (oldBuf[i] == newBuf[i])) ++i;
+			n3 = i - equalStart;
+			if ((i == size) || (n3 > 2)) {
+				n2 = equalStart - start;
+				break;
+			}
+		}
+		result += ulebSize(n2) + n2;
+		if (n3 != 0) result += ulebSize(n3);
+	}
+	return result;
+}
+
+static void check(std::span<const uint8_t> oldBuf, std::span<const uint8_t> newBuf, bool compress)
+{
+	auto ref = std::make_shared<DeltaBlockCopy>(oldBuf);
+	DeltaBlockDiff diff(ref, newBuf);
+	CHECK(diff.getDeltaSize() == referenceDeltaSize(oldBuf, newBuf));
+
+	if (compress) {
+		std::unordered_set<const DeltaBlock*> seen;
+		auto before = ref->getMemorySize(seen);
+		auto saved = ref->compress(oldBuf.size());
+		seen.clear();
+		CHECK(ref->getMemorySize(seen) == before - saved);
+	}
+	std::vector<uint8_t> out(newBuf.size());
+	diff.apply(out);
+	CHECK(std::ranges::equal(out, newBuf));
+
+	std::vector<uint8_t> out2(oldBuf.size());
+	ref->apply(out2);
+	CHECK(std::ranges::equal(out2, oldBuf));
+}
+
+TEST_CASE("DeltaBlock")
+{
+	std::mt19937 rng(12345);
+	auto randomByte = [&] { return uint8_t(rng()); };
+
+	for (size_t size : {0, 1, 2, 3, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 1000, 4096, 65536 + 7}) {
+		// Try different alignments of the new buffer relative to the
+		// (aligned) reference copy.
+		for (size_t offset : {0, 1, 7, 16, 31}) {
+			std::vector<uint8_t> oldBuf(size);
+			for (auto& b : oldBuf) b = randomByte();
+			std::vector<uint8_t> storage(size + offset);
+			std::span newBuf{storage.data() + offset, size};
+			auto reset = [&] { std::ranges::copy(oldBuf, newBuf.begin()); };
+
+			// equal
+			reset();
+			check(oldBuf, newBuf, false);
+
+			// all different
+			for (auto i : xrange(size)) newBuf[i] = uint8_t(~oldBuf[i]);
+			check(oldBuf, newBuf, true);
+
+			// first and last byte
+			reset();
+			if (size) {
+				newBuf.front() ^= 1;
+				newBuf.back() ^= 0x80;
+			}
+			check(oldBuf, newBuf, false);
+
+			// sparse changes
+			reset();
+			for (size_t i = 0; i < size / 20; ++i) {
+				newBuf[rng() % size] ^= uint8_t(1 + rng() % 255);
+			}
+			check(oldBuf, newBuf, true);
+
+			// runs of changes with small gaps
+			reset();
+			for (size_t i = 0; i < size; i += 1 + rng() % 40) {
+				auto len = std::min<size_t>(rng() % 5, size - i);
+				for (auto j : xrange(len)) newBuf[i + j] ^= 0x55;
+			}
+			check(oldBuf, newBuf, false);
+		}
+	}
+}
+
+TEST_CASE("LastDeltaBlocks")
+{
+	std::mt19937 rng(42);
+	std::vector<uint8_t> mem(16384);
+	for (auto& b : mem) b = uint8_t(rng());
+
+	// Simulate a series of snapshots of the same (slowly changing) blob.
+	// This switches reference blocks several times, so it also exercises
+	// the background compression.
+	LastDeltaBlocks lastDeltaBlocks;
+	std::vector<std::vector<uint8_t>> states;
+	std::vector<std::shared_ptr<DeltaBlock>> blocks;
+	for (int i = 0; i < 100; ++i) {
+		for (int j = 0; j < 500; ++j) mem[rng() % mem.size()] = uint8_t(rng());
+		blocks.push_back(lastDeltaBlocks.createNew(mem.data(), mem));
+		states.push_back(mem);
+	}
+	lastDeltaBlocks.clear();
+
+	// Recompress (some) reference blocks with the strong codec, this
+	// should not change the content.
+	for (auto i : xrange(blocks.size() / 2)) {
+		if (blocks[i]->canCompressStrong()) {
+			std::unordered_set<const DeltaBlock*> seen;
+			auto before = blocks[i]->getMemorySize(seen);
+			auto saved = blocks[i]->compressStrong();
+			CHECK(!blocks[i]->canCompressStrong());
+			seen.clear();
+			CHECK(blocks[i]->getMemorySize(seen) == before - saved);
+		}
+	}
+
+	for (auto i : xrange(blocks.size())) {
+		std::vector<uint8_t> out(mem.size());
+		blocks[i]->apply(out);
+		CHECK(out == states[i]);
+	}
+}
+
+static constexpr std::array<std::pair<MismatchScan, std::string_view>, 4> mismatchScans = {{
+	{MismatchScan::SCALAR, "scalar"},
+	{MismatchScan::SSE2,   "SSE2"},
+	{MismatchScan::NEON,   "NEON"},
+	{MismatchScan::AVX2,   "AVX2"},
+}};
+
+TEST_CASE("DeltaBlock: mismatch scan")
+{
+	CHECK(isSupported(MismatchScan::SCALAR));
+
+	std::mt19937 rng(321);
+	for (size_t size : {0, 1, 15, 31, 32, 33, 63, 64, 65, 100, 1000, 4096 + 3}) {
+		for (size_t offsetP : {0, 1, 16}) {
+			for (size_t offsetQ : {0, 1, 16}) {
+				std::vector<uint8_t> storageP(size + offsetP);
+				std::vector<uint8_t> storageQ(size + offsetQ);
+				std::span p{storageP.data() + offsetP, size};
+				std::span q{storageQ.data() + offsetQ, size};
+				for (auto& b : p) b = uint8_t(rng());
+				std::ranges::copy(p, q.begin());
+				std::vector<uint8_t> pOrig(p.begin(), p.end());
+
+				// a mismatch at every position (and none at all)
+				for (auto pos : xrange(size + 1)) {
+					if (pos != size) q[pos] ^= 0x10;
+					auto expected = std::mismatch(p.begin(), p.end(), q.begin()).first - p.begin();
+					for (auto [scan, name] : mismatchScans) {
+						if (!isSupported(scan)) continue;
+						INFO(name << " size " << size << " pos " << pos
+						     << " offsets " << offsetP << ' ' << offsetQ);
+						auto [rp, rq] = scanMismatch(scan, p.data(), p.data() + size,
+						                                   q.data(), q.data() + size);
+						CHECK((rp - p.data()) == expected);
+						CHECK((rq - q.data()) == expected);
+					}
+					// the sentinel must have been restored
+					CHECK(std::ranges::equal(p, pOrig));
+					if (pos != size) q[pos] ^= 0x10;
+				}
+			}
+		}
+	}
+}
+
+TEST_CASE("DeltaBlock: mismatch scan benchmark", "[.][benchmark]")
+{
+	for (size_t size : {64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024}) {
+		// equal up to the last byte, so the whole buffer is scanned
+		std::vector<uint8_t> p(size, 0x5A);
+		std::vector<uint8_t> q(size, 0x5A);
+		q.back() = 0xA5;
+		for (auto [scan, name] : mismatchScans) {
+			if (!isSupported(scan)) continue;
+			BENCHMARK(strCat(name, ", ", size / 1024, "kB")) {
+				return scanMismatch(scan, p.data(), p.data() + size,
+				                          q.data(), q.data() + size).first;
+			};
+		}
+	}
+}
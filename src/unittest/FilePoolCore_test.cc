@@ -3,11 +3,15 @@
 #include "FilePoolCore.hh"
 #include "File.hh"
 #include "FileOperations.hh"
+#include "Date.hh"
 #include "one_of.hh"
+#include "strCat.hh"
 #include "StringOp.hh"
 #include "Timer.hh"
+#include <array>
 #include <iostream>
 #include <fstream>
+#include <zlib.h>
 
 using namespace openmsx;
 
@@ -17,17 +21,61 @@ static void createFile(const std::string& filename, const std::string& content)
 	of << content;
 }
 
-static std::vector<std::string> readLines(const std::string& filename)
+static void createBinaryFile(const std::string& filename, std::span<const uint8_t> content)
 {
-	std::vector<std::string> result;
-	std::ifstream is(filename);
-	std::string line;
-	while (std::getline(is, line)) {
-		result.push_back(line);
-	}
+	std::ofstream of(filename, std::ios::binary);
+	of.write(std::bit_cast<const char*>(content.data()), std::streamsize(content.size()));
+}
+
+// windowBits: -15 for raw deflate data, 15 + 16 for a gzip stream
+static std::vector<uint8_t> compress(std::string_view content, int windowBits)
+{
+	z_stream s = {};
+	REQUIRE(deflateInit2(&s, Z_BEST_SPEED, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+	std::vector<uint8_t> result(deflateBound(&s, uLong(content.size())));
+	s.next_in = std::bit_cast<Bytef*>(content.data());
+	s.avail_in = uInt(content.size());
+	s.next_out = result.data();
+	s.avail_out = uInt(result.size());
+	REQUIRE(deflate(&s, Z_FINISH) == Z_STREAM_END);
+	result.resize(s.total_out);
+	deflateEnd(&s);
 	return result;
 }
 
+static void createGzFile(const std::string& filename, std::string_view content)
+{
+	createBinaryFile(filename, compress(content, 15 + 16));
+}
+
+// Only the local file header, that's all ZipFileAdapter looks at.
+static void createZipFile(const std::string& filename, std::string_view name, std::string_view content)
+{
+	auto data = compress(content, -15);
+	std::vector<uint8_t> zip;
+	auto put16 = [&](unsigned v) { zip.push_back(uint8_t(v)); zip.push_back(uint8_t(v >> 8)); };
+	auto put32 = [&](unsigned v) { put16(v & 0xffff); put16(v >> 16); };
+	put32(0x04034B50); // signature
+	put16(20); // version needed to extract
+	put16(0); // general purpose bit flag
+	put16(8); // compression method: deflate
+	put16(0); put16(0); // last mod file time and date
+	put32(unsigned(crc32(0, std::bit_cast<const Bytef*>(content.data()), uInt(content.size()))));
+	put32(unsigned(data.size()));
+	put32(unsigned(content.size()));
+	put16(unsigned(name.size()));
+	put16(0); // extra field length
+	zip.insert(zip.end(), name.begin(), name.end());
+	zip.insert(zip.end(), data.begin(), data.end());
+	createBinaryFile(filename, zip);
+}
+
+static std::string readFile(const std::string& filename)
+{
+	std::ifstream is(filename, std::ios::binary);
+	return {std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+}
+
 TEST_CASE("FilePoolCore")
 {
 	auto tmp = FileOperations::getTempDir() + "/filepool_unittest";
@@ -119,19 +167,226 @@ TEST_CASE("FilePoolCore")
 		}
 	}
 
-	// write 'filecache' to disk
-	auto lines = readLines(tmp + "/cache");
-	CHECK(lines.size() == 4);
-	CHECK(lines[0].starts_with("637a81ed8e8217bb01c15c67c39b43b0ab4e20f1"));
-	CHECK(lines[0].ends_with(tmp + "/e"));
-	CHECK(lines[1].starts_with("7e240de74fb1ed08fa08d38063f6a6a91462a815"));
-	CHECK((lines[1].ends_with(tmp + "/a") ||
-	       lines[1].ends_with(tmp + "/a2")));
-	CHECK(lines[2].starts_with("7e240de74fb1ed08fa08d38063f6a6a91462a815"));
-	CHECK((lines[2].ends_with(tmp + "/a") ||
-	       lines[2].ends_with(tmp + "/a2")));
-	CHECK(lines[3].starts_with("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2"));
-	CHECK(lines[3].ends_with(tmp + "/c"));
+	// 'filecache' was written to disk, reload it without scanning directories
+	{
+		FilePoolCore pool(tmp + "/cache",
+				  [] { return FilePoolCore::Directories{}; },
+				  [](std::string_view, float) { /* report progress: nothing */});
+		auto check = [&](const char* sum, auto... names) {
+			auto [file, fname] = pool.getFile(FileType::ROM, Sha1Sum(sum));
+			CHECK(file.is_open());
+			CHECK(fname == one_of(names...));
+		};
+		check("637a81ed8e8217bb01c15c67c39b43b0ab4e20f1", tmp + "/e");
+		check("7e240de74fb1ed08fa08d38063f6a6a91462a815", tmp + "/a", tmp + "/a2");
+		check("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2", tmp + "/c");
+		auto [file, fname] = pool.getFile(FileType::ROM, Sha1Sum("5cb138284d431abd6a053a56625ec088bfb88912"));
+		CHECK(!file.is_open());
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
+
+TEST_CASE("FilePoolCore: text filecache")
+{
+	auto tmp = FileOperations::getTempDir() + "/filepool_unittest2";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp);
+	createFile(tmp + "/a",  "aaa"); // 7e240de74fb1ed08fa08d38063f6a6a91462a815
+	auto st = FileOperations::getStat(tmp + "/a");
+	REQUIRE(st);
+	std::array<char, 24> buf;
+	auto time = Date::toString(FileOperations::getModificationDate(*st), buf);
+	// The filename in this (old) text format doesn't point to an actual file.
+	createFile(tmp + "/cache", strCat(
+		"7e240de74fb1ed08fa08d38063f6a6a91462a815  ", time, "  ", tmp, "/a\n",
+		"f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2  ", time, "  ", tmp, "/not-present\n"));
+
+	{
+		FilePoolCore pool(tmp + "/cache",
+				  [] { return FilePoolCore::Directories{}; },
+				  [](std::string_view, float) { /* report progress: nothing */});
+		auto [file1, fname1] = pool.getFile(FileType::ROM, Sha1Sum("7e240de74fb1ed08fa08d38063f6a6a91462a815"));
+		CHECK(file1.is_open());
+		CHECK(fname1 == tmp + "/a");
+		auto [file2, fname2] = pool.getFile(FileType::ROM, Sha1Sum("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2"));
+		CHECK(!file2.is_open());
+	}
+	// converted to the binary format
+	CHECK(readFile(tmp + "/cache").starts_with("openMSXfilecache"));
+	{
+		FilePoolCore pool(tmp + "/cache",
+				  [] { return FilePoolCore::Directories{}; },
+				  [](std::string_view, float) { /* report progress: nothing */});
+		auto [file, fname] = pool.getFile(FileType::ROM, Sha1Sum("7e240de74fb1ed08fa08d38063f6a6a91462a815"));
+		CHECK(file.is_open());
+		CHECK(fname == tmp + "/a");
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
+
+TEST_CASE("FilePoolCore: many files")
+{
+	// More files than are processed in one (parallel) batch.
+	auto tmp = FileOperations::getTempDir() + "/filepool_unittest3";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp + "/sub");
+	std::vector<std::pair<std::string, Sha1Sum>> files;
+	for (int i = 0; i < 150; ++i) {
+		auto name = strCat(tmp, (i & 1) ? "/sub/" : "/", "file", i);
+		auto content = strCat("content ", i);
+		createFile(name, content);
+		files.emplace_back(name, SHA1::calc(std::span{std::bit_cast<const uint8_t*>(content.data()), content.size()}));
+	}
+
+	auto getDirectories = [&] {
+		FilePoolCore::Directories result;
+		result.emplace_back(tmp, FileType::ROM);
+		return result;
+	};
+	FilePoolCore pool(tmp + "/cache",
+			  getDirectories,
+			  [](std::string_view, float) { /* report progress: nothing */});
+	for (const auto& [name, sum] : files) {
+		auto [file, fname] = pool.getFile(FileType::ROM, sum);
+		CHECK(file.is_open());
+		CHECK(fname == name);
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
+
+TEST_CASE("FilePoolCore: compressed files")
+{
+	// Several batches of .gz and .zip files, these get decompressed (and
+	// added to/removed from the decompress cache) on multiple threads.
+	auto tmp = FileOperations::getTempDir() + "/filepool_unittest4";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp);
+	std::vector<std::pair<std::string, Sha1Sum>> files;
+	for (int i = 0; i < 150; ++i) {
+		auto content = strCat("compressed content ", i, ' ', std::string(1000 + 37 * i, char('a' + i % 26)));
+		std::string name;
+		if (i % 3) {
+			name = strCat(tmp, "/file", i, ".gz");
+			createGzFile(name, content);
+		} else {
+			name = strCat(tmp, "/file", i, ".zip");
+			createZipFile(name, strCat("file", i, ".rom"), content);
+		}
+		files.emplace_back(name, SHA1::calc(std::span{std::bit_cast<const uint8_t*>(content.data()), content.size()}));
+	}
+
+	auto getDirectories = [&] {
+		FilePoolCore::Directories result;
+		result.emplace_back(tmp, FileType::ROM);
+		return result;
+	};
+	FilePoolCore pool(tmp + "/cache",
+			  getDirectories,
+			  [](std::string_view, float) { /* report progress: nothing */});
+	for (const auto& [name, sum] : files) {
+		auto [file, fname] = pool.getFile(FileType::ROM, sum);
+		CHECK(file.is_open());
+		CHECK(fname == name);
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
+
+TEST_CASE("FilePoolCore: large files")
+{
+	// The sha1sum of files larger than 1MB is calculated in several steps.
+	auto tmp = FileOperations::getTempDir() + "/filepool_unittest5";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp);
+	std::vector<std::pair<std::string, Sha1Sum>> files;
+	for (size_t size : {0, 1, 1024 * 1024, 1024 * 1024 + 1, 3 * 1024 * 1024 + 12345}) {
+		auto name = strCat(tmp, "/file", size);
+		std::vector<uint8_t> content(size);
+		for (size_t i = 0; i < size; ++i) content[i] = uint8_t(i * 7 + (i >> 12));
+		createBinaryFile(name, content);
+		files.emplace_back(name, SHA1::calc(content));
+	}
+
+	auto getDirectories = [&] {
+		FilePoolCore::Directories result;
+		result.emplace_back(tmp, FileType::ROM);
+		return result;
+	};
+	FilePoolCore pool(tmp + "/cache",
+			  getDirectories,
+			  [](std::string_view, float) { /* report progress: nothing */});
+	for (const auto& [name, sum] : files) {
+		auto [file, fname] = pool.getFile(FileType::ROM, sum);
+		CHECK(file.is_open());
+		CHECK(fname == name);
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
+
+TEST_CASE("FilePoolCore: binary filecache")
+{
+	// The records in the binary .filecache are used in-place, changed
+	// entries are replaced and the result is merged on exit.
+	auto tmp = FileOperations::getTempDir() + "/filepool_unittest6";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp);
+	createFile(tmp + "/a", "aaa"); // 7e240de74fb1ed08fa08d38063f6a6a91462a815
+	createFile(tmp + "/b", "bbb"); // 5cb138284d431abd6a053a56625ec088bfb88912
+	createFile(tmp + "/c", "ccc"); // f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2
+
+	auto getDirectories = [&] {
+		FilePoolCore::Directories result;
+		result.emplace_back(tmp, FileType::ROM);
+		return result;
+	};
+	auto noDirectories = [] { return FilePoolCore::Directories{}; };
+	auto noProgress = [](std::string_view, float) { /* report progress: nothing */};
+	{
+		FilePoolCore pool(tmp + "/cache", getDirectories, noProgress);
+		auto [file, fname] = pool.getFile(FileType::ROM, Sha1Sum("7e240de74fb1ed08fa08d38063f6a6a91462a815"));
+		CHECK(fname == tmp + "/a");
+	}
+	REQUIRE(readFile(tmp + "/cache").starts_with("openMSXfilecache"));
+
+	Timer::sleep(1'000'000); // sleep because timestamps are only accurate to 1 second
+	createFile(tmp + "/b", "BBB"); // aa6878b1c31a9420245df1daffb7b223338737a3
+	FileOperations::unlink(tmp + "/c");
+	createFile(tmp + "/e", "eee"); // 637a81ed8e8217bb01c15c67c39b43b0ab4e20f1
+	{
+		FilePoolCore pool(tmp + "/cache", noDirectories, noProgress);
+		// unchanged
+		auto [file1, fname1] = pool.getFile(FileType::ROM, Sha1Sum("7e240de74fb1ed08fa08d38063f6a6a91462a815"));
+		CHECK(fname1 == tmp + "/a");
+		// modified
+		auto [file2, fname2] = pool.getFile(FileType::ROM, Sha1Sum("5cb138284d431abd6a053a56625ec088bfb88912"));
+		CHECK(!file2.is_open());
+		// removed
+		auto [file3, fname3] = pool.getFile(FileType::ROM, Sha1Sum("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2"));
+		CHECK(!file3.is_open());
+		// lookup via filename
+		File fileA(tmp + "/a");
+		CHECK(pool.getSha1Sum(fileA, tmp + "/a") == Sha1Sum("7e240de74fb1ed08fa08d38063f6a6a91462a815"));
+		// new file
+		File fileE(tmp + "/e");
+		CHECK(pool.getSha1Sum(fileE, tmp + "/e") == Sha1Sum("637a81ed8e8217bb01c15c67c39b43b0ab4e20f1"));
+	}
+	{
+		FilePoolCore pool(tmp + "/cache", noDirectories, noProgress);
+		auto check = [&](const char* sum, const std::string& name) {
+			auto [file, fname] = pool.getFile(FileType::ROM, Sha1Sum(sum));
+			CHECK(file.is_open());
+			CHECK(fname == name);
+		};
+		check("7e240de74fb1ed08fa08d38063f6a6a91462a815", tmp + "/a");
+		check("aa6878b1c31a9420245df1daffb7b223338737a3", tmp + "/b");
+		check("637a81ed8e8217bb01c15c67c39b43b0ab4e20f1", tmp + "/e");
+		auto [file, fname] = pool.getFile(FileType::ROM, Sha1Sum("f36b4825e5db2cf7dd2d2593b3f5c24c0311d8b2"));
+		CHECK(!file.is_open());
+	}
 
 	FileOperations::deleteRecursive(tmp);
 }
@@ -0,0 +1,103 @@
+#include "catch.hpp"
+#include "InstructionTraceBuffer.hh"
+
+#include "xrange.hh"
+
+#include <cstdint>
+#include <vector>
+
+using namespace openmsx;
+using Entry = InstructionTraceBuffer::Entry;
+
+static std::vector<Entry> generate(size_t num)
+{
+	// Mostly sequential code, with now and then a jump, a slot/segment
+	// switch, an interrupt or a large time step.
+	std::vector<Entry> result;
+	Entry e;
+	e.time = EmuTime::fromUint64(12345);
+	uint16_t pc = 0x4000;
+	for (auto i : xrange(num)) {
+		e.time += EmuDuration(uint64_t(3840 + (i % 7) * 960 + ((i % 1000) == 0 ? 1'000'000'000 : 0)));
+		if ((i % 50) == 0) pc = uint16_t(0x4000 + (i * 977) % 0x8000);
+		uint64_t high = (i / 300) % 5;
+		e.location = (high << 16) | pc;
+		e.irq = (i % 997) == 0;
+		e.opcodeLen = e.irq ? 0 : uint8_t(1 + i % 4);
+		for (auto j : xrange(4)) e.opcode[j] = uint8_t(e.irq || j >= e.opcodeLen ? 0 : i + j);
+		e.regs[InstructionTraceBuffer::AF] = uint16_t(i * 3);
+		if ((i % 3) == 0) e.regs[InstructionTraceBuffer::HL] = uint16_t(i);
+		if ((i % 100) == 0) e.regs[InstructionTraceBuffer::SP] = uint16_t(0xF000 - i);
+		result.push_back(e);
+		pc = uint16_t(pc + e.opcodeLen);
+	}
+	return result;
+}
+
+TEST_CASE("InstructionTraceBuffer: round trip")
+{
+	auto entries = generate(50'000);
+	InstructionTraceBuffer buffer;
+	for (const auto& e : entries) buffer.push(e);
+	REQUIRE(buffer.size() == entries.size());
+	// delta-encoding works (this test data needs about 9 bytes per entry)
+	CHECK(buffer.getMemoryUsage() < entries.size() * 12);
+
+	size_t count = 0;
+	buffer.decode(0, entries.size(), [&](size_t idx, const Entry& e) {
+		CHECK(idx == count);
+		CHECK(e == entries[idx]);
+		++count;
+	});
+	CHECK(count == entries.size());
+
+	// partial range, crossing block boundaries
+	count = 0;
+	buffer.decode(12345, 20000, [&](size_t idx, const Entry& e) {
+		CHECK(idx == 12345 + count);
+		CHECK(e == entries[idx]);
+		++count;
+	});
+	CHECK(count == 20000);
+
+	// restart() doesn't change the content
+	buffer.restart();
+	buffer.push(entries.back());
+	buffer.decode(entries.size(), 1, [&](size_t /*idx*/, const Entry& e) {
+		CHECK(e == entries.back());
+	});
+
+	buffer.clear();
+	CHECK(buffer.size() == 0);
+	CHECK(buffer.getMemoryUsage() == 0);
+}
+
+TEST_CASE("InstructionTraceBuffer: bounded memory")
+{
+	auto entries = generate(200'000);
+	InstructionTraceBuffer buffer;
+	buffer.setCapacity(4 * InstructionTraceBuffer::BLOCK_SIZE);
+	for (const auto& e : entries) buffer.push(e);
+	CHECK(buffer.getMemoryUsage() == 4 * InstructionTraceBuffer::BLOCK_SIZE);
+	auto num = buffer.size();
+	REQUIRE(num > 0);
+	REQUIRE(num < entries.size());
+
+	// the most recent entries are kept
+	auto offset = entries.size() - num;
+	size_t count = 0;
+	buffer.decode(0, num, [&](size_t idx, const Entry& e) {
+		CHECK(e == entries[offset + idx]);
+		++count;
+	});
+	CHECK(count == num);
+
+	// shrinking drops the oldest data
+	buffer.setCapacity(2 * InstructionTraceBuffer::BLOCK_SIZE);
+	CHECK(buffer.getMemoryUsage() == 2 * InstructionTraceBuffer::BLOCK_SIZE);
+	auto num2 = buffer.size();
+	CHECK(num2 < num);
+	buffer.decode(num2 - 1, 1, [&](size_t /*idx*/, const Entry& e) {
+		CHECK(e == entries.back());
+	});
+}
@@ -0,0 +1,184 @@
+#include "catch.hpp"
+#include "MixHelpers.hh"
+
+#include "xrange.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace openmsx;
+using namespace openmsx::MixHelpers;
+
+static std::vector<float> randomFloats(std::mt19937& rng, size_t n)
+{
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::vector<float> result(n);
+	for (auto& f : result) f = dist(rng);
+	return result;
+}
+
+static std::vector<StereoFloat> randomStereo(std::mt19937& rng, size_t n)
+{
+	auto f = randomFloats(rng, 2 * n);
+	std::vector<StereoFloat> result(n);
+	for (auto i : xrange(n)) result[i] = {f[2 * i + 0], f[2 * i + 1]};
+	return result;
+}
+
+TEST_CASE("MixHelpers: mixing")
+{
+	std::mt19937 rng(1234);
+	float l1 = 0.7f, l2 = -0.3f, r1 = 0.2f, r2 = 1.3f;
+	for (size_t n : {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 100, 1000}) {
+		auto mono1 = randomFloats(rng, n);
+		auto mono2 = randomFloats(rng, n);
+		auto stereo1 = randomStereo(rng, n);
+		auto stereo2 = randomStereo(rng, n);
+
+		SECTION("mul") {
+			auto m = mono1;
+			mul(m, l1);
+			for (auto i : xrange(n)) CHECK(m[i] == mono1[i] * l1);
+			auto s = stereo1;
+			mul(s, l1);
+			for (auto i : xrange(n)) {
+				CHECK(s[i].left  == stereo1[i].left  * l1);
+				CHECK(s[i].right == stereo1[i].right * l1);
+			}
+		}
+		SECTION("mulAcc") {
+			auto m = mono1;
+			mulAcc(m, mono2, l1);
+			for (auto i : xrange(n)) CHECK(m[i] == mono1[i] + mono2[i] * l1);
+			auto s = stereo1;
+			mulAcc(s, stereo2, l1);
+			for (auto i : xrange(n)) {
+				CHECK(s[i].left  == stereo1[i].left  + stereo2[i].left  * l1);
+				CHECK(s[i].right == stereo1[i].right + stereo2[i].right * l1);
+			}
+		}
+		SECTION("mulExpand") {
+			std::vector<StereoFloat> s(n);
+			std::ranges::copy(mono1, &s.data()->left);
+			mulExpand(s, l1, r1);
+			for (auto i : xrange(n)) {
+				CHECK(s[i].left  == l1 * mono1[i]);
+				CHECK(s[i].right == r1 * mono1[i]);
+			}
+		}
+		SECTION("mulExpandAcc") {
+			auto s = stereo1;
+			mulExpandAcc(s, mono1, l1, r1);
+			for (auto i : xrange(n)) {
+				CHECK(s[i].left  == stereo1[i].left  + l1 * mono1[i]);
+				CHECK(s[i].right == stereo1[i].right + r1 * mono1[i]);
+			}
+		}
+		SECTION("mulMix2") {
+			auto s = stereo1;
+			mulMix2(s, l1, l2, r1, r2);
+			for (auto i : xrange(n)) {
+				auto [t1, t2] = stereo1[i];
+				CHECK(s[i].left  == l1 * t1 + l2 * t2);
+				CHECK(s[i].right == r1 * t1 + r2 * t2);
+			}
+		}
+		SECTION("mulMix2Acc") {
+			auto s = stereo1;
+			mulMix2Acc(s, stereo2, l1, l2, r1, r2);
+			for (auto i : xrange(n)) {
+				auto [t1, t2] = stereo2[i];
+				CHECK(s[i].left  == stereo1[i].left  + (l1 * t1 + l2 * t2));
+				CHECK(s[i].right == stereo1[i].right + (r1 * t1 + r2 * t2));
+			}
+		}
+	}
+}
+
+TEST_CASE("MixHelpers: DC filter")
+{
+	// Compare with a straightforward implementation. The optimized
+	// routines calculate in a different order, so only approximately the
+	// same. The filter state can grow large (the filter has a large gain
+	// for low frequencies), so there use a relative error.
+	auto approx = [](float x, float y) { return std::abs(x - y) < 1e-5f; };
+	auto approxState = [](float x, float y) {
+		return std::abs(x - y) < 1e-5f * std::max(1.0f, std::abs(y));
+	};
+
+	std::mt19937 rng(5678);
+	for (size_t n : {1, 2, 3, 4, 5, 7, 8, 9, 31, 100, 1000}) {
+		auto mono = randomFloats(rng, n);
+		auto stereo = randomStereo(rng, n);
+		std::vector<StereoFloat> out(n);
+
+		float t0 = 0.3f;
+		float tl0 = -0.2f;
+		float tr0 = 0.6f;
+		// run several fragments, to also check the returned state
+		for (int fragment = 0; fragment < 3; ++fragment) {
+			auto t = filterMonoMono(t0, mono, out);
+			for (auto i : xrange(n)) {
+				auto t1 = R * t0 + mono[i];
+				CHECK(approx(out[i].left,  t1 - t0));
+				CHECK(out[i].right == out[i].left);
+				t0 = t1;
+			}
+			CHECK(approxState(t, t0));
+			t0 = t;
+
+			auto [tl, tr] = filterStereoStereo(tl0, tr0, stereo, out);
+			for (auto i : xrange(n)) {
+				auto tl1 = R * tl0 + stereo[i].left;
+				auto tr1 = R * tr0 + stereo[i].right;
+				CHECK(approx(out[i].left,  tl1 - tl0));
+				CHECK(approx(out[i].right, tr1 - tr0));
+				tl0 = tl1;
+				tr0 = tr1;
+			}
+			CHECK(approxState(tl, tl0));
+			CHECK(approxState(tr, tr0));
+			tl0 = tl;
+			tr0 = tr;
+		}
+	}
+}
+
+TEST_CASE("MixHelpers: benchmark", "[.][benchmark]")
+{
+	// Mix (and DC-filter) one second of audio (44100Hz), in fragments of
+	// 512 samples, for a mix of mono and stereo devices.
+	static constexpr size_t FRAGMENT = 512;
+	static constexpr size_t FRAGMENTS = (44100 + FRAGMENT - 1) / FRAGMENT;
+	std::mt19937 rng(42);
+	auto monoIn = randomFloats(rng, FRAGMENT);
+	auto stereoIn = randomStereo(rng, FRAGMENT);
+	std::vector<float> monoBuf(FRAGMENT);
+	std::vector<StereoFloat> stereoBuf(FRAGMENT);
+	std::vector<StereoFloat> output(FRAGMENT);
+
+	for (size_t devices : {1, 4, 8}) {
+		BENCHMARK("mix " + std::to_string(devices) + " devices, 1s") {
+			float tl0 = 0.0f, tr0 = 0.0f;
+			for (size_t f = 0; f < FRAGMENTS; ++f) {
+				// half of the devices mono, half of them stereo
+				std::ranges::copy(monoIn, monoBuf.begin());
+				mul(monoBuf, 0.5f);
+				std::ranges::copy(stereoIn, stereoBuf.begin());
+				mulMix2(stereoBuf, 0.8f, 0.2f, 0.3f, 0.7f);
+				for (size_t d = 2; d < devices; ++d) {
+					if (d & 1) {
+						mulAcc(monoBuf, monoIn, 0.25f);
+					} else {
+						mulAcc(stereoBuf, stereoIn, 0.25f);
+					}
+				}
+				mulExpandAcc(stereoBuf, monoBuf, 1.0f, 1.0f);
+				std::tie(tl0, tr0) = filterStereoStereo(tl0, tr0, stereoBuf, output);
+			}
+			return tl0 + tr0;
+		};
+	}
+}
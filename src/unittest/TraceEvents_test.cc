@@ -0,0 +1,250 @@
+#include "catch.hpp"
+#include "TraceEvents.hh"
+
+#include "timeline.hh"
+#include "xrange.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace openmsx;
+
+static EmuTime t(uint64_t ticks) { return EmuTime::fromUint64(ticks); }
+
+TEST_CASE("TraceEvents: basic")
+{
+	TraceEvents events;
+	CHECK(events.empty());
+	CHECK(events.begin() == events.end());
+
+	// a few values with runs, and a time gap that doesn't fit in 32 bits
+	events.push_back(t(100), TraceValue(uint64_t(1)));
+	events.push_back(t(200), TraceValue(uint64_t(1)));
+	events.push_back(t(200), TraceValue(uint64_t(2)));
+	events.push_back(t(10'000'000'000), TraceValue("some long string value"));
+	events.push_back(t(10'000'000'005), TraceValue("some long string value"));
+	events.push_back(t(10'000'000'010), TraceValue(std::monostate{}));
+	REQUIRE(events.size() == 6);
+	CHECK(events.numRuns() == 4);
+
+	CHECK(events.front().time == t(100));
+	CHECK(events.back().time == t(10'000'000'010));
+	CHECK(events.back().value.holds_alternative<std::monostate>());
+	CHECK(events[1].value.get_u64() == 1);
+	CHECK(events[2].value.get_u64() == 2);
+	CHECK(events[3].time == t(10'000'000'000));
+	CHECK(events[4].value.get_string() == "some long string value");
+
+	// forward and backward iteration
+	std::vector<uint64_t> times;
+	for (auto e : events) times.push_back(e.time.toUint64());
+	CHECK(times == std::vector<uint64_t>{100, 200, 200, 10'000'000'000, 10'000'000'005, 10'000'000'010});
+	auto it = events.end();
+	--it;
+	CHECK(it->value.holds_alternative<std::monostate>());
+	--it; --it; --it;
+	CHECK(it->value.get_u64() == 2);
+	--it;
+	CHECK(it->value.get_u64() == 1);
+
+	// binary search on time
+	auto lb = std::ranges::lower_bound(events, t(200), {}, &TraceEvents::Event::time);
+	CHECK(lb.getIndex() == 1);
+	auto ub = std::ranges::upper_bound(events, t(200), {}, &TraceEvents::Event::time);
+	CHECK(ub.getIndex() == 3);
+	CHECK(ub->value.get_string() == "some long string value");
+
+	// drop the future events
+	events.truncate(t(10'000'000'005));
+	CHECK(events.size() == 4);
+	CHECK(events.numRuns() == 3);
+	CHECK(events.back().time == t(10'000'000'000));
+	events.push_back(t(10'000'000'006), TraceValue(uint64_t(7)));
+	CHECK(events.back().value.get_u64() == 7);
+	events.truncate(t(0));
+	CHECK(events.empty());
+	CHECK(events.numRuns() == 0);
+
+	events.push_back(t(5), TraceValue(uint64_t(3)));
+	events.clear();
+	CHECK(events.empty());
+}
+
+TEST_CASE("TraceEvents: many events")
+{
+	TraceEvents events;
+	static constexpr size_t NUM = 10 * TraceEvents::BLOCK_SIZE + 17;
+	auto time = [](size_t i) { return t(1000 + i * 3579 + ((i % 1000) == 999 ? 1 : 0)); };
+	auto value = [](size_t i) { return TraceValue(uint64_t(i / 10)); };
+	for (auto i : xrange(NUM)) events.push_back(time(i), value(i));
+	REQUIRE(events.size() == NUM);
+	CHECK(events.numRuns() == (NUM + 9) / 10);
+
+	size_t i = 0;
+	for (auto e : events) {
+		CHECK(e.time == time(i));
+		CHECK(e.value == value(i));
+		++i;
+	}
+	for (auto j : xrange(NUM)) {
+		auto it = events.begin() + ptrdiff_t(j);
+		CHECK(it->time == time(j));
+		CHECK(it->value == value(j));
+	}
+
+	// less memory than a plain vector of (time, value) pairs
+	CHECK(events.getMemoryUsage() < NUM * (sizeof(EmuTime) + sizeof(TraceValue)) / 2);
+
+	events.truncate(time(3 * TraceEvents::BLOCK_SIZE));
+	CHECK(events.size() == 3 * TraceEvents::BLOCK_SIZE);
+	CHECK(events.back().time == time(3 * TraceEvents::BLOCK_SIZE - 1));
+	events.push_back(time(3 * TraceEvents::BLOCK_SIZE), value(0));
+	CHECK(events.back().time == time(3 * TraceEvents::BLOCK_SIZE));
+	CHECK(events.back().value == value(0));
+}
+
+TEST_CASE("TraceEvents: summarize")
+{
+	TraceEvents events;
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<uint64_t> timeDist(0, 20);
+	std::uniform_int_distribution<uint64_t> valueDist(0, 7);
+	static constexpr size_t NUM = 5000;
+	std::vector<uint64_t> times;
+	std::vector<uint64_t> values;
+	uint64_t time = 0;
+	for (auto i : xrange(NUM)) {
+		time += timeDist(rng);
+		// a few values repeat, so that there are longer runs
+		auto value = (valueDist(rng) < 3 && i != 0) ? values.back() : valueDist(rng);
+		times.push_back(time);
+		values.push_back(value);
+		events.push_back(t(time), TraceValue(value));
+	}
+
+	auto check = [&](size_t first, size_t last) {
+		auto summary = events.summarize(first, last);
+
+		size_t transitions = 0;
+		std::vector<std::pair<uint64_t, uint64_t>> runs; // (value, clipped duration)
+		runs.emplace_back(values[first], 0);
+		for (auto i : xrange(first + 1, last)) {
+			runs.back().second += times[i] - times[i - 1];
+			if (values[i] != values[i - 1]) {
+				++transitions;
+				runs.emplace_back(values[i], 0);
+			}
+		}
+		CHECK(summary.transitions == transitions);
+		CHECK(events.numTransitions(first, last) == transitions);
+		REQUIRE(summary.min);
+		REQUIRE(summary.max);
+		CHECK(summary.min->get_u64() == *std::ranges::min_element(values.begin() + first, values.begin() + last));
+		CHECK(summary.max->get_u64() == *std::ranges::max_element(values.begin() + first, values.begin() + last));
+		// on ties, any of the values held the longest is fine
+		auto longest = std::ranges::max(runs, {}, &std::pair<uint64_t, uint64_t>::second).second;
+		REQUIRE(summary.dominant);
+		CHECK(std::ranges::any_of(runs, [&](const auto& r) {
+			return (r.second == longest) && (r.first == summary.dominant->get_u64());
+		}));
+	};
+	check(0, 1);
+	check(0, NUM);
+	check(NUM - 1, NUM);
+	std::uniform_int_distribution<size_t> indexDist(0, NUM - 1);
+	for (auto i : xrange(200)) {
+		(void)i;
+		auto a = indexDist(rng);
+		auto b = indexDist(rng);
+		check(std::min(a, b), std::max(a, b) + 1);
+	}
+
+	// after truncating, the pyramid must still be consistent
+	auto num2 = NUM / 2 + 7;
+	events.truncate(t(times[num2]));
+	auto n = std::ranges::lower_bound(times, times[num2]) - times.begin();
+	REQUIRE(events.size() == size_t(n));
+	times.resize(n);
+	values.resize(n);
+	for (auto i : xrange(500)) {
+		auto value = uint64_t(i % 3);
+		times.push_back(times.back() + 1 + i % 5);
+		values.push_back(value);
+		events.push_back(t(times.back()), TraceValue(value));
+	}
+	check(0, times.size());
+	check(10, times.size() - 10);
+
+	// non-numeric values don't have a min/max
+	TraceEvents strings;
+	strings.push_back(t(0), TraceValue("a"));
+	strings.push_back(t(10), TraceValue("b"));
+	strings.push_back(t(11), TraceValue("c"));
+	auto summary = strings.summarize(0, 3);
+	CHECK(summary.transitions == 2);
+	CHECK(!summary.min);
+	CHECK(!summary.max);
+	REQUIRE(summary.dominant);
+	CHECK(summary.dominant->get_string() == "a");
+}
+
+TEST_CASE("TraceEvents: benchmark", "[.][benchmark]")
+{
+	// Draw a trace of 10 million (synthetic) events on a 1920 pixels wide
+	// screen, at several zoom levels. Just like the trace viewer does, for
+	// each pixel column within a coarse region the number of value changes
+	// is calculated. And (when zoomed out completely) summarize each column,
+	// the trace viewer only does this for the column under the mouse.
+	struct Mapper {
+		double scale;
+		[[nodiscard]] float timeToX(EmuTime time) const {
+			return float(double(time.toUint64()) * scale);
+		}
+		[[nodiscard]] EmuTime xToTime(float x) const {
+			return EmuTime::fromUint64(uint64_t(std::max(0.0, double(x) / scale)));
+		}
+	};
+	static constexpr size_t NUM = 10'000'000;
+	static constexpr float WIDTH = 1920.0f;
+	TraceEvents events;
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<uint64_t> timeDist(1, 100);
+	std::uniform_int_distribution<uint64_t> valueDist(0, 3);
+	uint64_t time = 0;
+	for (auto i : xrange(NUM)) {
+		(void)i;
+		time += timeDist(rng);
+		events.push_back(t(time), TraceValue(valueDist(rng)));
+	}
+	auto endTime = t(time);
+
+	for (auto zoom : {1.0, 1000.0, 1000000.0}) {
+		Mapper mapper{double(WIDTH) * zoom / double(time)};
+		auto last = std::ranges::upper_bound(events, mapper.xToTime(WIDTH), {}, &TraceEvents::Event::time);
+		std::ranges::subrange visible(events.begin(), last);
+		BENCHMARK("draw 10M events, zoom " + std::to_string(int(zoom))) {
+			size_t work = 0;
+			processTimeline(visible, endTime, mapper,
+				[&](float, float, TraceEvents::Event) { ++work; },
+				[&](float x0, float x1, TraceEvents::Iterator first, TraceEvents::Iterator end) {
+					for (auto x = std::floor(x0); (x < x1) && (first != end); x += 1.0f) {
+						auto next = std::ranges::upper_bound(std::next(first), end, mapper.xToTime(x + 1.0f), {}, &TraceEvents::Event::time);
+						work += events.numTransitions(first.getIndex(), next.getIndex());
+						first = std::prev(next);
+					}
+				});
+			return work;
+		};
+	}
+
+	BENCHMARK("summarize 10M events in 1920 columns") {
+		size_t work = 0;
+		for (auto x : xrange(size_t(WIDTH))) {
+			auto first = x * NUM / size_t(WIDTH);
+			auto last = (x + 1) * NUM / size_t(WIDTH);
+			work += events.summarize(first, last).dominant->get_u64();
+		}
+		return work;
+	};
+}
@@ -0,0 +1,49 @@
+#include "catch.hpp"
+#include "WorkerThreads.hh"
+
+#include "xrange.hh"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace openmsx;
+
+TEST_CASE("WorkerThreads")
+{
+	auto check = [](unsigned numThreads) {
+		WorkerThreads workers(numThreads);
+		CHECK(workers.getNumThreads() == numThreads);
+		for (size_t count : {0, 1, 3, 100}) {
+			// run() can be called repeatedly
+			repeat(10, [&] {
+				std::vector<std::atomic<int>> executed(count);
+				workers.run(count, [&](size_t i) { ++executed[i]; });
+				// each job executed exactly once
+				for (const auto& e : executed) CHECK(e == 1);
+			});
+		}
+	};
+	check(0);
+	check(1);
+	check(4);
+}
+
+TEST_CASE("WorkerThreads: exceptions")
+{
+	for (unsigned numThreads : {0, 1, 4}) {
+		WorkerThreads workers(numThreads);
+		// the exception of a job is rethrown by run()
+		CHECK_THROWS_AS(workers.run(100, [&](size_t i) {
+			if (i == 10) throw std::runtime_error("job failed");
+		}), std::runtime_error);
+		// multiple jobs throw
+		CHECK_THROWS_AS(workers.run(100, [&](size_t /*i*/) {
+			throw std::runtime_error("job failed");
+		}), std::runtime_error);
+		// workers can still be used afterwards
+		std::vector<std::atomic<int>> executed(100);
+		workers.run(100, [&](size_t i) { ++executed[i]; });
+		for (const auto& e : executed) CHECK(e == 1);
+	}
+}
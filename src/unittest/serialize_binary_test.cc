@@ -0,0 +1,160 @@
+#include "catch.hpp"
+#include "serialize_binary.hh"
+#include "serialize_stl.hh"
+
+#include "FileOperations.hh"
+#include "MSXException.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace openmsx;
+
+namespace {
+
+struct TestState
+{
+	int i = 0;
+	std::string s;
+	std::vector<std::string> v;
+	std::array<uint8_t, 1000> blob = {}; // big enough to be stored as a separate blob
+
+	template<typename Archive>
+	void serialize(Archive& ar, unsigned /*version*/)
+	{
+		ar.serialize("i", i,
+		             "s", s,
+		             "v", v);
+		ar.serialize_blob("blob", std::span{blob});
+	}
+};
+
+} // namespace
+
+static std::vector<uint8_t> readFile(const std::string& filename)
+{
+	std::ifstream is(filename, std::ios::binary);
+	return {std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+}
+
+static void writeFile(const std::string& filename, const std::vector<uint8_t>& content)
+{
+	std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+	os.write(std::bit_cast<const char*>(content.data()), std::streamsize(content.size()));
+}
+
+static TestState load(const std::string& filename)
+{
+	BinaryInputArchive in(filename);
+	TestState state;
+	in.serialize("state", state);
+	return state;
+}
+
+// Offset of the 'state size' field, the state itself is at the end of the file.
+static size_t findStateSize(const std::vector<uint8_t>& file)
+{
+	for (size_t size = 0; size + sizeof(uint64_t) <= file.size(); ++size) {
+		auto pos = file.size() - size - sizeof(uint64_t);
+		uint64_t value;
+		memcpy(&value, &file[pos], sizeof(value));
+		if (value == size) return pos;
+	}
+	REQUIRE(false);
+	return 0;
+}
+
+TEST_CASE("serialize_binary")
+{
+	auto tmp = FileOperations::getTempDir() + "/serialize_binary_unittest";
+	FileOperations::deleteRecursive(tmp);
+	FileOperations::mkdirp(tmp);
+	auto filename = tmp + "/state.oms";
+	auto corrupt = tmp + "/corrupt.oms";
+
+	TestState orig;
+	orig.i = 0x12345678;
+	orig.s = "hello";
+	orig.v = {"a", "bc", "def"};
+	for (size_t n = 0; auto& b : orig.blob) b = uint8_t(n++ / 8);
+	{
+		BinaryOutputArchive out(filename);
+		out.serialize("state", orig);
+		out.close();
+	}
+	auto file = readFile(filename);
+
+	SECTION("ok") {
+		auto state = load(filename);
+		CHECK(state.i == orig.i);
+		CHECK(state.s == orig.s);
+		CHECK(state.v == orig.v);
+		CHECK(state.blob == orig.blob);
+	}
+	SECTION("truncated file") {
+		for (size_t size = 0; size < file.size(); ++size) {
+			INFO("size " << size);
+			writeFile(corrupt, {file.begin(), file.begin() + size});
+			CHECK_THROWS_AS(load(corrupt), MSXException);
+		}
+	}
+	SECTION("truncated state") {
+		// consistent file structure, but the state itself is too short
+		auto pos = findStateSize(file);
+		auto stateSize = file.size() - pos - sizeof(uint64_t);
+		for (uint64_t size = 0; size < stateSize; ++size) {
+			INFO("size " << size);
+			auto content = file;
+			memcpy(&content[pos], &size, sizeof(size));
+			content.resize(pos + sizeof(uint64_t) + size);
+			writeFile(corrupt, content);
+			CHECK_THROWS_AS(load(corrupt), MSXException);
+		}
+	}
+	SECTION("corrupt string length") {
+		auto content = file;
+		auto stateBegin = findStateSize(file) + sizeof(uint64_t);
+		uint64_t length = orig.s.size();
+		std::array<uint8_t, sizeof(length)> pattern;
+		memcpy(pattern.data(), &length, sizeof(length));
+		auto it = std::search(content.begin() + stateBegin, content.end(), pattern.begin(), pattern.end());
+		REQUIRE(it != content.end());
+		for (uint64_t bad : {uint64_t(1000), uint64_t(-1)}) {
+			memcpy(&*it, &bad, sizeof(bad));
+			writeFile(corrupt, content);
+			CHECK_THROWS_AS(load(corrupt), MSXException);
+		}
+	}
+	SECTION("corrupt vector size") {
+		// must be detected before trying to allocate that many elements
+		// note: 'i' is memcpy-able, it's grouped and stored after 'v'
+		auto content = file;
+		auto pos = findStateSize(file) + sizeof(uint64_t) // state begin
+		         + sizeof(uint64_t) + orig.s.size();
+		int size;
+		memcpy(&size, &content[pos], sizeof(size));
+		REQUIRE(size == int(orig.v.size()));
+		for (int bad : {0x7fffffff, -1}) {
+			memcpy(&content[pos], &bad, sizeof(bad));
+			writeFile(corrupt, content);
+			CHECK_THROWS_AS(load(corrupt), MSXException);
+		}
+	}
+	SECTION("corrupt blob index") {
+		// the blob index is the last item in the state
+		auto content = file;
+		for (uint32_t bad : {uint32_t(1), uint32_t(-1)}) {
+			memcpy(&content[content.size() - sizeof(bad)], &bad, sizeof(bad));
+			writeFile(corrupt, content);
+			CHECK_THROWS_AS(load(corrupt), MSXException);
+		}
+	}
+
+	FileOperations::deleteRecursive(tmp);
+}
@@ -1,18 +1,25 @@
 #include "DeltaBlock.hh"
 
+#include "inline.hh"
 #include "lz4.hh"
 #include "ranges.hh"
+#include "stl.hh"
 
 #include <algorithm>
 #include <bit>
 #include <cassert>
 #include <tuple>
 #include <utility>
+#include <zlib.h>
 #if STATISTICS
 #include <iostream>
 #endif
-#ifdef __SSE2__
+#if defined(__AVX2__) || (defined(__x86_64__) && defined(__GNUC__))
+#include <immintrin.h>
+#elif defined(__SSE2__)
 #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
 #endif
 
 namespace openmsx {
@@ -46,7 +53,15 @@ static void storeUleb(std::vector<uint8_t>& result, size_t value)
 }
 
 
-// --- Helper functions to compare {4,8,16} bytes at aligned memory locations ---
+// --- Helper functions to compare {4,8,16,32} bytes at aligned memory locations ---
+
+// On x86-64 not all CPUs have AVX2 (all have SSE2). When building with GCC or
+// Clang we can still use AVX2 by checking for it at run-time.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__AVX2__)
+#define DELTA_BLOCK_RUNTIME_AVX2 1
+#else
+#define DELTA_BLOCK_RUNTIME_AVX2 0
+#endif
 
 template<int N> bool comp(const uint8_t* p, const uint8_t* q);
 
@@ -73,6 +88,27 @@ template<> bool comp<16>(const uint8_t* p, const uint8_t* q)
 	__m128i d = _mm_cmpeq_epi8(a, b);
 	return _mm_movemask_epi8(d) == 0xffff;
 }
+#elif defined(__ARM_NEON)
+template<> bool comp<16>(const uint8_t* p, const uint8_t* q)
+{
+	uint8x16_t d = vceqq_u8(vld1q_u8(p), vld1q_u8(q));
+	uint64x2_t d2 = vreinterpretq_u64_u8(d);
+	return (vgetq_lane_u64(d2, 0) & vgetq_lane_u64(d2, 1)) == ~uint64_t(0);
+}
+#endif
+
+#if defined(__AVX2__) || DELTA_BLOCK_RUNTIME_AVX2
+template<>
+#if DELTA_BLOCK_RUNTIME_AVX2
+[[gnu::target("avx2")]]
+#endif
+inline bool comp<32>(const uint8_t* p, const uint8_t* q)
+{
+	__m256i a = _mm256_loadu_si256(std::bit_cast<const __m256i*>(p));
+	__m256i b = _mm256_loadu_si256(std::bit_cast<const __m256i*>(q));
+	__m256i d = _mm256_cmpeq_epi8(a, b);
+	return _mm256_movemask_epi8(d) == -1;
+}
 #endif
 
 
@@ -86,22 +122,12 @@ template<> bool comp<16>(const uint8_t* p, const uint8_t* q)
 // - We make use of sentinels. This requires to temporarily change the content
 //   of the buffer. So it won't work with read-only-memory.
 // - We compare words-at-a-time instead of byte-at-a-time.
-static std::pair<const uint8_t*, const uint8_t*> scan_mismatch(
+template<ptrdiff_t WORD_SIZE>
+ALWAYS_INLINE std::pair<const uint8_t*, const uint8_t*> scan_mismatch_impl(
 	const uint8_t* p, const uint8_t* p_end, const uint8_t* q, const uint8_t* q_end)
 {
 	assert((p_end - p) == (q_end - q));
 
-	// When SSE is available, work with 16-byte words, otherwise 4 or 8
-	// bytes. This routine also benefits from AVX2 instructions. Though not
-	// all x86_64 CPUs have AVX2 (all have SSE2), so using them requires
-	// extra run-time checks and that's not worth it at this point.
-	constexpr ptrdiff_t WORD_SIZE =
-#ifdef __SSE2__
-		sizeof(__m128i);
-#else
-		sizeof(void*);
-#endif
-
 	// Region too small or
 	// both buffers are differently aligned.
 	if (((p_end - p) < (2 * WORD_SIZE)) ||
@@ -141,6 +167,92 @@ static std::pair<const uint8_t*, const uint8_t*> scan_mismatch(
 end:	return std::mismatch(p, p_end, q);
 }
 
+// Work with the widest words that are available at compile-time: 32 bytes
+// for AVX2, 16 bytes for SSE2 or NEON, otherwise 4 or 8 bytes.
+static constexpr ptrdiff_t DEFAULT_WORD_SIZE =
+#if defined(__AVX2__)
+	32;
+#elif defined(__SSE2__) || defined(__ARM_NEON)
+	16;
+#else
+	sizeof(void*);
+#endif
+
+static std::pair<const uint8_t*, const uint8_t*> scan_mismatch_default(
+	const uint8_t* p, const uint8_t* p_end, const uint8_t* q, const uint8_t* q_end)
+{
+	return scan_mismatch_impl<DEFAULT_WORD_SIZE>(p, p_end, q, q_end);
+}
+
+#if DELTA_BLOCK_RUNTIME_AVX2
+[[gnu::target("avx2")]] static std::pair<const uint8_t*, const uint8_t*> scan_mismatch_avx2(
+	const uint8_t* p, const uint8_t* p_end, const uint8_t* q, const uint8_t* q_end)
+{
+	return scan_mismatch_impl<32>(p, p_end, q, q_end);
+}
+#endif
+
+// Selected once, based on the capabilities of the host CPU.
+static const auto scan_mismatch = [] {
+#if DELTA_BLOCK_RUNTIME_AVX2
+	__builtin_cpu_init(); // needed because we run before main()
+	if (__builtin_cpu_supports("avx2")) return &scan_mismatch_avx2;
+#endif
+	return &scan_mismatch_default;
+}();
+
+bool isSupported(MismatchScan scan)
+{
+	switch (scan) {
+	case MismatchScan::SCALAR:
+		return true;
+	case MismatchScan::SSE2:
+#ifdef __SSE2__
+		return true;
+#else
+		return false;
+#endif
+	case MismatchScan::NEON:
+#ifdef __ARM_NEON
+		return true;
+#else
+		return false;
+#endif
+	case MismatchScan::AVX2:
+#if defined(__AVX2__)
+		return true;
+#elif DELTA_BLOCK_RUNTIME_AVX2
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+	return false;
+}
+
+std::pair<const uint8_t*, const uint8_t*> scanMismatch(
+	MismatchScan scan,
+	const uint8_t* p, const uint8_t* p_end, const uint8_t* q, const uint8_t* q_end)
+{
+	assert(isSupported(scan));
+	switch (scan) {
+#if defined(__SSE2__) || defined(__ARM_NEON)
+	case MismatchScan::SSE2:
+	case MismatchScan::NEON:
+		return scan_mismatch_impl<16>(p, p_end, q, q_end);
+#endif
+#if defined(__AVX2__)
+	case MismatchScan::AVX2:
+		return scan_mismatch_impl<32>(p, p_end, q, q_end);
+#elif DELTA_BLOCK_RUNTIME_AVX2
+	case MismatchScan::AVX2:
+		return scan_mismatch_avx2(p, p_end, q, q_end);
+#endif
+	default:
+		return scan_mismatch_impl<sizeof(void*)>(p, p_end, q, q_end);
+	}
+}
+
 
 // --- Optimized scan_match function ---
 
@@ -256,6 +368,7 @@ DeltaBlock::~DeltaBlock()
 
 DeltaBlockCopy::DeltaBlockCopy(std::span<const uint8_t> data)
 	: block(data.size())
+	, uncompressedSize(data.size())
 {
 #ifdef DEBUG
 	sha1 = SHA1::calc(data);
@@ -272,19 +385,31 @@ DeltaBlockCopy::DeltaBlockCopy(std::span<const uint8_t> data)
 
 void DeltaBlockCopy::apply(std::span<uint8_t> dst) const
 {
-	if (compressed()) {
-		LZ4::decompress(block.data(), dst.data(), int(compressedSize), int(dst.size()));
-	} else {
+	std::scoped_lock lock(mutex);
+	switch (codec) {
+	case Codec::NONE:
 		copy_to_range(std::span{block.data(), dst.size()}, dst);
+		break;
+	case Codec::LZ4:
+		LZ4::decompress(block.data(), dst.data(), int(compressedSize), int(dst.size()));
+		break;
+	case Codec::ZLIB: {
+		auto dstLen = uLongf(dst.size());
+		[[maybe_unused]] int r = uncompress(dst.data(), &dstLen, block.data(), uLong(compressedSize));
+		assert(r == Z_OK);
+		assert(dstLen == dst.size());
+		break;
+	}
 	}
 #ifdef DEBUG
 	assert(SHA1::calc(dst) == sha1);
 #endif
 }
 
-void DeltaBlockCopy::compress(size_t size)
+size_t DeltaBlockCopy::compress(size_t size)
 {
-	if (compressed()) return;
+	std::scoped_lock lock(mutex);
+	if (compressed()) return 0;
 
 	size_t dstLen = LZ4::compressBound(int(size));
 	MemBuffer<uint8_t> buf2(dstLen);
@@ -292,15 +417,17 @@ void DeltaBlockCopy::compress(size_t size)
 
 	if (dstLen >= size) {
 		// compression isn't beneficial
-		return;
+		return 0;
 	}
 	compressedSize = dstLen;
+	codec = Codec::LZ4;
 	std::swap(block, buf2);
 	block.resize(compressedSize); // shrink to fit
 	assert(compressed());
+	auto saved = buf2.size() - block.size();
 #ifdef DEBUG
 	MemBuffer<uint8_t> buf3(size);
-	apply({buf3.data(), size});
+	LZ4::decompress(block.data(), buf3.data(), int(compressedSize), int(size));
 	assert(std::ranges::equal(std::span{buf3.data(), size}, std::span{buf2.data(), size}));
 #endif
 #if STATISTICS
@@ -310,6 +437,47 @@ void DeltaBlockCopy::compress(size_t size)
 	std::cout << "stat: compress " << globalAllocSize
 	          << " (" << delta << ")\n";
 #endif
+	return saved;
+}
+
+size_t DeltaBlockCopy::getMemorySize(std::unordered_set<const DeltaBlock*>& seen) const
+{
+	if (!seen.insert(this).second) return 0;
+	std::scoped_lock lock(mutex);
+	return block.size();
+}
+
+size_t DeltaBlockCopy::compressStrong()
+{
+	std::scoped_lock lock(mutex);
+	// Uncompressed blocks are (possibly) still the reference for new
+	// diffs, leave those alone. They get LZ4 compressed once the
+	// reference moves on.
+	if ((codec != Codec::LZ4) || triedStrong) return 0;
+	triedStrong = true;
+
+	MemBuffer<uint8_t> raw(uncompressedSize);
+	LZ4::decompress(block.data(), raw.data(), int(compressedSize), int(uncompressedSize));
+	auto dstLen = compressBound(uLong(uncompressedSize));
+	MemBuffer<uint8_t> buf2(dstLen);
+	if ((compress2(buf2.data(), &dstLen, raw.data(), uLong(uncompressedSize),
+	               Z_BEST_COMPRESSION) != Z_OK) ||
+	    (dstLen >= compressedSize)) {
+		// not beneficial
+		return 0;
+	}
+	auto saved = compressedSize - dstLen;
+	compressedSize = dstLen;
+	codec = Codec::ZLIB;
+	std::swap(block, buf2);
+	block.resize(compressedSize); // shrink to fit
+	return saved;
+}
+
+bool DeltaBlockCopy::canCompressStrong() const
+{
+	std::scoped_lock lock(mutex);
+	return (codec == Codec::LZ4) && !triedStrong;
 }
 
 const uint8_t* DeltaBlockCopy::getData()
@@ -351,12 +519,132 @@ void DeltaBlockDiff::apply(std::span<uint8_t> dst) const
 #endif
 }
 
+size_t DeltaBlockDiff::getMemorySize(std::unordered_set<const DeltaBlock*>& seen) const
+{
+	size_t result = prev->getMemorySize(seen);
+	if (seen.insert(this).second) {
+		result += delta.size();
+	}
+	return result;
+}
+
+size_t DeltaBlockDiff::compressStrong()
+{
+	// The delta itself is usually small, only the reference is worth it.
+	return prev->compressStrong();
+}
+
+bool DeltaBlockDiff::canCompressStrong() const
+{
+	return prev->canCompressStrong();
+}
+
 size_t DeltaBlockDiff::getDeltaSize() const
 {
 	return delta.size();
 }
 
 
+// class DeltaBlockCompressor
+
+DeltaBlockCompressor::~DeltaBlockCompressor()
+{
+	{
+		std::scoped_lock lock(mutex);
+		quit = true;
+	}
+	cond.notify_one();
+	if (thread.joinable()) thread.join();
+}
+
+void DeltaBlockCompressor::startThread()
+{
+	// called with 'mutex' locked
+	if (!thread.joinable()) {
+		thread = std::thread(&DeltaBlockCompressor::run, this);
+	}
+}
+
+void DeltaBlockCompressor::enqueue(const std::shared_ptr<DeltaBlockCopy>& block, size_t size)
+{
+	{
+		std::scoped_lock lock(mutex);
+		if (queue.size() < MAX_QUEUED) {
+			startThread();
+			queue.emplace_back(CompressJob{block, size});
+			stats.maxQueued = std::max(stats.maxQueued, queue.size());
+			cond.notify_one();
+			return;
+		}
+		++stats.synchronous;
+	}
+	// Back-pressure: the background thread can't keep up.
+	auto saved = block->compress(size);
+	std::scoped_lock lock(mutex);
+	stats.saved += saved;
+}
+
+bool DeltaBlockCompressor::enqueueStrong(const std::shared_ptr<DeltaBlock>& block)
+{
+	std::scoped_lock lock(mutex);
+	// Keep some room for the regular (more urgent) requests.
+	if (queue.size() >= MAX_QUEUED / 2) return false;
+	startThread();
+	queue.emplace_back(CompressStrongJob{block});
+	stats.maxQueued = std::max(stats.maxQueued, queue.size());
+	cond.notify_one();
+	return true;
+}
+
+DeltaBlockCompressor::Stats DeltaBlockCompressor::getStats() const
+{
+	std::scoped_lock lock(mutex);
+	auto result = stats;
+	result.queued = queue.size();
+	return result;
+}
+
+void DeltaBlockCompressor::run()
+{
+	std::unique_lock lock(mutex);
+	while (true) {
+		cond.wait(lock, [&] { return quit || !queue.empty(); });
+		// On quit, first finish the pending work: the blocks can
+		// outlive this compressor (e.g. when the history is
+		// transferred to another ReverseManager).
+		if (queue.empty()) return;
+
+		auto job = std::move(queue.front());
+		queue.pop_front();
+		lock.unlock();
+		bool alive = false;
+		size_t saved = 0;
+		size_t strongSaved = 0;
+		std::visit(overloaded{
+			[&](const CompressJob& j) {
+				if (auto block = j.block.lock()) {
+					saved = block->compress(j.size);
+					alive = true;
+				} // possibly deletes the block, do this without holding the lock
+			},
+			[&](const CompressStrongJob& j) {
+				if (auto block = j.block.lock()) {
+					strongSaved = block->compressStrong();
+					alive = true;
+				}
+			}
+		}, job);
+		lock.lock();
+		++(alive ? stats.background : stats.dropped);
+		stats.saved += saved;
+		if (strongSaved) {
+			++stats.strong;
+			stats.strongSaved += strongSaved;
+		}
+	}
+}
+
+
 // class LastDeltaBlocks
 
 std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
@@ -376,8 +664,9 @@ std::shared_ptr<DeltaBlock> LastDeltaBlocks::createNew(
 	if (it->accSize >= size || !ref) {
 		if (ref) {
 			// We will switch to a new DeltaBlockCopy object. So
-			// now is a good time to compress the old one.
-			ref->compress(size);
+			// now is a good time to compress the old one. Do this
+			// in the background, it's not needed right away.
+			compressor.enqueue(ref, size);
 		}
 		// Heuristic: create a new block when too many small
 		// differences have accumulated.
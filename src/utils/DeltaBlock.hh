@@ -5,9 +5,16 @@
 
 #include "MemBuffer.hh"
 
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <span>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <variant>
 #include <vector>
 #ifdef DEBUG
 #include "sha1.hh"
@@ -15,6 +22,17 @@
 
 namespace openmsx {
 
+// The different implementations of the (internal) mismatch scan that is used
+// to calculate the difference between two blocks. The fastest one that is
+// supported by the host CPU is selected automatically, these functions are
+// only exposed so that the unittests can test (and benchmark) each of them.
+enum class MismatchScan : uint8_t { SCALAR, SSE2, NEON, AVX2 };
+[[nodiscard]] bool isSupported(MismatchScan scan);
+// Like std::mismatch(). Note: temporarily modifies the buffer [p, p_end).
+[[nodiscard]] std::pair<const uint8_t*, const uint8_t*> scanMismatch(
+	MismatchScan scan,
+	const uint8_t* p, const uint8_t* p_end, const uint8_t* q, const uint8_t* q_end);
+
 class DeltaBlock
 {
 public:
@@ -24,6 +42,24 @@ public:
 	virtual ~DeltaBlock() = default;
 #endif
 	virtual void apply(std::span<uint8_t> dst) const = 0;
+	/** Size of the (uncompressed) data of this block. */
+	[[nodiscard]] virtual size_t getSize() const = 0;
+
+	/** Memory used by this block and the block(s) it depends on. Blocks
+	  * that are already in 'seen' are not counted (again), the counted
+	  * blocks are added to 'seen'.
+	  */
+	[[nodiscard]] virtual size_t getMemorySize(
+		std::unordered_set<const DeltaBlock*>& seen) const = 0;
+
+	/** Recompress the (reference) data of this block with a slower codec
+	  * that gives better compression. Blocks that are still used as
+	  * reference for new diffs are not touched.
+	  * @result The number of bytes that were saved.
+	  */
+	virtual size_t compressStrong() = 0;
+	/** Would compressStrong() (still) try to do something? */
+	[[nodiscard]] virtual bool canCompressStrong() const = 0;
 
 protected:
 	DeltaBlock() = default;
@@ -46,14 +82,29 @@ class DeltaBlockCopy final : public DeltaBlock
 public:
 	explicit DeltaBlockCopy(std::span<const uint8_t> data);
 	void apply(std::span<uint8_t> dst) const override;
-	void compress(size_t size);
+	[[nodiscard]] size_t getSize() const override { return uncompressedSize; }
+	[[nodiscard]] size_t getMemorySize(
+		std::unordered_set<const DeltaBlock*>& seen) const override;
+	size_t compressStrong() override;
+	[[nodiscard]] bool canCompressStrong() const override;
+	/** Compress with the regular (fast) codec.
+	  * @result The number of bytes that were saved.
+	  */
+	size_t compress(size_t size);
 	[[nodiscard]] const uint8_t* getData();
 
 private:
-	[[nodiscard]] bool compressed() const { return compressedSize != 0; }
+	enum class Codec : uint8_t { NONE, LZ4, ZLIB };
+	[[nodiscard]] bool compressed() const { return codec != Codec::NONE; }
 
+	// compress() can run on the DeltaBlockCompressor thread, while
+	// apply() runs on the main thread.
+	mutable std::mutex mutex;
 	MemBuffer<uint8_t> block;
+	const size_t uncompressedSize;
 	size_t compressedSize = 0;
+	Codec codec = Codec::NONE;
+	bool triedStrong = false;
 };
 
 
@@ -63,6 +114,11 @@ public:
 	DeltaBlockDiff(std::shared_ptr<DeltaBlockCopy> prev_,
 	               std::span<const uint8_t> data);
 	void apply(std::span<uint8_t> dst) const override;
+	[[nodiscard]] size_t getSize() const override { return prev->getSize(); }
+	[[nodiscard]] size_t getMemorySize(
+		std::unordered_set<const DeltaBlock*>& seen) const override;
+	size_t compressStrong() override;
+	[[nodiscard]] bool canCompressStrong() const override;
 	[[nodiscard]] size_t getDeltaSize() const;
 
 private:
@@ -71,6 +127,62 @@ private:
 };
 
 
+/** Compresses DeltaBlockCopy objects on a background thread.
+  * The queue is bounded: when the background thread can't keep up, blocks
+  * get compressed synchronously on the calling thread instead. Requests for
+  * the (slow) strong compression are instead rejected when the queue is
+  * full.
+  */
+class DeltaBlockCompressor
+{
+public:
+	struct Stats {
+		size_t background = 0; // number of blocks compressed in background
+		size_t synchronous = 0; // compressed on caller thread (queue full)
+		size_t saved = 0; // number of bytes saved by the regular codec
+		size_t strong = 0; // number of blocks recompressed with strong codec
+		size_t strongSaved = 0; // number of bytes saved by the strong codec
+		size_t dropped = 0; // block was already gone before compression
+		size_t maxQueued = 0; // highest observed queue length
+		size_t queued = 0; // current queue length
+	};
+
+	DeltaBlockCompressor() = default;
+	DeltaBlockCompressor(const DeltaBlockCompressor&) = delete;
+	DeltaBlockCompressor(DeltaBlockCompressor&&) = delete;
+	DeltaBlockCompressor& operator=(const DeltaBlockCompressor&) = delete;
+	DeltaBlockCompressor& operator=(DeltaBlockCompressor&&) = delete;
+	~DeltaBlockCompressor();
+
+	void enqueue(const std::shared_ptr<DeltaBlockCopy>& block, size_t size);
+	/** @result false iff the request was rejected. */
+	bool enqueueStrong(const std::shared_ptr<DeltaBlock>& block);
+	[[nodiscard]] Stats getStats() const;
+
+private:
+	void startThread();
+	void run();
+
+	static constexpr size_t MAX_QUEUED = 16;
+
+	struct CompressJob {
+		std::weak_ptr<DeltaBlockCopy> block;
+		size_t size;
+	};
+	struct CompressStrongJob {
+		std::weak_ptr<DeltaBlock> block;
+	};
+	using Job = std::variant<CompressJob, CompressStrongJob>;
+
+	mutable std::mutex mutex;
+	std::condition_variable cond;
+	std::deque<Job> queue;
+	Stats stats;
+	std::thread thread; // only started on first use
+	bool quit = false;
+};
+
+
 class LastDeltaBlocks
 {
 public:
@@ -80,6 +192,17 @@ public:
 		const void* id, std::span<const uint8_t> data);
 	void clear();
 
+	/** Asynchronously recompress 'block' with a stronger codec.
+	  * @see DeltaBlock::compressStrong()
+	  * @result false iff the request was rejected (queue full).
+	  */
+	bool compressStrong(const std::shared_ptr<DeltaBlock>& block) {
+		return compressor.enqueueStrong(block);
+	}
+	[[nodiscard]] DeltaBlockCompressor::Stats getCompressorStats() const {
+		return compressor.getStats();
+	}
+
 private:
 	struct Info {
 		Info(const void* id_, size_t size_)
@@ -93,6 +216,7 @@ private:
 	};
 
 	std::vector<Info> infos;
+	DeltaBlockCompressor compressor;
 };
 
 } // namespace openmsx
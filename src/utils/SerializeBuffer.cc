@@ -1,5 +1,7 @@
 #include "SerializeBuffer.hh"
 
+#include "MSXException.hh"
+
 #include <cstdlib>
 #include <utility>
 
@@ -88,4 +90,12 @@ void OutputBuffer::insertGrow(const void* __restrict data, size_t len)
 	memcpy(pos, data, len);
 }
 
+
+// class CheckedInputBuffer
+
+void CheckedInputBuffer::throwTruncated()
+{
+	throw MSXException("Corrupt savestate: unexpected end of data");
+}
+
 } // namespace openmsx
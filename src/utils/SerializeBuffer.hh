@@ -212,6 +212,47 @@ private:
 	std::span<const uint8_t> buf;
 };
 
+
+/** Like InputBuffer, but for data that doesn't come from an OutputBuffer in
+  * this process (e.g. a file). Instead of asserting, reading past the end of
+  * the buffer throws MSXException.
+  */
+class CheckedInputBuffer
+{
+public:
+	explicit CheckedInputBuffer(std::span<const uint8_t> buf_)
+		: buf(buf_) {}
+
+	void read(void* __restrict result, size_t len)
+	{
+		check(len);
+		memcpy(result, buf.data(), len);
+		buf = buf.subspan(len);
+	}
+
+	void skip(size_t len)
+	{
+		check(len);
+		buf = buf.subspan(len);
+	}
+
+	/** Throws when less than 'len' bytes remain. */
+	void check(size_t len) const
+	{
+		if (buf.size() < len) [[unlikely]] throwTruncated();
+	}
+
+	/** The number of bytes that remain to be read. */
+	[[nodiscard]] size_t size() const { return buf.size(); }
+
+	[[nodiscard]] const uint8_t* getCurrentPos() const { return buf.data(); }
+
+	[[noreturn]] static void throwTruncated();
+
+private:
+	std::span<const uint8_t> buf;
+};
+
 } // namespace openmsx
 
 #endif
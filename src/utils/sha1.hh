@@ -65,6 +65,9 @@ public:
 	void serialize(MemInputArchive& ar, unsigned /*version*/) {
 		ar.serialize("a", a);
 	}
+	void serialize(CheckedMemInputArchive& ar, unsigned /*version*/) {
+		ar.serialize("a", a);
+	}
 	void serialize(MemOutputArchive& ar, unsigned /*version*/) const {
 		ar.serialize("a", a);
 	}
@@ -19,16 +19,20 @@
 #include <cstring>
 #include <ctime>
 #include <limits>
+#include <utility>
 
 namespace openmsx {
 
 static constexpr unsigned AVI_HEADER_SIZE = 500;
+static constexpr size_t QUEUE_SIZE = 4; // in frames
 
 AviWriter::AviWriter(const std::string& filename_, unsigned width_,
                      unsigned height_, unsigned channels_, unsigned freq_)
 	: file(filename_, "wb")
 	, filename(filename_)
 	, codec(width_, height_)
+	, captured(QUEUE_SIZE)
+	, encoded(QUEUE_SIZE)
 	, width(width_)
 	, height(height_)
 	, channels(channels_)
@@ -38,10 +42,15 @@ AviWriter::AviWriter(const std::string& filename_, unsigned width_,
 	file.write(dummy);
 
 	index.resize(2);
+
+	encodeThread = std::thread([this] { encodeLoop(); });
+	writeThread  = std::thread([this] { writeLoop(); });
 }
 
 AviWriter::~AviWriter()
 {
+	stopThreads();
+
 	if (written == 0) {
 		// no data written yet (a recording less than one video frame)
 		file.close(); // close file (needed for windows?)
@@ -274,23 +283,95 @@ void AviWriter::addAviChunk(std::span<const char, 4> tag, std::span<const uint8_
 	index[idxSize + 3] = size32;
 }
 
-void AviWriter::addFrame(const FrameSource* video, std::span<const int16_t> audio)
+void AviWriter::stopThreads()
 {
-	bool keyFrame = (frames++ % 300 == 0);
-	auto buffer = codec.compressFrame(keyFrame, video);
-	addAviChunk(subspan<4>("00dc"), buffer, keyFrame ? 0x10 : 0x0);
+	// Pending frames are still written.
+	captured.close();
+	if (encodeThread.joinable()) encodeThread.join();
+	if (writeThread .joinable()) writeThread .join();
+}
 
-	if (!audio.empty()) {
-		assert((audio.size() % channels) == 0);
-		assert(audioRate != 0);
+ZMBVEncoder::Buffer AviWriter::getBuffer(std::vector<ZMBVEncoder::Buffer>& pool, bool frameBuf)
+{
+	{
+		std::lock_guard lock(poolMutex);
+		if (!pool.empty()) {
+			auto result = std::move(pool.back());
+			pool.pop_back();
+			return result;
+		}
+	}
+	return frameBuf ? codec.createFrameBuffer() : codec.createWorkBuffer();
+}
+
+void AviWriter::recycleBuffer(std::vector<ZMBVEncoder::Buffer>& pool, ZMBVEncoder::Buffer buffer)
+{
+	std::lock_guard lock(poolMutex);
+	pool.push_back(std::move(buffer));
+}
+
+void AviWriter::encodeLoop()
+{
+	while (auto frame = captured.pop()) {
+		auto work = getBuffer(freeWorkBuffers, false);
+		frame->size = codec.encodeFrame(frame->keyFrame, frame->buffer, work);
+		// 'frame->buffer' now holds the previous reference frame
+		recycleBuffer(freeFrameBuffers, std::exchange(frame->buffer, std::move(work)));
+		encoded.push(std::move(*frame));
+	}
+	encoded.close();
+}
+
+void AviWriter::writeLoop()
+{
+	while (auto frame = encoded.pop()) {
+		if (!failed) {
+			try {
+				writeFrame(*frame);
+			} catch (MSXException& e) {
+				// Keep on emptying the queue (the other
+				// threads might be waiting for that), but
+				// drop the remaining frames.
+				std::lock_guard lock(errorMutex);
+				error = e.getMessage();
+				failed = true;
+			}
+		}
+		recycleBuffer(freeWorkBuffers, std::move(frame->buffer));
+	}
+}
+
+void AviWriter::writeFrame(Frame& frame)
+{
+	auto buffer = codec.deflateFrame(frame.keyFrame, std::span{frame.buffer.data(), frame.size});
+	addAviChunk(subspan<4>("00dc"), buffer, frame.keyFrame ? 0x10 : 0x0);
+
+	if (!frame.audio.empty()) {
 		if constexpr (Endian::BIG) {
-			small_buffer<Endian::L16, 4096> buf(audio);
+			small_buffer<Endian::L16, 4096> buf(frame.audio);
 			addAviChunk(subspan<4>("01wb"), as_byte_span(std::span{buf}), 0);
 		} else {
-			addAviChunk(subspan<4>("01wb"), as_byte_span(audio), 0);
+			addAviChunk(subspan<4>("01wb"), as_byte_span(std::span{frame.audio}), 0);
 		}
-		audioWritten += narrow<uint32_t>(audio.size());
+		audioWritten += narrow<uint32_t>(frame.audio.size());
 	}
 }
 
+void AviWriter::addFrame(const FrameSource* video, std::span<const int16_t> audio)
+{
+	if (failed) {
+		std::lock_guard lock(errorMutex);
+		throw MSXException(error);
+	}
+	assert((audio.size() % channels) == 0);
+	assert(audio.empty() || (audioRate != 0));
+
+	Frame frame;
+	frame.keyFrame = (frames++ % 300 == 0);
+	frame.buffer = getBuffer(freeFrameBuffers, true);
+	codec.captureFrame(video, frame.buffer);
+	frame.audio.assign(audio.begin(), audio.end());
+	captured.push(std::move(frame)); // blocks when the encoder is too far behind
+}
+
 } // namespace openmsx
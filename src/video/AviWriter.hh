@@ -5,19 +5,31 @@
 
 #include "ZMBVEncoder.hh"
 
+#include "BoundedQueue.hh"
 #include "File.hh"
 
 #include "endian.hh"
 
+#include <atomic>
 #include <cstdint>
+#include <mutex>
 #include <span>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace openmsx {
 
 class FrameSource;
 
+/** Writes an AVI file with ZMBV video and (optionally) PCM audio.
+  *
+  * Only capturing the frame runs on the caller's (emulation) thread. The
+  * motion search (encoder thread) and the zlib compression plus the actual
+  * file writes (writer thread) are done in the background. Both are
+  * connected via bounded queues: when encoding can't keep up, addFrame()
+  * blocks until there's room again.
+  */
 class AviWriter
 {
 public:
@@ -28,13 +40,41 @@ public:
 	void setFps(float fps_) { fps = fps_; }
 
 private:
+	struct Frame {
+		ZMBVEncoder::Buffer buffer; // captured frame, or encoded frame data
+		unsigned size = 0; // used size of encoded frame data
+		std::vector<int16_t> audio;
+		bool keyFrame = false;
+	};
+
+	void encodeLoop();
+	void writeLoop();
+	void writeFrame(Frame& frame);
 	void addAviChunk(std::span<const char, 4> tag, std::span<const uint8_t> data, unsigned flags);
+	[[nodiscard]] ZMBVEncoder::Buffer getBuffer(std::vector<ZMBVEncoder::Buffer>& pool, bool frameBuf);
+	void recycleBuffer(std::vector<ZMBVEncoder::Buffer>& pool, ZMBVEncoder::Buffer buffer);
+	void stopThreads();
 
 private:
 	File file;
 	std::string filename;
 	ZMBVEncoder codec;
+
+	// Frames pass from the emulation thread (capture) via 'captured' to
+	// the encoder thread and via 'encoded' to the writer thread.
+	BoundedQueue<Frame> captured;
+	BoundedQueue<Frame> encoded;
+	std::mutex poolMutex;
+	std::vector<ZMBVEncoder::Buffer> freeFrameBuffers;
+	std::vector<ZMBVEncoder::Buffer> freeWorkBuffers;
+	std::mutex errorMutex;
+	std::string error; // first error on the writer thread
+	std::atomic<bool> failed = false;
+
+	// only accessed by the writer thread (or after it has stopped)
 	std::vector<Endian::L32> index;
+	uint32_t audioWritten = 0;
+	uint32_t written = 0;
 
 	float fps = 0.0f; // will be filled in later
 	const uint32_t width;
@@ -43,8 +83,9 @@ private:
 	const uint32_t audioRate;
 
 	uint32_t frames = 0;
-	uint32_t audioWritten = 0;
-	uint32_t written = 0;
+
+	std::thread encodeThread;
+	std::thread writeThread;
 };
 
 } // namespace openmsx
@@ -8,10 +8,41 @@
 
 #include <algorithm>
 #include <bit>
+#include <cstring>
 #include <tuple>
 
+// On x86-64 not all CPUs have SSSE3 or AVX2 (all have SSE2). When building
+// with GCC or Clang the routines below are compiled for those instruction sets
+// anyway (the code between the BEGIN and END markers), and they're selected at
+// run-time.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define BITMAP_CONVERTER_X86 1
+#include <immintrin.h>
+#ifdef __clang__
+#define BITMAP_CONVERTER_SSSE3_BEGIN _Pragma("clang attribute push(__attribute__((target(\"ssse3\"))), apply_to = function)")
+#define BITMAP_CONVERTER_AVX2_BEGIN  _Pragma("clang attribute push(__attribute__((target(\"avx2\"))), apply_to = function)")
+#define BITMAP_CONVERTER_TARGET_END  _Pragma("clang attribute pop")
+#else
+#define BITMAP_CONVERTER_SSSE3_BEGIN _Pragma("GCC push_options") _Pragma("GCC target(\"ssse3\")")
+#define BITMAP_CONVERTER_AVX2_BEGIN  _Pragma("GCC push_options") _Pragma("GCC target(\"avx2\")")
+#define BITMAP_CONVERTER_TARGET_END  _Pragma("GCC pop_options")
+#endif
+#else
+#define BITMAP_CONVERTER_X86 0
+#endif
+
+// The 'tbl' instruction with a 16-byte table only exists on AArch64.
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define BITMAP_CONVERTER_NEON 1
+#include <arm_neon.h>
+#else
+#define BITMAP_CONVERTER_NEON 0
+#endif
+
 namespace openmsx {
 
+using Pixel = BitmapConverter::Pixel;
+
 BitmapConverter::BitmapConverter(
 		std::span<const Pixel, 16 * 2> palette16_,
 		std::span<const Pixel, 256>    palette256_,
@@ -35,8 +66,268 @@ void BitmapConverter::calcDPalette()
 			dPalette[16 * i + j] = dp;
 		}
 	}
+
+	auto setPlanes = [](auto& planes, unsigned i, Pixel p) {
+		std::array<uint8_t, sizeof(Pixel)> bytes;
+		memcpy(bytes.data(), &p, sizeof(Pixel));
+		for (auto n : xrange(sizeof(Pixel))) planes[n][i] = bytes[n];
+	};
+	for (auto i : xrange(16)) {
+		setPlanes(palette16Planes, i, palette16[i]);
+		setPlanes(palette5Planes,  i, palette16[(i < 4) ? i : (i < 8) ? (i + 12) : 0]);
+	}
+}
+
+
+// --- SIMD versions of the render routines ---
+//
+// Graphic4, 5 and 6 lookup 16 (or 8) colors with a byte-shuffle instruction:
+// 4 times (once per byte plane), after which the bytes are interleaved again
+// to form pixels. Graphic7 and YJK/YAE use AVX2 gathers.
+
+#if BITMAP_CONVERTER_X86
+[[nodiscard]] static bool hasSSSE3()
+{
+	static const bool result = __builtin_cpu_supports("ssse3");
+	return result;
+}
+
+[[nodiscard]] static bool hasAVX2()
+{
+	static const bool result = __builtin_cpu_supports("avx2");
+	return result;
+}
+
+BITMAP_CONVERTER_SSSE3_BEGIN
+// Lookup 16 colors at once, 'idx' contains indices in the range [0..16).
+static inline void lookup16(
+	Pixel* out, __m128i idx, const std::array<std::array<uint8_t, 16>, 4>& planes)
+{
+	auto plane = [&](int n) {
+		auto table = _mm_load_si128(std::bit_cast<const __m128i*>(planes[n].data()));
+		return _mm_shuffle_epi8(table, idx);
+	};
+	__m128i b0 = plane(0), b1 = plane(1), b2 = plane(2), b3 = plane(3);
+	__m128i lo01 = _mm_unpacklo_epi8(b0, b1);
+	__m128i hi01 = _mm_unpackhi_epi8(b0, b1);
+	__m128i lo23 = _mm_unpacklo_epi8(b2, b3);
+	__m128i hi23 = _mm_unpackhi_epi8(b2, b3);
+	auto* o = std::bit_cast<__m128i*>(out);
+	_mm_storeu_si128(o + 0, _mm_unpacklo_epi16(lo01, lo23));
+	_mm_storeu_si128(o + 1, _mm_unpackhi_epi16(lo01, lo23));
+	_mm_storeu_si128(o + 2, _mm_unpacklo_epi16(hi01, hi23));
+	_mm_storeu_si128(o + 3, _mm_unpackhi_epi16(hi01, hi23));
+}
+
+// 16 bytes -> 32 pixels, high nibble first.
+static inline void nibbles16(
+	Pixel* out, __m128i data, const std::array<std::array<uint8_t, 16>, 4>& planes)
+{
+	__m128i mask = _mm_set1_epi8(0x0F);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(data, 4), mask);
+	__m128i lo = _mm_and_si128(data, mask);
+	lookup16(out +  0, _mm_unpacklo_epi8(hi, lo), planes);
+	lookup16(out + 16, _mm_unpackhi_epi8(hi, lo), planes);
+}
+
+static void renderGraphic4SSSE3(
+	Pixel* out, const uint8_t* in, const std::array<std::array<uint8_t, 16>, 4>& planes)
+{
+	for (auto i : xrange(128 / 16)) {
+		auto data = _mm_loadu_si128(std::bit_cast<const __m128i*>(in + 16 * i));
+		nibbles16(out + 32 * i, data, planes);
+	}
+}
+
+static void renderGraphic5SSSE3(
+	Pixel* out, const uint8_t* in, const std::array<std::array<uint8_t, 16>, 4>& planes)
+{
+	__m128i mask = _mm_set1_epi8(3);
+	__m128i odd = _mm_set1_epi8(4);
+	for (auto i : xrange(128 / 16)) {
+		auto data = _mm_loadu_si128(std::bit_cast<const __m128i*>(in + 16 * i));
+		__m128i a = _mm_and_si128(_mm_srli_epi16(data, 6), mask);
+		__m128i b = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(data, 4), mask), odd);
+		__m128i c = _mm_and_si128(_mm_srli_epi16(data, 2), mask);
+		__m128i d = _mm_or_si128(_mm_and_si128(data, mask), odd);
+		__m128i abLo = _mm_unpacklo_epi8(a, b), abHi = _mm_unpackhi_epi8(a, b);
+		__m128i cdLo = _mm_unpacklo_epi8(c, d), cdHi = _mm_unpackhi_epi8(c, d);
+		Pixel* o = out + 64 * i;
+		lookup16(o +  0, _mm_unpacklo_epi16(abLo, cdLo), planes);
+		lookup16(o + 16, _mm_unpackhi_epi16(abLo, cdLo), planes);
+		lookup16(o + 32, _mm_unpacklo_epi16(abHi, cdHi), planes);
+		lookup16(o + 48, _mm_unpackhi_epi16(abHi, cdHi), planes);
+	}
+}
+
+static void renderGraphic6SSSE3(
+	Pixel* out, const uint8_t* in0, const uint8_t* in1,
+	const std::array<std::array<uint8_t, 16>, 4>& planes)
+{
+	for (auto i : xrange(128 / 16)) {
+		auto data0 = _mm_loadu_si128(std::bit_cast<const __m128i*>(in0 + 16 * i));
+		auto data1 = _mm_loadu_si128(std::bit_cast<const __m128i*>(in1 + 16 * i));
+		nibbles16(out + 64 * i +  0, _mm_unpacklo_epi8(data0, data1), planes);
+		nibbles16(out + 64 * i + 32, _mm_unpackhi_epi8(data0, data1), planes);
+	}
 }
 
+BITMAP_CONVERTER_TARGET_END
+
+BITMAP_CONVERTER_AVX2_BEGIN
+// Call 'op(p, out)' for groups of 8 pixels. 'p' contains the VRAM bytes
+// of those pixels (alternating from the two planes), zero-extended to 32 bits.
+template<typename Op>
+static inline void forPlanar8(
+	Pixel* out, const uint8_t* in0, const uint8_t* in1, Op op)
+{
+	for (auto i : xrange(128 / 16)) {
+		auto data0 = _mm_loadu_si128(std::bit_cast<const __m128i*>(in0 + 16 * i));
+		auto data1 = _mm_loadu_si128(std::bit_cast<const __m128i*>(in1 + 16 * i));
+		__m128i lo = _mm_unpacklo_epi8(data0, data1);
+		__m128i hi = _mm_unpackhi_epi8(data0, data1);
+		Pixel* o = out + 32 * i;
+		op(_mm256_cvtepu8_epi32(lo),                     o +  0);
+		op(_mm256_cvtepu8_epi32(_mm_srli_si128(lo, 8)), o +  8);
+		op(_mm256_cvtepu8_epi32(hi),                     o + 16);
+		op(_mm256_cvtepu8_epi32(_mm_srli_si128(hi, 8)), o + 24);
+	}
+}
+
+static inline void store8(Pixel* out, __m256i v)
+{
+	_mm256_storeu_si256(std::bit_cast<__m256i*>(out), v);
+}
+
+static void renderGraphic7AVX2(
+	Pixel* out, const uint8_t* in0, const uint8_t* in1, const Pixel* palette256)
+{
+	auto* pal = std::bit_cast<const int*>(palette256);
+	forPlanar8(out, in0, in1, [&](__m256i p, Pixel* o) {
+		store8(o, _mm256_i32gather_epi32(pal, p, 4));
+	});
+}
+
+// YJK to palette32768 index for 8 pixels (2 groups of 4 pixels that share
+// the same J and K values, conveniently each group is in one 128-bit lane).
+// Same calculation as yjk2rgb() below.
+static inline __m256i yjkIndex(__m256i p)
+{
+	__m256i low  = _mm256_and_si256(p, _mm256_set1_epi32(7));
+	__m256i high = _mm256_sub_epi32(
+		_mm256_slli_epi32(_mm256_and_si256(p, _mm256_set1_epi32(3)), 3),
+		_mm256_slli_epi32(_mm256_and_si256(p, _mm256_set1_epi32(4)), 3));
+	__m256i k = _mm256_add_epi32(_mm256_shuffle_epi32(low, 0x00), _mm256_shuffle_epi32(high, 0x55));
+	__m256i j = _mm256_add_epi32(_mm256_shuffle_epi32(low, 0xAA), _mm256_shuffle_epi32(high, 0xFF));
+	__m256i y = _mm256_srli_epi32(p, 3);
+
+	__m256i zero = _mm256_setzero_si256();
+	__m256i max = _mm256_set1_epi32(31);
+	auto clamp = [&](__m256i x) { return _mm256_min_epi32(_mm256_max_epi32(x, zero), max); };
+	__m256i r = clamp(_mm256_add_epi32(y, j));
+	__m256i g = clamp(_mm256_add_epi32(y, k));
+	// (5 * y - 2 * j - k + 2) / 4: rounding towards zero or towards minus
+	// infinity only differs for negative results, and those are clamped
+	// to zero anyway.
+	__m256i b5 = _mm256_add_epi32(_mm256_slli_epi32(y, 2), y);
+	__m256i bj = _mm256_add_epi32(_mm256_slli_epi32(j, 1), k);
+	__m256i b = clamp(_mm256_srai_epi32(
+		_mm256_add_epi32(_mm256_sub_epi32(b5, bj), _mm256_set1_epi32(2)), 2));
+	return _mm256_or_si256(_mm256_or_si256(_mm256_slli_epi32(r, 10), _mm256_slli_epi32(g, 5)), b);
+}
+
+static void renderYJKAVX2(
+	Pixel* out, const uint8_t* in0, const uint8_t* in1, const Pixel* palette32768)
+{
+	auto* pal = std::bit_cast<const int*>(palette32768);
+	forPlanar8(out, in0, in1, [&](__m256i p, Pixel* o) {
+		store8(o, _mm256_i32gather_epi32(pal, yjkIndex(p), 4));
+	});
+}
+
+static void renderYAEAVX2(
+	Pixel* out, const uint8_t* in0, const uint8_t* in1,
+	const Pixel* palette16, const Pixel* palette32768)
+{
+	auto* pal16 = std::bit_cast<const int*>(palette16);
+	auto* pal32768 = std::bit_cast<const int*>(palette32768);
+	__m256i yaeBit = _mm256_set1_epi32(8);
+	forPlanar8(out, in0, in1, [&](__m256i p, Pixel* o) {
+		__m256i yjk = _mm256_i32gather_epi32(pal32768, yjkIndex(p), 4);
+		__m256i yae = _mm256_i32gather_epi32(pal16, _mm256_srli_epi32(p, 4), 4);
+		__m256i isYae = _mm256_cmpeq_epi32(_mm256_and_si256(p, yaeBit), yaeBit);
+		store8(o, _mm256_blendv_epi8(yjk, yae, isYae));
+	});
+}
+BITMAP_CONVERTER_TARGET_END
+#endif
+
+#if BITMAP_CONVERTER_NEON
+// Lookup 16 colors at once, 'idx' contains indices in the range [0..16).
+static inline void lookup16(
+	Pixel* out, uint8x16_t idx, const std::array<std::array<uint8_t, 16>, 4>& planes)
+{
+	uint8x16x4_t b;
+	b.val[0] = vqtbl1q_u8(vld1q_u8(planes[0].data()), idx);
+	b.val[1] = vqtbl1q_u8(vld1q_u8(planes[1].data()), idx);
+	b.val[2] = vqtbl1q_u8(vld1q_u8(planes[2].data()), idx);
+	b.val[3] = vqtbl1q_u8(vld1q_u8(planes[3].data()), idx);
+	vst4q_u8(std::bit_cast<uint8_t*>(out), b); // interleaves the planes
+}
+
+// 16 bytes -> 32 pixels, high nibble first.
+static inline void nibbles16(
+	Pixel* out, uint8x16_t data, const std::array<std::array<uint8_t, 16>, 4>& planes)
+{
+	auto z = vzipq_u8(vshrq_n_u8(data, 4), vandq_u8(data, vdupq_n_u8(0x0F)));
+	lookup16(out +  0, z.val[0], planes);
+	lookup16(out + 16, z.val[1], planes);
+}
+
+static void renderGraphic4NEON(
+	Pixel* out, const uint8_t* in, const std::array<std::array<uint8_t, 16>, 4>& planes)
+{
+	for (auto i : xrange(128 / 16)) {
+		nibbles16(out + 32 * i, vld1q_u8(in + 16 * i), planes);
+	}
+}
+
+static void renderGraphic5NEON(
+	Pixel* out, const uint8_t* in, const std::array<std::array<uint8_t, 16>, 4>& planes)
+{
+	uint8x16_t mask = vdupq_n_u8(3);
+	uint8x16_t odd = vdupq_n_u8(4);
+	for (auto i : xrange(128 / 16)) {
+		uint8x16_t data = vld1q_u8(in + 16 * i);
+		uint8x16_t a = vshrq_n_u8(data, 6);
+		uint8x16_t b = vorrq_u8(vandq_u8(vshrq_n_u8(data, 4), mask), odd);
+		uint8x16_t c = vandq_u8(vshrq_n_u8(data, 2), mask);
+		uint8x16_t d = vorrq_u8(vandq_u8(data, mask), odd);
+		auto ab = vzipq_u8(a, b);
+		auto cd = vzipq_u8(c, d);
+		auto lo = vzipq_u16(vreinterpretq_u16_u8(ab.val[0]), vreinterpretq_u16_u8(cd.val[0]));
+		auto hi = vzipq_u16(vreinterpretq_u16_u8(ab.val[1]), vreinterpretq_u16_u8(cd.val[1]));
+		Pixel* o = out + 64 * i;
+		lookup16(o +  0, vreinterpretq_u8_u16(lo.val[0]), planes);
+		lookup16(o + 16, vreinterpretq_u8_u16(lo.val[1]), planes);
+		lookup16(o + 32, vreinterpretq_u8_u16(hi.val[0]), planes);
+		lookup16(o + 48, vreinterpretq_u8_u16(hi.val[1]), planes);
+	}
+}
+
+static void renderGraphic6NEON(
+	Pixel* out, const uint8_t* in0, const uint8_t* in1,
+	const std::array<std::array<uint8_t, 16>, 4>& planes)
+{
+	for (auto i : xrange(128 / 16)) {
+		auto z = vzipq_u8(vld1q_u8(in0 + 16 * i), vld1q_u8(in1 + 16 * i));
+		nibbles16(out + 64 * i +  0, z.val[0], planes);
+		nibbles16(out + 64 * i + 32, z.val[1], planes);
+	}
+}
+#endif
+
+
 void BitmapConverter::convertLine(std::span<Pixel> buf, std::span<const uint8_t, 128> vramPtr)
 {
 	switch (mode.getByte()) {
@@ -121,6 +412,15 @@ void BitmapConverter::renderGraphic4(
 	if (!dPaletteValid) [[unlikely]] {
 		calcDPalette();
 	}
+#if BITMAP_CONVERTER_X86
+	if (hasSSSE3()) {
+		renderGraphic4SSSE3(buf.data(), vramPtr0.data(), palette16Planes);
+		return;
+	}
+#elif BITMAP_CONVERTER_NEON
+	renderGraphic4NEON(buf.data(), vramPtr0.data(), palette16Planes);
+	return;
+#endif
 
 	Pixel* __restrict pixelPtr = buf.data();
 	      auto* out = std::bit_cast<DPixel*>(pixelPtr);
@@ -144,8 +444,21 @@ void BitmapConverter::renderGraphic4(
 
 void BitmapConverter::renderGraphic5(
 	std::span<Pixel, 512> buf,
-	std::span<const uint8_t, 128> vramPtr0) const
+	std::span<const uint8_t, 128> vramPtr0)
 {
+	if (!dPaletteValid) [[unlikely]] {
+		calcDPalette();
+	}
+#if BITMAP_CONVERTER_X86
+	if (hasSSSE3()) {
+		renderGraphic5SSSE3(buf.data(), vramPtr0.data(), palette5Planes);
+		return;
+	}
+#elif BITMAP_CONVERTER_NEON
+	renderGraphic5NEON(buf.data(), vramPtr0.data(), palette5Planes);
+	return;
+#endif
+
 	Pixel* __restrict pixelPtr = buf.data();
 	for (auto i : xrange(128)) {
 		unsigned data = vramPtr0[i];
@@ -173,6 +486,15 @@ void BitmapConverter::renderGraphic6(
 	if (!dPaletteValid) [[unlikely]] {
 		calcDPalette();
 	}
+#if BITMAP_CONVERTER_X86
+	if (hasSSSE3()) {
+		renderGraphic6SSSE3(pixelPtr, vramPtr0.data(), vramPtr1.data(), palette16Planes);
+		return;
+	}
+#elif BITMAP_CONVERTER_NEON
+	renderGraphic6NEON(pixelPtr, vramPtr0.data(), vramPtr1.data(), palette16Planes);
+	return;
+#endif
 	      auto* out = std::bit_cast<DPixel*>(pixelPtr);
 	const auto* in0 = std::bit_cast<const unsigned*>(vramPtr0.data());
 	const auto* in1 = std::bit_cast<const unsigned*>(vramPtr1.data());
@@ -207,6 +529,12 @@ void BitmapConverter::renderGraphic7(
 	std::span<const uint8_t, 128> vramPtr0,
 	std::span<const uint8_t, 128> vramPtr1) const
 {
+#if BITMAP_CONVERTER_X86
+	if (hasAVX2()) {
+		renderGraphic7AVX2(buf.data(), vramPtr0.data(), vramPtr1.data(), palette256.data());
+		return;
+	}
+#endif
 	Pixel* __restrict pixelPtr = buf.data();
 	for (auto i : xrange(128)) {
 		pixelPtr[2 * i + 0] = palette256[vramPtr0[i]];
@@ -232,6 +560,12 @@ void BitmapConverter::renderYJK(
 	std::span<const uint8_t, 128> vramPtr0,
 	std::span<const uint8_t, 128> vramPtr1) const
 {
+#if BITMAP_CONVERTER_X86
+	if (hasAVX2()) {
+		renderYJKAVX2(buf.data(), vramPtr0.data(), vramPtr1.data(), palette32768.data());
+		return;
+	}
+#endif
 	Pixel* __restrict pixelPtr = buf.data();
 	for (auto i : xrange(64)) {
 		std::array<unsigned, 4> p = {
@@ -257,6 +591,13 @@ void BitmapConverter::renderYAE(
 	std::span<const uint8_t, 128> vramPtr0,
 	std::span<const uint8_t, 128> vramPtr1) const
 {
+#if BITMAP_CONVERTER_X86
+	if (hasAVX2()) {
+		renderYAEAVX2(buf.data(), vramPtr0.data(), vramPtr1.data(),
+		              palette16.data(), palette32768.data());
+		return;
+	}
+#endif
 	Pixel* __restrict pixelPtr = buf.data();
 	for (auto i : xrange(64)) {
 		std::array<unsigned, 4> p = {
@@ -80,13 +80,23 @@ public:
 		dPaletteValid = false;
 	}
 
+	/** Update the lazily calculated internal state now. After this (and
+	  * until the next palette16Changed() call) convertLine() and
+	  * convertLinePlanar() don't modify this object anymore, so they can
+	  * be called from multiple threads in parallel.
+	  */
+	void prepareParallel()
+	{
+		if (!dPaletteValid) calcDPalette();
+	}
+
 private:
 	void calcDPalette();
 
 	void renderGraphic4(std::span<Pixel, 256> buf,
 	                    std::span<const uint8_t, 128> vramPtr0);
 	void renderGraphic5(std::span<Pixel, 512> buf,
-	                    std::span<const uint8_t, 128> vramPtr0) const;
+	                    std::span<const uint8_t, 128> vramPtr0);
 	void renderGraphic6(std::span<Pixel, 512> buf,
 	                    std::span<const uint8_t, 128> vramPtr0,
 	                    std::span<const uint8_t, 128> vramPtr1);
@@ -107,6 +117,20 @@ private:
 	std::span<const Pixel, 32768>  palette32768;
 
 	std::array<DPixel, 16 * 16> dPalette;
+
+	/** The same colors as the first 16 entries of palette16, but split in
+	  * 4 planes: plane 'n' contains byte 'n' (in memory order) of each
+	  * pixel. This allows to do the palette lookups with SIMD byte-shuffle
+	  * instructions. Only valid when 'dPaletteValid' is true.
+	  */
+	alignas(16) std::array<std::array<uint8_t, 16>, 4> palette16Planes;
+
+	/** Similar to the above, but for Graphic5: entries 0-3 are the colors
+	  * for the even pixels (palette16[0-3]), entries 4-7 for the odd
+	  * pixels (palette16[16-19]).
+	  */
+	alignas(16) std::array<std::array<uint8_t, 16>, 4> palette5Planes;
+
 	DisplayMode mode;
 	bool dPaletteValid = false;
 };
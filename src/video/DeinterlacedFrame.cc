@@ -8,7 +8,7 @@ void DeinterlacedFrame::init(FrameSource* evenField, FrameSource* oddField)
 {
 	FrameSource::init(FieldType::NONINTERLACED);
 	// TODO: I think these assertions make sense, but we cannot currently
-	//       guarantee them. See TODO in PostProcessor::paint.
+	//       guarantee them. See TODO in GLPostProcessor::paint.
 	//assert(evenField->getField() == FrameSource::FieldType::EVEN);
 	//assert(oddField->getField() == FrameSource::FieldType::ODD);
 	assert(evenField->getHeight() == oddField->getHeight());
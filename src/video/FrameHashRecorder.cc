@@ -0,0 +1,278 @@
+#include "FrameHashRecorder.hh"
+
+#include "FrameSource.hh"
+#include "PostProcessor.hh"
+
+#include "CliComm.hh"
+#include "CommandException.hh"
+#include "Display.hh"
+#include "File.hh"
+#include "FileContext.hh"
+#include "FileOperations.hh"
+#include "MSXException.hh"
+#include "Reactor.hh"
+#include "TclArgParser.hh"
+
+#include "StringOp.hh"
+#include "aligned.hh"
+#include "endian.hh"
+#include "narrow.hh"
+#include "outer.hh"
+#include "ranges.hh"
+#include "small_buffer.hh"
+#include "strCat.hh"
+#include "xrange.hh"
+#include "xxhash.hh"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+
+namespace openmsx {
+
+using namespace std::literals;
+
+FrameHashRecorder::FrameHashRecorder(Reactor& reactor_)
+	: reactor(reactor_)
+	, recordCommand(reactor.getCommandController())
+{
+}
+
+FrameHashRecorder::~FrameHashRecorder()
+{
+	assert(!isRecording());
+}
+
+uint32_t FrameHashRecorder::hashFrame(const FrameSource& frame)
+{
+	// First hash each line (and store it together with the line width),
+	// then hash those per-line results. Everything is hashed in
+	// little-endian byte order, so that reference files can be shared
+	// between hosts.
+	ALIGNAS_SSE std::array<FrameSource::Pixel, 1280> buf; // large enough for widest line
+	auto height = frame.getHeight();
+	small_buffer<Endian::L32, 2 * 480> lines(uninitialized_tag{}, 2 * size_t(height));
+	for (auto y : xrange(height)) {
+		auto line = frame.getUnscaledLine(y, buf);
+		if constexpr (Endian::BIG) {
+			// (line possibly already points to buf, that's fine)
+			auto swapped = subspan(buf, 0, line.size());
+			std::ranges::transform(line, swapped.begin(), Endian::ByteSwap{});
+			line = swapped;
+		}
+		lines[2 * y + 0] = narrow<uint32_t>(line.size());
+		lines[2 * y + 1] = xxhash_impl<true>(
+			std::bit_cast<const uint8_t*>(line.data()), line.size_bytes());
+	}
+	std::span<const Endian::L32> s = lines;
+	return xxhash_impl<true>(std::bit_cast<const uint8_t*>(s.data()), s.size_bytes());
+}
+
+void FrameHashRecorder::loadReference(const std::string& filename)
+{
+	reference.clear();
+	auto buf = File(filename).mmap<const char>();
+	for (std::string_view line : StringOp::split_view(std::string_view(buf.data(), buf.size()), '\n')) {
+		StringOp::trimRight(line, '\r');
+		if (line.empty() || line.starts_with('#')) continue;
+		auto [frameStr, rest] = StringOp::splitOnFirst(line, ' ');
+		auto [timeStr, hashStr] = StringOp::splitOnFirst(rest, ' ');
+		auto frame = StringOp::stringToBase<10, uint64_t>(frameStr);
+		auto time  = StringOp::stringToBase<10, uint64_t>(timeStr);
+		auto hash  = StringOp::stringToBase<16, uint32_t>(hashStr);
+		if (!frame || !time || !hash || (*frame != reference.size())) {
+			throw MSXException("Invalid frame hash file: ", filename);
+		}
+		reference.push_back({*time, *hash});
+	}
+}
+
+void FrameHashRecorder::start(const std::string& filename, const std::string& referenceFile,
+                              const TclObject& mismatchCommand_)
+{
+	stop();
+	reference.clear();
+	// Like for video recording, all post processors get the frames, but
+	// only the active one actually sends them.
+	for (auto* l : reactor.getDisplay().getAllLayers()) {
+		if (auto* pp = dynamic_cast<PostProcessor*>(l)) {
+			postProcessors.push_back(pp);
+		}
+	}
+	if (postProcessors.empty()) {
+		throw CommandException(
+			"Current renderer doesn't support frame hash recording.");
+	}
+	try {
+		if (!referenceFile.empty()) {
+			loadReference(referenceFile);
+		}
+		FileOperations::openOfStream(os, filename);
+		if (!os) throw MSXException("Cannot open file for writing: ", filename);
+	} catch (MSXException& e) {
+		postProcessors.clear();
+		reference.clear();
+		throw CommandException("Can't start recording: ", e.getMessage());
+	}
+	os << "# openMSX frame hashes: <frame> <emutime> <hash>\n";
+	mismatchCommand = mismatchCommand_;
+	mismatch.reset();
+	frameNumber = 0;
+
+	// only set recorders when all errors are checked for
+	for (auto* pp : postProcessors) {
+		pp->setHashRecorder(this);
+	}
+}
+
+void FrameHashRecorder::stop()
+{
+	for (auto* pp : postProcessors) {
+		pp->setHashRecorder(nullptr);
+	}
+	postProcessors.clear();
+	if (os.is_open()) os.close();
+}
+
+void FrameHashRecorder::addFrame(const FrameSource& frame, EmuTime time)
+{
+	auto hash = hashFrame(frame);
+	os << tmpStrCat(frameNumber, ' ', time.toUint64(), ' ', hex_string<8>(hash), '\n');
+
+	bool different = !mismatch && (frameNumber < reference.size()) &&
+	                 ((reference[frameNumber].time != time.toUint64()) ||
+	                  (reference[frameNumber].hash != hash));
+	++frameNumber;
+	if (different) {
+		reportMismatch(time, hash);
+	}
+}
+
+void FrameHashRecorder::reportMismatch(EmuTime time, uint32_t hash)
+{
+	auto frame = frameNumber - 1;
+	mismatch = frame;
+	const auto& expected = reference[frame];
+	if (mismatchCommand.empty()) {
+		reactor.getCliComm().printWarning(
+			"Frame hash mismatch at frame ", frame, " (time ", time.toDouble(),
+			"): expected ", hex_string<8>(expected.hash), ", got ", hex_string<8>(hash), '.');
+		return;
+	}
+	// We're called while the frame is being rendered (from within
+	// PostProcessor). The callback could do anything, e.g. stop this
+	// recording or even switch or delete the machine. So don't execute
+	// it right now, but schedule it to run from the main loop.
+	try {
+		auto command = makeTclList(mismatchCommand, frame, time.toDouble(),
+		                           strCat(hex_string<8>(expected.hash)), strCat(hex_string<8>(hash)));
+		makeTclList("after", "realtime", 0, command).executeCommand(reactor.getInterpreter());
+	} catch (CommandException& e) {
+		reactor.getCliComm().printWarning(
+			"Error executing frame hash mismatch callback: ", e.getMessage());
+	}
+}
+
+void FrameHashRecorder::status(TclObject& result) const
+{
+	result.addDictKeyValues("status", isRecording() ? "recording"sv : "idle"sv,
+	                        "frames", frameNumber,
+	                        "reference", reference.size());
+	if (mismatch) {
+		result.addDictKeyValue("mismatch", *mismatch);
+	}
+}
+
+void FrameHashRecorder::processStart(Interpreter& interp, std::span<const TclObject> tokens, TclObject& result)
+{
+	std::string_view prefix = "openmsx";
+	std::string_view referenceFile;
+	TclObject command;
+	std::array info = {
+		valueArg("-prefix", prefix),
+		valueArg("-reference", referenceFile),
+		valueArg("-mismatch", command),
+	};
+	auto arguments = parseTclArgs(interp, tokens.subspan(2), info);
+
+	std::string_view filenameArg;
+	switch (arguments.size()) {
+	case 0:
+		// nothing
+		break;
+	case 1:
+		filenameArg = arguments[0].getString();
+		break;
+	default:
+		throw SyntaxError();
+	}
+	auto filename = FileOperations::parseCommandFileArgument(
+		filenameArg, HASH_DIR, prefix, HASH_EXTENSION);
+
+	if (isRecording()) {
+		result = "Already recording.";
+	} else {
+		auto refFile = referenceFile.empty() ? std::string{}
+		                                     : userFileContext().resolve(referenceFile);
+		start(filename, refFile, command);
+		result = tmpStrCat("Recording frame hashes to ", filename);
+	}
+}
+
+// class FrameHashRecorder::Cmd
+
+FrameHashRecorder::Cmd::Cmd(CommandController& commandController_)
+	: Command(commandController_, "record_frame_hashes")
+{
+}
+
+void FrameHashRecorder::Cmd::execute(std::span<const TclObject> tokens, TclObject& result)
+{
+	checkNumArgs(tokens, AtLeast{2}, "subcommand ?arg ...?");
+	auto& recorder = OUTER(FrameHashRecorder, recordCommand);
+	executeSubCommand(tokens[1].getString(),
+		"start",  [&]{ recorder.processStart(getInterpreter(), tokens, result); },
+		"stop",   [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			recorder.stop(); },
+		"status", [&]{
+			checkNumArgs(tokens, 2, Prefix{2}, nullptr);
+			recorder.status(result); });
+}
+
+std::string FrameHashRecorder::Cmd::help(std::span<const TclObject> /*tokens*/) const
+{
+	return "Records a hash of each rendered frame, e.g. for regression tests.\n"
+	       "record_frame_hashes start              Record to file 'openmsxNNNN.txt'\n"
+	       "record_frame_hashes start <filename>   Record to given file\n"
+	       "record_frame_hashes start -prefix foo  Record to file 'fooNNNN.txt'\n"
+	       "record_frame_hashes stop               Stop recording\n"
+	       "record_frame_hashes status             Query recording state\n"
+	       "\n"
+	       "The file contains one line per frame: '<frame> <emutime> <hash>'.\n"
+	       "The start subcommand also accepts these options:\n"
+	       "  -reference <file>   compare against the hashes in this (earlier recorded) file\n"
+	       "  -mismatch <command> on the first frame that differs from the reference, execute\n"
+	       "                      this command with 4 extra arguments: frame number, time (in\n"
+	       "                      seconds), expected hash and actual hash. The command runs\n"
+	       "                      (shortly) after that frame was rendered. Without this option\n"
+	       "                      a warning is printed instead.";
+}
+
+void FrameHashRecorder::Cmd::tabCompletion(std::vector<std::string>& tokens) const
+{
+	if (tokens.size() == 2) {
+		static constexpr std::array cmds = {
+			"start"sv, "stop"sv, "status"sv,
+		};
+		completeString(tokens, cmds);
+	} else if ((tokens.size() >= 3) && (tokens[1] == "start")) {
+		static constexpr std::array options = {
+			"-prefix"sv, "-reference"sv, "-mismatch"sv,
+		};
+		completeFileName(tokens, userFileContext(), options);
+	}
+}
+
+} // namespace openmsx
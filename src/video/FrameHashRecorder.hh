@@ -0,0 +1,88 @@
+#ifndef FRAMEHASHRECORDER_HH
+#define FRAMEHASHRECORDER_HH
+
+#include "Command.hh"
+#include "EmuTime.hh"
+#include "TclObject.hh"
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace openmsx {
+
+class FrameSource;
+class Interpreter;
+class PostProcessor;
+class Reactor;
+
+/** Records a (fast) hash of each rendered frame, e.g. for regression
+  * testing: comparing the hashes of two runs is a lot cheaper than
+  * comparing (or even creating) screenshots.
+  *
+  * The hashes are written to a text file, one line per frame:
+  *   <frame-number> <emutime-ticks> <hash>
+  * Optionally the hashes are compared against such a (reference) file,
+  * the first difference is reported.
+  */
+class FrameHashRecorder
+{
+public:
+	static constexpr std::string_view HASH_DIR = "framehashes";
+	static constexpr std::string_view HASH_EXTENSION = ".txt";
+
+public:
+	explicit FrameHashRecorder(Reactor& reactor);
+	~FrameHashRecorder();
+
+	void addFrame(const FrameSource& frame, EmuTime time);
+	void stop();
+	[[nodiscard]] bool isRecording() const { return os.is_open(); }
+
+	/** Hash of the frame as it was rendered. So it's not a hash of the
+	  * (scaled) image, e.g. two frames that only differ in line width
+	  * (a 320 pixel line vs the same line with all pixels doubled) get a
+	  * different hash. That's fine for comparing two runs of the same
+	  * openMSX version.
+	  */
+	[[nodiscard]] static uint32_t hashFrame(const FrameSource& frame);
+
+private:
+	void start(const std::string& filename, const std::string& referenceFile,
+	           const TclObject& mismatchCommand);
+	void loadReference(const std::string& filename);
+	void reportMismatch(EmuTime time, uint32_t hash);
+	void status(TclObject& result) const;
+
+	void processStart(Interpreter& interp, std::span<const TclObject> tokens, TclObject& result);
+
+private:
+	Reactor& reactor;
+
+	struct Cmd final : Command {
+		explicit Cmd(CommandController& commandController);
+		void execute(std::span<const TclObject> tokens, TclObject& result) override;
+		[[nodiscard]] std::string help(std::span<const TclObject> tokens) const override;
+		void tabCompletion(std::vector<std::string>& tokens) const override;
+	} recordCommand;
+
+	std::vector<PostProcessor*> postProcessors;
+	std::ofstream os;
+
+	struct Entry {
+		uint64_t time; // EmuTime ticks
+		uint32_t hash;
+	};
+	std::vector<Entry> reference; // indexed by frame number
+	TclObject mismatchCommand;
+	std::optional<uint64_t> mismatch; // frame number of the first mismatch
+	uint64_t frameNumber = 0;
+};
+
+} // namespace openmsx
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef GLPOSTPROCESSOR_HH
+#define GLPOSTPROCESSOR_HH
+
+#include "GLUtil.hh"
+#include "PostProcessor.hh"
+#include "RenderSettings.hh"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace openmsx {
+
+class GLScaler;
+class OutputSurface;
+
+/** Post processor that displays the MSX frame using openGL: it applies the
+  * scaler and effects such as noise, glow and 3D-deform.
+  */
+class GLPostProcessor final : public PostProcessor
+{
+public:
+	GLPostProcessor(
+		MSXMotherBoard& motherBoard, Display& display,
+		OutputSurface& screen, const std::string& videoSource,
+		unsigned maxWidth, unsigned height, bool canDoInterlace);
+	~GLPostProcessor() override;
+
+	// Layer interface:
+	void paint(OutputSurface& output) override;
+
+	// PostProcessor
+	[[nodiscard]] bool needAllFrames() const override;
+
+private:
+	// PostProcessor
+	void frameRotated() override;
+
+	// Observer<Setting> interface:
+	void update(const Setting& setting) noexcept override;
+
+	void initBuffers();
+	void createRegions();
+	void uploadFrame();
+	void uploadBlock(unsigned srcStartY, unsigned srcEndY,
+	                 unsigned lineWidth);
+
+	void preCalcNoise(float factor);
+	void drawNoise() const;
+	void drawGlow(int glow);
+
+	void preCalcMonitor3D(float width);
+	void drawMonitor3D() const;
+
+private:
+	/** The surface which is visible to the user. */
+	OutputSurface& screen;
+
+	int interleaveCount = 0; // for interleave-black-frame
+
+	/** The currently active scaler.
+	  */
+	std::unique_ptr<GLScaler> currScaler;
+
+	struct StoredFrame {
+		gl::ivec2 size; // (re)allocate when window size changes
+		gl::Texture tex;
+		gl::FrameBufferObject fbo;
+	};
+	std::array<StoredFrame, 2> renderedFrames;
+
+	// Noise effect:
+	gl::Texture noiseTextureA{true, true}; // interpolate + wrap
+	gl::Texture noiseTextureB{true, true};
+	float noiseX = 0.0f, noiseY = 0.0f;
+
+	struct TextureData {
+		gl::ColorTexture tex;
+		/** A copy of the content of 'tex'. Used to only upload those
+		  * lines that are different from what's already in the texture.
+		  */
+		std::vector<uint32_t> content;
+		[[nodiscard]] unsigned width() const { return tex.getWidth(); }
+	};
+	std::vector<TextureData> textures;
+
+	gl::ColorTexture superImposeTex;
+
+	struct Region {
+		Region(unsigned srcStartY_, unsigned srcEndY_,
+		       unsigned dstStartY_, unsigned dstEndY_,
+		       unsigned lineWidth_)
+			: srcStartY(srcStartY_)
+			, srcEndY(srcEndY_)
+			, dstStartY(dstStartY_)
+			, dstEndY(dstEndY_)
+			, lineWidth(lineWidth_) {}
+		unsigned srcStartY;
+		unsigned srcEndY;
+		unsigned dstStartY;
+		unsigned dstEndY;
+		unsigned lineWidth;
+	};
+	std::vector<Region> regions;
+	unsigned regionsDstHeight = 0; // 'regions' were calculated for this output height (relevant when changing scale_factor when paused)
+
+	unsigned frameCounter = 0;
+
+	/** Currently active scale algorithm, used to detect scaler changes.
+	  */
+	RenderSettings::ScaleAlgorithm scaleAlgorithm = RenderSettings::ScaleAlgorithm::NO;
+
+	gl::ShaderProgram monitor3DProg;
+	gl::BufferObject arrayBuffer;
+	gl::BufferObject elementBuffer;
+	gl::BufferObject vbo;
+	gl::BufferObject stretchVBO;
+
+	bool storedFrame = false;
+};
+
+} // namespace openmsx
+
+#endif // GLPOSTPROCESSOR_HH
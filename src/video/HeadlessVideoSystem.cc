@@ -0,0 +1,154 @@
+#include "HeadlessVideoSystem.hh"
+
+#include "Display.hh"
+#include "OutputSurface.hh"
+#include "PostProcessor.hh"
+#include "RenderSettings.hh"
+#include "SDLRasterizer.hh"
+#include "V9990.hh"
+#include "V9990SDLRasterizer.hh"
+#include "VDP.hh"
+#include "VideoLayer.hh"
+
+#include "MSXException.hh"
+#include "Reactor.hh"
+
+#include <memory>
+
+#include "components.hh"
+#if COMPONENT_LASERDISC
+#include "LDSDLRasterizer.hh"
+#include "LaserdiscPlayer.hh"
+#endif
+
+namespace openmsx {
+
+/** The rasterizers need an OutputSurface (to map colors to pixel values),
+  * but nothing is ever painted on this one.
+  */
+class HeadlessSurface final : public OutputSurface
+{
+public:
+	HeadlessSurface()
+	{
+		calculateViewPort({640, 480}, {640, 480});
+	}
+
+	void saveScreenshot(const std::string& /*filename*/) override
+	{
+		throw MSXException("Headless surface has no content.");
+	}
+};
+
+
+HeadlessVideoSystem::HeadlessVideoSystem(Reactor& reactor)
+	: display(reactor.getDisplay())
+	, screen(std::make_unique<HeadlessSurface>())
+{
+}
+
+HeadlessVideoSystem::~HeadlessVideoSystem() = default;
+
+std::unique_ptr<Rasterizer> HeadlessVideoSystem::createRasterizer(VDP& vdp)
+{
+	assert(display.getRenderer() == RenderSettings::RendererID::HEADLESS);
+	std::string videoSource = (vdp.getName() == "VDP")
+	                        ? "MSX" // for backwards compatibility
+	                        : vdp.getName();
+	auto& motherBoard = vdp.getMotherBoard();
+	return std::make_unique<SDLRasterizer>(
+		vdp, display, *screen,
+		std::make_unique<PostProcessor>(
+			motherBoard, display,
+			videoSource, 640, 240, true));
+}
+
+std::unique_ptr<V9990Rasterizer> HeadlessVideoSystem::createV9990Rasterizer(
+	V9990& vdp)
+{
+	assert(display.getRenderer() == RenderSettings::RendererID::HEADLESS);
+	std::string videoSource = (vdp.getName() == "Sunrise GFX9000")
+	                        ? "GFX9000" // for backwards compatibility
+	                        : vdp.getName();
+	MSXMotherBoard& motherBoard = vdp.getMotherBoard();
+	return std::make_unique<V9990SDLRasterizer>(
+		vdp, display, *screen,
+		std::make_unique<PostProcessor>(
+			motherBoard, display,
+			videoSource, 1280, 240, true));
+}
+
+#if COMPONENT_LASERDISC
+std::unique_ptr<LDRasterizer> HeadlessVideoSystem::createLDRasterizer(
+	LaserdiscPlayer& ld)
+{
+	assert(display.getRenderer() == RenderSettings::RendererID::HEADLESS);
+	std::string videoSource = "Laserdisc"; // TODO handle multiple???
+	MSXMotherBoard& motherBoard = ld.getMotherBoard();
+	return std::make_unique<LDSDLRasterizer>(
+		std::make_unique<PostProcessor>(
+			motherBoard, display,
+			videoSource, 640, 480, false));
+}
+#endif
+
+void HeadlessVideoSystem::flush()
+{
+}
+
+void HeadlessVideoSystem::takeScreenShot(const std::string& filename, bool /*withOsd*/)
+{
+	// There are no OSD layers, so this is the same as a raw screenshot,
+	// scaled (on the CPU) to the size the SDLGL-PP window would have
+	// (though only 320x240 and 640x480 are supported).
+	auto* videoLayer = dynamic_cast<VideoLayer*>(display.findActiveLayer());
+	if (!videoLayer) {
+		throw MSXException("No active video source.");
+	}
+	auto height = (display.getRenderSettings().getScaleFactor() == 1) ? 240 : 480;
+	videoLayer->takeRawScreenShot(height, filename);
+}
+
+std::optional<gl::ivec2> HeadlessVideoSystem::getMouseCoord()
+{
+	return {};
+}
+
+OutputSurface* HeadlessVideoSystem::getOutputSurface()
+{
+	// Nothing is displayed, so there's also no need to repaint.
+	return nullptr;
+}
+
+void HeadlessVideoSystem::showCursor(bool /*show*/)
+{
+}
+
+bool HeadlessVideoSystem::getCursorEnabled()
+{
+	return false;
+}
+
+std::string HeadlessVideoSystem::getClipboardText()
+{
+	return "";
+}
+
+void HeadlessVideoSystem::setClipboardText(zstring_view /*text*/)
+{
+}
+
+std::optional<gl::ivec2> HeadlessVideoSystem::getWindowPosition()
+{
+	return {};
+}
+
+void HeadlessVideoSystem::setWindowPosition(gl::ivec2 /*pos*/)
+{
+}
+
+void HeadlessVideoSystem::repaint()
+{
+}
+
+} // namespace openmsx
@@ -0,0 +1,54 @@
+#ifndef HEADLESSVIDEOSYSTEM_HH
+#define HEADLESSVIDEOSYSTEM_HH
+
+#include "VideoSystem.hh"
+#include "components.hh"
+
+#include <memory>
+
+namespace openmsx {
+
+class Display;
+class HeadlessSurface;
+class Reactor;
+
+/** Video system that renders the MSX frames, but without displaying them.
+  * So it doesn't need a window nor an openGL context (e.g. to run on a
+  * machine without GPU). The rendered frames can still be used to take
+  * screenshots or to make video recordings. Because nothing needs to be
+  * displayed, this can run (much) faster than realtime.
+  */
+class HeadlessVideoSystem final : public VideoSystem
+{
+public:
+	explicit HeadlessVideoSystem(Reactor& reactor);
+	~HeadlessVideoSystem() override;
+
+	// VideoSystem interface:
+	[[nodiscard]] std::unique_ptr<Rasterizer> createRasterizer(VDP& vdp) override;
+	[[nodiscard]] std::unique_ptr<V9990Rasterizer> createV9990Rasterizer(
+		V9990& vdp) override;
+#if COMPONENT_LASERDISC
+	[[nodiscard]] std::unique_ptr<LDRasterizer> createLDRasterizer(
+		LaserdiscPlayer& ld) override;
+#endif
+	void flush() override;
+	void takeScreenShot(const std::string& filename, bool withOsd) override;
+	[[nodiscard]] std::optional<gl::ivec2> getMouseCoord() override;
+	[[nodiscard]] OutputSurface* getOutputSurface() override;
+	void showCursor(bool show) override;
+	[[nodiscard]] bool getCursorEnabled() override;
+	[[nodiscard]] std::string getClipboardText() override;
+	void setClipboardText(zstring_view text) override;
+	[[nodiscard]] std::optional<gl::ivec2> getWindowPosition() override;
+	void setWindowPosition(gl::ivec2 pos) override;
+	void repaint() override;
+
+private:
+	Display& display;
+	std::unique_ptr<HeadlessSurface> screen;
+};
+
+} // namespace openmsx
+
+#endif
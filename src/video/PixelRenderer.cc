@@ -214,7 +214,7 @@ void PixelRenderer::frameStart(EmuTime time)
 
 	if (paintFrame) {
 		frameSkipCounter = std::remainder(frameSkipCounter, 1.0f);
-	} else if (!rasterizer->isRecording()) {
+	} else if (!rasterizer->needAllFrames()) {
 		renderFrame = false;
 		return;
 	}
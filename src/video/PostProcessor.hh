@@ -1,8 +1,6 @@
-#ifndef GLPOSTPROCESSOR_HH
-#define GLPOSTPROCESSOR_HH
+#ifndef POSTPROCESSOR_HH
+#define POSTPROCESSOR_HH
 
-#include "GLUtil.hh"
-#include "RenderSettings.hh"
 #include "VideoLayer.hh"
 
 #include "EmuTime.hh"
@@ -10,7 +8,6 @@
 
 #include <array>
 #include <memory>
-#include <vector>
 
 namespace openmsx {
 
@@ -21,8 +18,8 @@ class DeinterlacedFrame;
 class Display;
 class DoubledFrame;
 class EventDistributor;
+class FrameHashRecorder;
 class FrameSource;
-class GLScaler;
 class MSXMotherBoard;
 class RawFrame;
 class RenderSettings;
@@ -30,13 +27,20 @@ class SuperImposedFrame;
 
 /** A post processor builds the frame that is displayed from the MSX frame,
   * while applying effects such as scalers, noise etc.
+  *
+  * This base class only does the part that can be done on the CPU: it
+  * combines the last few MSX frames into the to-be-displayed frame (e.g.
+  * deinterlace, deflicker, superimpose), passes that frame to the video
+  * recorder and can take (raw) screenshots of it. It doesn't paint anything,
+  * so on its own it's only useful when there's no display (see the headless
+  * renderer). GLPostProcessor extends this with the actual (openGL) output.
   */
-class PostProcessor final : public VideoLayer, private Schedulable
+class PostProcessor : public VideoLayer, private Schedulable
 {
 public:
 	PostProcessor(
 		MSXMotherBoard& motherBoard, Display& display,
-		OutputSurface& screen, const std::string& videoSource,
+		const std::string& videoSource,
 		unsigned maxWidth, unsigned height, bool canDoInterlace);
 	~PostProcessor() override;
 
@@ -82,10 +86,22 @@ public:
 	  */
 	void setRecorder(AviRecorder* recorder_) { recorder = recorder_; }
 
-	/** Is recording active.
-	  * ATM used to keep frameskip constant during recording.
+	/** Start/stop recording frame hashes, similar to setRecorder().
 	  */
-	[[nodiscard]] bool isRecording() const { return recorder != nullptr; }
+	void setHashRecorder(FrameHashRecorder* hashRecorder_) { hashRecorder = hashRecorder_; }
+
+	/** Is recording (video or frame hashes) active.
+	  */
+	[[nodiscard]] bool isRecording() const { return recorder || hashRecorder; }
+
+	/** Should every frame be rendered (IOW frameskip is not allowed)?
+	  * A displayed frame can be skipped when it would arrive too late
+	  * anyway, but frames that are recorded can't. Without a display
+	  * (headless renderer) all frames are rendered, so that e.g. a
+	  * screenshot always shows the current frame, also when running
+	  * (much) faster than realtime.
+	  */
+	[[nodiscard]] virtual bool needAllFrames() const { return true; }
 
 	/** Get the frame that would be displayed. E.g. so that it can be
 	  * superimposed over the output of another PostProcessor, see
@@ -104,38 +120,23 @@ public:
 
 	[[nodiscard]] CliComm& getCliComm();
 
-private:
-	// Observer<Setting> interface:
-	void update(const Setting& setting) noexcept override;
-
-	// Schedulable
-	void executeUntil(EmuTime time) override;
+protected:
+	/** Called (from rotateFrames()) when 'paintFrame' has changed. */
+	virtual void frameRotated() {}
 
 	/** Returns the maximum width for lines [y..y+step).
 	  */
 	[[nodiscard]] static unsigned getLineWidth(FrameSource* frame, unsigned y, unsigned step);
 
-	void initBuffers();
-	void createRegions();
-	void uploadFrame();
-	void uploadBlock(unsigned srcStartY, unsigned srcEndY,
-	                 unsigned lineWidth);
-
-	void preCalcNoise(float factor);
-	void drawNoise() const;
-	void drawGlow(int glow);
-
-	void preCalcMonitor3D(float width);
-	void drawMonitor3D() const;
-
 private:
+	// Schedulable
+	void executeUntil(EmuTime time) override;
+
+protected:
 	Display& display;
 	RenderSettings& renderSettings;
 	EventDistributor& eventDistributor;
 
-	/** The surface which is visible to the user. */
-	OutputSurface& screen;
-
 	/** The last 4 fully rendered (unscaled) MSX frames. */
 	std::array<std::unique_ptr<RawFrame>, 4> lastFrames;
 
@@ -160,12 +161,14 @@ private:
 	/** Video recorder, nullptr when not recording. */
 	AviRecorder* recorder = nullptr;
 
+	/** Frame hash recorder, nullptr when not recording. */
+	FrameHashRecorder* hashRecorder = nullptr;
+
 	/** Video frame on which to superimpose the (VDP) output.
 	  * nullptr when not superimposing. */
 	const RawFrame* superImposeVideoFrame = nullptr;
 	const FrameSource* superImposeVdpFrame = nullptr;
 
-	int interleaveCount = 0; // for interleave-black-frame
 	int lastFramesCount = 0; // How many items in lastFrames[] are up-to-date
 	unsigned maxWidth; // we lazily create RawFrame objects in lastFrames[]
 	unsigned height;   // these two vars remember how big those should be
@@ -177,64 +180,8 @@ private:
 	const bool canDoInterlace;
 
 	EmuTime lastRotate;
-	/** The currently active scaler.
-	  */
-	std::unique_ptr<GLScaler> currScaler;
-
-	struct StoredFrame {
-		gl::ivec2 size; // (re)allocate when window size changes
-		gl::Texture tex;
-		gl::FrameBufferObject fbo;
-	};
-	std::array<StoredFrame, 2> renderedFrames;
-
-	// Noise effect:
-	gl::Texture noiseTextureA{true, true}; // interpolate + wrap
-	gl::Texture noiseTextureB{true, true};
-	float noiseX = 0.0f, noiseY = 0.0f;
-
-	struct TextureData {
-		gl::ColorTexture tex;
-		[[nodiscard]] unsigned width() const { return tex.getWidth(); }
-	};
-	std::vector<TextureData> textures;
-	gl::PixelBuffer<unsigned> pbo;
-
-	gl::ColorTexture superImposeTex;
-
-	struct Region {
-		Region(unsigned srcStartY_, unsigned srcEndY_,
-		       unsigned dstStartY_, unsigned dstEndY_,
-		       unsigned lineWidth_)
-			: srcStartY(srcStartY_)
-			, srcEndY(srcEndY_)
-			, dstStartY(dstStartY_)
-			, dstEndY(dstEndY_)
-			, lineWidth(lineWidth_) {}
-		unsigned srcStartY;
-		unsigned srcEndY;
-		unsigned dstStartY;
-		unsigned dstEndY;
-		unsigned lineWidth;
-	};
-	std::vector<Region> regions;
-	unsigned regionsDstHeight = 0; // 'regions' were calculated for this output height (relevant when changing scale_factor when paused)
-
-	unsigned frameCounter = 0;
-
-	/** Currently active scale algorithm, used to detect scaler changes.
-	  */
-	RenderSettings::ScaleAlgorithm scaleAlgorithm = RenderSettings::ScaleAlgorithm::NO;
-
-	gl::ShaderProgram monitor3DProg;
-	gl::BufferObject arrayBuffer;
-	gl::BufferObject elementBuffer;
-	gl::BufferObject vbo;
-	gl::BufferObject stretchVBO;
-
-	bool storedFrame = false;
 };
 
 } // namespace openmsx
 
-#endif // GLPOSTPROCESSOR_HH
+#endif // POSTPROCESSOR_HH
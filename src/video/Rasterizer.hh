@@ -105,9 +105,10 @@ public:
 		int displayX, int displayY,
 		int displayWidth, int displayHeight) = 0;
 
-	/** Is video recording active?
+	/** Should every frame be rendered? E.g. because video recording is
+	  * active. If so, frameskip is not allowed.
 	  */
-	[[nodiscard]] virtual bool isRecording() const = 0;
+	[[nodiscard]] virtual bool needAllFrames() const = 0;
 
 protected:
 	Rasterizer() = default;
@@ -36,7 +36,8 @@ EnumSetting<RenderSettings::RendererID>::Map RenderSettings::getRendererMap()
 	EnumSetting<RendererID>::Map rendererMap = {
 		{"uninitialized", UNINITIALIZED},
 		{"none",          DUMMY},
-		{"SDLGL-PP",      SDLGL_PP}
+		{"SDLGL-PP",      SDLGL_PP},
+		{"headless",      HEADLESS}
 	};
 	return rendererMap;
 }
@@ -178,6 +179,12 @@ RenderSettings::RenderSettings(CommandController& commandController)
 		"Useful on (100Hz+) lightboost enabled monitors to reduce "
 		"motion blur and double frame artifacts.",
 		false)
+
+	, renderThreadsSetting(commandController,
+		"render_threads",
+		"number of helper threads used to convert the VRAM content of "
+		"the MSX display to pixels in parallel, 0 means everything is "
+		"rendered on the emulation thread", 0, 0, 16)
 {
 	brightnessSetting.attach(*this);
 	contrastSetting  .attach(*this);
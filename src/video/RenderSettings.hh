@@ -28,7 +28,7 @@ public:
 	/** Enumeration of Renderers known to openMSX.
 	  * This is the full list, the list of available renderers may be smaller.
 	  */
-	enum class RendererID : uint8_t { UNINITIALIZED, DUMMY, SDLGL_PP };
+	enum class RendererID : uint8_t { UNINITIALIZED, DUMMY, SDLGL_PP, HEADLESS };
 	using RendererSetting = EnumSetting<RendererID>;
 
 	/** Render accuracy: granularity of the rendered area.
@@ -187,6 +187,12 @@ public:
 		return interleaveBlackFrameSetting.getBoolean();
 	}
 
+	/** The number of helper threads used to render the MSX display. */
+	[[nodiscard]] IntegerSetting& getRenderThreadsSetting() { return renderThreadsSetting; }
+	[[nodiscard]] unsigned getRenderThreads() const {
+		return unsigned(renderThreadsSetting.getInt());
+	}
+
 	/** Apply brightness, contrast and gamma transformation on the input
 	  * color component. The component is expected to be in the range
 	  * [0.0 .. 1.0] but it's not an error if it lays outside of this range.
@@ -246,6 +252,7 @@ private:
 	FloatSetting horizontalStretchSetting;
 	FloatSetting pointerHideDelaySetting;
 	BooleanSetting interleaveBlackFrameSetting;
+	IntegerSetting renderThreadsSetting;
 
 	float brightness;
 	float contrast;
@@ -3,6 +3,7 @@
 #include "Display.hh"
 #include "DummyRenderer.hh"
 #include "DummyVideoSystem.hh"
+#include "HeadlessVideoSystem.hh"
 #include "PixelRenderer.hh"
 #include "SDLVideoSystem.hh"
 #include "V9990DummyRenderer.hh"
@@ -29,6 +30,8 @@ std::unique_ptr<VideoSystem> createVideoSystem(Reactor& reactor)
 			return std::make_unique<DummyVideoSystem>();
 		case RenderSettings::RendererID::SDLGL_PP:
 			return std::make_unique<SDLVideoSystem>(reactor);
+		case RenderSettings::RendererID::HEADLESS:
+			return std::make_unique<HeadlessVideoSystem>(reactor);
 		default:
 			UNREACHABLE;
 	}
@@ -40,6 +43,7 @@ std::unique_ptr<Renderer> createRenderer(VDP& vdp, Display& display)
 		case RenderSettings::RendererID::DUMMY:
 			return std::make_unique<DummyRenderer>();
 		case RenderSettings::RendererID::SDLGL_PP:
+		case RenderSettings::RendererID::HEADLESS:
 			return std::make_unique<PixelRenderer>(vdp, display);
 		default:
 			UNREACHABLE;
@@ -52,6 +56,7 @@ std::unique_ptr<V9990Renderer> createV9990Renderer(V9990& vdp, Display& display)
 		case RenderSettings::RendererID::DUMMY:
 			return std::make_unique<V9990DummyRenderer>();
 		case RenderSettings::RendererID::SDLGL_PP:
+		case RenderSettings::RendererID::HEADLESS:
 			return std::make_unique<V9990PixelRenderer>(vdp);
 		default:
 			UNREACHABLE;
@@ -65,6 +70,7 @@ std::unique_ptr<LDRenderer> createLDRenderer(LaserdiscPlayer& ld, Display& displ
 		case RenderSettings::RendererID::DUMMY:
 			return std::make_unique<LDDummyRenderer>();
 		case RenderSettings::RendererID::SDLGL_PP:
+		case RenderSettings::RendererID::HEADLESS:
 			return std::make_unique<LDPixelRenderer>(ld, display);
 		default:
 			UNREACHABLE;
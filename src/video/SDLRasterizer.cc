@@ -8,6 +8,7 @@
 #include "Renderer.hh"
 #include "VDP.hh"
 #include "VDPVRAM.hh"
+#include "WorkerThreads.hh"
 
 #include "MemoryOps.hh"
 #include "enumerate.hh"
@@ -506,7 +507,10 @@ void SDLRasterizer::drawDisplay(
 	pageBorder = std::min(pageBorder, pageSplit);
 
 	if (mode.isBitmapMode()) {
-		for (auto y : xrange(screenY, screenLimitY)) {
+		bitmapConverter.prepareParallel();
+		renderLines(displayHeight, [&](int n) {
+			int y = screenY + n;
+			int dispY = (displayY + n) & 255;
 			// Which bits in the name mask determine the page?
 			// TODO optimize this?
 			//   Calculating pageMaskOdd/Even is a non-trivial amount
@@ -520,8 +524,8 @@ void SDLRasterizer::drawDisplay(
 				? (pageMaskOdd & ~0x100)
 				: pageMaskOdd;
 			const std::array<unsigned, 2> vramLine = {
-				(vram.nameTable.getMask() >> 7) & (pageMaskEven | displayY),
-				(vram.nameTable.getMask() >> 7) & (pageMaskOdd  | displayY)
+				(vram.nameTable.getMask() >> 7) & (pageMaskEven | dispY),
+				(vram.nameTable.getMask() >> 7) & (pageMaskOdd  | dispY)
 			};
 
 			std::array<Pixel, 512> buf;
@@ -551,26 +555,24 @@ void SDLRasterizer::drawDisplay(
 				copy_to_range(subspan(buf, x, displayWidth - firstPageWidth),
 				              subspan(dst, firstPageWidth));
 			}
-
-			displayY = (displayY + 1) & 255;
-		}
+		});
 	} else {
 		// horizontal scroll (high) is implemented in CharacterConverter
-		for (auto y : xrange(screenY, screenLimitY)) {
-			assert(!vdp.isMSX1VDP() || displayY < 192);
+		renderLines(displayHeight, [&](int n) {
+			int y = screenY + n;
+			int dispY = (displayY + n) & 255;
+			assert(!vdp.isMSX1VDP() || dispY < 192);
 
 			auto dst = workFrame->getLineDirect(y).subspan(leftBackground + displayX);
 			if ((displayX == 0) && (displayWidth == narrow<int>(lineWidth))){
-				characterConverter.convertLine(dst, displayY);
+				characterConverter.convertLine(dst, dispY);
 			} else {
 				std::array<Pixel, 512> buf;
-				characterConverter.convertLine(buf, displayY);
+				characterConverter.convertLine(buf, dispY);
 				auto src = subspan(buf, displayX, displayWidth);
 				copy_to_range(src, dst);
 			}
-
-			displayY = (displayY + 1) & 255;
-		}
+		});
 	}
 }
 
@@ -597,42 +599,65 @@ void SDLRasterizer::drawSprites(
 	//       pixels in this display mode?
 	int spriteMode = vdp.getDisplayMode().getSpriteMode(vdp.isMSX1VDP());
 	int displayLimitX = displayX + displayWidth;
-	int limitY = fromY + displayHeight;
 	int screenX = translateX(
 		vdp.getLeftSprites(),
 		vdp.getDisplayMode().getLineWidth() == 512);
+	auto draw = [&](auto drawLine) {
+		renderLines(displayHeight, [&](int n) {
+			auto dst = workFrame->getLineDirect(screenY + n).subspan(screenX);
+			drawLine(fromY + n, dst);
+		});
+	};
 	if (spriteMode == 1) {
-		for (int y = fromY; y < limitY; y++, screenY++) {
-			auto dst = workFrame->getLineDirect(screenY).subspan(screenX);
+		draw([&](int y, std::span<Pixel> dst) {
 			spriteConverter.drawMode1(y, displayX, displayLimitX, dst);
-		}
+		});
 	} else {
 		uint8_t mode = vdp.getDisplayMode().getByte();
 		if (mode == DisplayMode::GRAPHIC5) {
-			for (int y = fromY; y < limitY; y++, screenY++) {
-				auto dst = workFrame->getLineDirect(screenY).subspan(screenX);
+			draw([&](int y, std::span<Pixel> dst) {
 				spriteConverter.template drawMode2<DisplayMode::GRAPHIC5>(
 					y, displayX, displayLimitX, dst);
-			}
+			});
 		} else if (mode == DisplayMode::GRAPHIC6) {
-			for (int y = fromY; y < limitY; y++, screenY++) {
-				auto dst = workFrame->getLineDirect(screenY).subspan(screenX);
+			draw([&](int y, std::span<Pixel> dst) {
 				spriteConverter.template drawMode2<DisplayMode::GRAPHIC6>(
 					y, displayX, displayLimitX, dst);
-			}
+			});
 		} else {
-			for (int y = fromY; y < limitY; y++, screenY++) {
-				auto dst = workFrame->getLineDirect(screenY).subspan(screenX);
+			draw([&](int y, std::span<Pixel> dst) {
 				spriteConverter.template drawMode2<DisplayMode::GRAPHIC4>(
 					y, displayX, displayLimitX, dst);
-			}
+			});
 		}
 	}
 }
 
-bool SDLRasterizer::isRecording() const
+void SDLRasterizer::renderLines(int numLines, function_ref<void(int)> renderLine)
+{
+	// Only split the work when there are enough lines, and give each
+	// job a chunk of lines, this keeps the overhead per job small.
+	static constexpr int CHUNK_LINES = 16;
+	auto numThreads = renderSettings.getRenderThreads();
+	if ((numThreads == 0) || (numLines < 2 * CHUNK_LINES)) {
+		if (numThreads == 0) workers.reset();
+		for (auto n : xrange(numLines)) renderLine(n);
+		return;
+	}
+	if (!workers || (workers->getNumThreads() != numThreads)) {
+		workers = std::make_unique<WorkerThreads>(numThreads);
+	}
+	auto numChunks = size_t(numLines + CHUNK_LINES - 1) / CHUNK_LINES;
+	workers->run(numChunks, [&](size_t chunk) {
+		int begin = narrow<int>(chunk) * CHUNK_LINES;
+		int end = std::min(begin + CHUNK_LINES, numLines);
+		for (auto n : xrange(begin, end)) renderLine(n);
+	});
+}
+
+bool SDLRasterizer::needAllFrames() const
 {
-	return postProcessor->isRecording();
+	return postProcessor->needAllFrames();
 }
 
 void SDLRasterizer::update(const Setting& setting) noexcept
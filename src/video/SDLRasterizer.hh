@@ -7,6 +7,7 @@
 #include "SpriteConverter.hh"
 
 #include "Observer.hh"
+#include "function_ref.hh"
 
 #include <array>
 #include <cstdint>
@@ -22,6 +23,7 @@ class RawFrame;
 class RenderSettings;
 class Setting;
 class PostProcessor;
+class WorkerThreads;
 
 /** Rasterizer using a frame buffer approach: it writes pixels to a single
   * rectangular pixel buffer.
@@ -66,11 +68,17 @@ public:
 		int fromX, int fromY,
 		int displayX, int displayY,
 		int displayWidth, int displayHeight) override;
-	[[nodiscard]] bool isRecording() const override;
+	[[nodiscard]] bool needAllFrames() const override;
 
 private:
 	inline void renderBitmapLine(std::span<Pixel> buf, unsigned vramLine);
 
+	/** Execute 'renderLine(n)' for all n in [0, numLines). Depending on
+	  * the 'render_threads' setting this is done in parallel, so the
+	  * rendering of one line must not depend on the other lines.
+	  */
+	void renderLines(int numLines, function_ref<void(int)> renderLine);
+
 	/** Reload entire palette from VDP.
 	  */
 	void resetPalette();
@@ -164,6 +172,10 @@ private:
 	/** Host colors corresponding to each possible V9958 color.
 	  */
 	std::array<Pixel, 32768> V9958_COLORS;
+
+	/** Helper threads for renderLines(), nullptr when not used.
+	  */
+	std::unique_ptr<WorkerThreads> workers;
 };
 
 } // namespace openmsx
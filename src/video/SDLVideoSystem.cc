@@ -1,8 +1,8 @@
 #include "SDLVideoSystem.hh"
 
 #include "Display.hh"
+#include "GLPostProcessor.hh"
 #include "GlobalSettings.hh"
-#include "PostProcessor.hh"
 #include "RenderSettings.hh"
 #include "SDLRasterizer.hh"
 #include "V9990.hh"
@@ -69,7 +69,7 @@ std::unique_ptr<Rasterizer> SDLVideoSystem::createRasterizer(VDP& vdp)
 	auto& motherBoard = vdp.getMotherBoard();
 	return std::make_unique<SDLRasterizer>(
 		vdp, display, *screen,
-		std::make_unique<PostProcessor>(
+		std::make_unique<GLPostProcessor>(
 			motherBoard, display, *screen,
 			videoSource, 640, 240, true));
 }
@@ -84,7 +84,7 @@ std::unique_ptr<V9990Rasterizer> SDLVideoSystem::createV9990Rasterizer(
 	MSXMotherBoard& motherBoard = vdp.getMotherBoard();
 	return std::make_unique<V9990SDLRasterizer>(
 		vdp, display, *screen,
-		std::make_unique<PostProcessor>(
+		std::make_unique<GLPostProcessor>(
 			motherBoard, display, *screen,
 			videoSource, 1280, 240, true));
 }
@@ -97,7 +97,7 @@ std::unique_ptr<LDRasterizer> SDLVideoSystem::createLDRasterizer(
 	std::string videoSource = "Laserdisc"; // TODO handle multiple???
 	MSXMotherBoard& motherBoard = ld.getMotherBoard();
 	return std::make_unique<LDSDLRasterizer>(
-		std::make_unique<PostProcessor>(
+		std::make_unique<GLPostProcessor>(
 			motherBoard, display, *screen,
 			videoSource, 640, 480, false));
 }
@@ -443,7 +443,7 @@ void VisibleSurface::setViewPort(gl::ivec2 logicalSize, bool fullScreen)
 	// The created surface may be larger than requested.
 	// If that happens, center the area that we actually use.
 	calculateViewPort(logicalSize, physicalSize);
-	// actually setting the viewport is done in PostProcessor::paint()
+	// actually setting the viewport is done in GLPostProcessor::paint()
 
 	gl::context->setupMvpMatrix(gl::vec2(logicalSize));
 }
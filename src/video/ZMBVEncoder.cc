@@ -4,11 +4,13 @@
 
 #include "FrameSource.hh"
 #include "PixelOperations.hh"
+#include "WorkerThreads.hh"
 
 #include "cstd.hh"
 #include "endian.hh"
 #include "narrow.hh"
 #include "unreachable.hh"
+#include "xrange.hh"
 
 #include <algorithm>
 #include <array>
@@ -18,6 +20,7 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <thread>
 #include <tuple>
 
 namespace openmsx {
@@ -143,18 +146,17 @@ ZMBVEncoder::ZMBVEncoder(unsigned width_, unsigned height_)
 	// Level 6 seems a good compromise between size/speed for THIS test.
 }
 
+ZMBVEncoder::~ZMBVEncoder() = default;
+
 void ZMBVEncoder::setupBuffers()
 {
 	static constexpr size_t pixelSize = sizeof(Pixel);
 
 	pitch = width + 2 * MAX_VECTOR;
-	auto bufSize = (height + 2 * MAX_VECTOR) * pitch * pixelSize + 2048;
+	frameBufSize = (height + 2 * MAX_VECTOR) * pitch * pixelSize + 2048;
 
-	oldFrame.resize(bufSize);
-	newFrame.resize(bufSize);
-	std::ranges::fill(std::span{oldFrame}, 0);
-	std::ranges::fill(std::span{newFrame}, 0);
-	work.resize(bufSize);
+	oldFrame = createFrameBuffer();
+	newFrame = createFrameBuffer();
 	outputSize = neededSize();
 	output.resize(outputSize);
 
@@ -170,6 +172,28 @@ void ZMBVEncoder::setupBuffers()
 				(x * BLOCK_WIDTH) + MAX_VECTOR;
 		}
 	}
+	blockVectors.resize(xBlocks * yBlocks);
+
+	// The motion search is split in horizontal stripes (of whole block
+	// rows) that are searched in parallel, see addXorFrame().
+	numStripes = std::clamp(std::thread::hardware_concurrency(),
+	                        1u, narrow<unsigned>(yBlocks));
+	workers = std::make_unique<WorkerThreads>(numStripes - 1);
+}
+
+ZMBVEncoder::Buffer ZMBVEncoder::createFrameBuffer() const
+{
+	// The border around the frame must be black. captureFrame() only
+	// writes the inner part, so the border remains black when a buffer
+	// gets reused.
+	Buffer result(frameBufSize);
+	std::ranges::fill(std::span{result}, 0);
+	return result;
+}
+
+ZMBVEncoder::Buffer ZMBVEncoder::createWorkBuffer() const
+{
+	return Buffer(frameBufSize);
 }
 
 unsigned ZMBVEncoder::neededSize() const
@@ -179,7 +203,7 @@ unsigned ZMBVEncoder::neededSize() const
 	return f + f / 1000;
 }
 
-unsigned ZMBVEncoder::possibleBlock(int vx, int vy, size_t offset)
+unsigned ZMBVEncoder::possibleBlock(int vx, int vy, size_t offset) const
 {
 	int ret = 0;
 	const auto* pOld = &(std::bit_cast<const Pixel*>(oldFrame.data()))[offset + (vy * pitch) + vx];
@@ -194,7 +218,7 @@ unsigned ZMBVEncoder::possibleBlock(int vx, int vy, size_t offset)
 	return ret;
 }
 
-unsigned ZMBVEncoder::compareBlock(int vx, int vy, size_t offset)
+unsigned ZMBVEncoder::compareBlock(int vx, int vy, size_t offset) const
 {
 	int ret = 0;
 	const auto* pOld = &(std::bit_cast<const Pixel*>(oldFrame.data()))[offset + (vy * pitch) + vx];
@@ -209,7 +233,7 @@ unsigned ZMBVEncoder::compareBlock(int vx, int vy, size_t offset)
 	return ret;
 }
 
-void ZMBVEncoder::addXorBlock(int vx, int vy, size_t offset, unsigned& workUsed)
+void ZMBVEncoder::addXorBlock(int vx, int vy, size_t offset, std::span<uint8_t> work, unsigned& workUsed)
 {
 	using LE_P = typename Endian::Little<Pixel>::type;
 
@@ -226,7 +250,36 @@ void ZMBVEncoder::addXorBlock(int vx, int vy, size_t offset, unsigned& workUsed)
 	});
 }
 
-void ZMBVEncoder::addXorFrame(unsigned& workUsed)
+ZMBVEncoder::BlockVector ZMBVEncoder::searchBlock(int vx, int vy, size_t offset) const
+{
+	// first try best vector of previous block
+	BlockVector best{vx, vy, compareBlock(vx, vy, offset)};
+	if (best.change >= 4) {
+		int possibles = 64;
+		for (const auto& v : vectorTable) {
+			if (possibleBlock(v.x, v.y, offset) < 4) {
+				if (auto testChange = compareBlock(v.x, v.y, offset);
+				    testChange < best.change) {
+					best = {narrow<int>(v.x), narrow<int>(v.y), testChange};
+					if (best.change < 4) break;
+				}
+				--possibles;
+				if (possibles == 0) break;
+			}
+		}
+	}
+	return best;
+}
+
+void ZMBVEncoder::searchBlocks(unsigned begin, unsigned end)
+{
+	BlockVector prev{0, 0, 0};
+	for (auto b : xrange(begin, end)) {
+		prev = blockVectors[b] = searchBlock(prev.vx, prev.vy, blockOffsets[b]);
+	}
+}
+
+void ZMBVEncoder::addXorFrame(std::span<uint8_t> work, unsigned& workUsed)
 {
 	auto* vectors = std::bit_cast<int8_t*>(&work[workUsed]);
 
@@ -237,38 +290,42 @@ void ZMBVEncoder::addXorFrame(unsigned& workUsed)
 	// Align the following xor data on 4 byte boundary
 	workUsed = (workUsed + blockCount * 2 + 3) & ~3;
 
-	int bestVx = 0;
-	int bestVy = 0;
-	for (auto b : xrange(blockCount)) {
-		auto offset = blockOffsets[b];
-		// first try best vector of previous block
-		unsigned bestChange = compareBlock(bestVx, bestVy, offset);
-		if (bestChange >= 4) {
-			int possibles = 64;
-			for (const auto& v : vectorTable) {
-				if (possibleBlock(v.x, v.y, offset) < 4) {
-					if (auto testChange = compareBlock(v.x, v.y, offset);
-					    testChange < bestChange) {
-						bestChange = testChange;
-						bestVx = narrow<int>(v.x);
-						bestVy = narrow<int>(v.y);
-						if (bestChange < 4) break;
-					}
-					--possibles;
-					if (possibles == 0) break;
-				}
-			}
+	// The search for a block starts with the best vector of the previous
+	// block, so strictly speaking this is a sequential process. Instead
+	// each stripe is searched in parallel, starting from the (0,0) vector
+	// (that's exact for the first stripe). Afterwards the first blocks of
+	// the other stripes are searched again starting from the correct
+	// vector, until the result is the same as in the first pass (from then
+	// on all following results are the same as well). This gives the exact
+	// same result as a sequential search. In practice only very few blocks
+	// need to be searched again.
+	auto stripeBegin = [&](unsigned s) { return (s * yBlocks / numStripes) * xBlocks; };
+	workers->run(numStripes, [&](size_t s) {
+		searchBlocks(stripeBegin(unsigned(s)), stripeBegin(unsigned(s + 1)));
+	});
+
+	for (auto s : xrange(1u, numStripes)) {
+		auto prev = blockVectors[stripeBegin(s) - 1];
+		if ((prev.vx == 0) && (prev.vy == 0)) continue; // was already exact
+		for (auto b : xrange(stripeBegin(s), stripeBegin(s + 1))) {
+			auto best = searchBlock(prev.vx, prev.vy, blockOffsets[b]);
+			if (best == blockVectors[b]) break;
+			prev = blockVectors[b] = best;
 		}
-		vectors[b * 2 + 0] = narrow<int8_t>(bestVx << 1);
-		vectors[b * 2 + 1] = narrow<int8_t>(bestVy << 1);
-		if (bestChange) {
+	}
+
+	for (auto b : xrange(blockCount)) {
+		const auto& best = blockVectors[b];
+		vectors[b * 2 + 0] = narrow<int8_t>(best.vx << 1);
+		vectors[b * 2 + 1] = narrow<int8_t>(best.vy << 1);
+		if (best.change) {
 			vectors[b * 2 + 0] |= 1;
-			addXorBlock(bestVx, bestVy, offset, workUsed);
+			addXorBlock(best.vx, best.vy, blockOffsets[b], work, workUsed);
 		}
 	}
 }
 
-void ZMBVEncoder::addFullFrame(unsigned& workUsed)
+void ZMBVEncoder::addFullFrame(std::span<uint8_t> work, unsigned& workUsed)
 {
 	using LE_P = typename Endian::Little<Pixel>::type;
 	static constexpr size_t pixelSize = sizeof(Pixel);
@@ -300,12 +357,44 @@ const ZMBVEncoder::Pixel* ZMBVEncoder::getScaledLine(const FrameSource* frame, u
 	}
 }
 
-std::span<const uint8_t> ZMBVEncoder::compressFrame(bool keyFrame, const FrameSource* frame)
+void ZMBVEncoder::captureFrame(const FrameSource* frame, Buffer& frameBuf) const
 {
+	assert(frameBuf.size() == frameBufSize);
+
+	// copy lines (to add black border)
+	static constexpr size_t pixelSize = sizeof(Pixel);
+	auto linePitch = pitch * pixelSize;
+	auto lineWidth = size_t(width) * pixelSize;
+	uint8_t* dest =
+		&frameBuf[pixelSize * (MAX_VECTOR + MAX_VECTOR * pitch)];
+	for (auto i : xrange(height)) {
+		const auto* scaled = std::bit_cast<const uint8_t*>(
+			getScaledLine(frame, i, std::bit_cast<Pixel*>(dest)));
+		if (scaled != dest) memcpy(dest, scaled, lineWidth);
+		dest += linePitch;
+	}
+}
+
+unsigned ZMBVEncoder::encodeFrame(bool keyFrame, Buffer& frameBuf, std::span<uint8_t> work)
+{
+	assert(work.size() >= frameBufSize);
 	std::swap(newFrame, oldFrame); // replace oldFrame with newFrame
+	std::swap(newFrame, frameBuf); // and hand out the previous oldFrame
 
-	// Reset the work buffer
+	// Add the frame data.
 	unsigned workUsed = 0;
+	if (keyFrame) {
+		// Key frame: full frame data.
+		addFullFrame(work, workUsed);
+	} else {
+		// Non-key frame: delta frame data.
+		addXorFrame(work, workUsed);
+	}
+	return workUsed;
+}
+
+std::span<const uint8_t> ZMBVEncoder::deflateFrame(bool keyFrame, std::span<const uint8_t> work)
+{
 	unsigned writeDone = 1;
 	uint8_t* writeBuf = output.data();
 
@@ -326,30 +415,9 @@ std::span<const uint8_t> ZMBVEncoder::compressFrame(bool keyFrame, const FrameSo
 		deflateReset(&zstream); // restart deflate
 	}
 
-	// copy lines (to add black border)
-	static constexpr size_t pixelSize = sizeof(Pixel);
-	auto linePitch = pitch * pixelSize;
-	auto lineWidth = size_t(width) * pixelSize;
-	uint8_t* dest =
-		&newFrame[pixelSize * (MAX_VECTOR + MAX_VECTOR * pitch)];
-	for (auto i : xrange(height)) {
-		const auto* scaled = std::bit_cast<const uint8_t*>(
-			getScaledLine(frame, i, std::bit_cast<Pixel*>(dest)));
-		if (scaled != dest) memcpy(dest, scaled, lineWidth);
-		dest += linePitch;
-	}
-
-	// Add the frame data.
-	if (keyFrame) {
-		// Key frame: full frame data.
-		addFullFrame(workUsed);
-	} else {
-		// Non-key frame: delta frame data.
-		addXorFrame(workUsed);
-	}
 	// Compress the frame data with zlib.
-	zstream.next_in = work.data();
-	zstream.avail_in = workUsed;
+	zstream.next_in = const_cast<Bytef*>(work.data());
+	zstream.avail_in = narrow<uInt>(work.size());
 	zstream.total_in = 0;
 
 	zstream.next_out = std::bit_cast<Bytef*>(writeBuf + writeDone);
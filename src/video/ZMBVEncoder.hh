@@ -7,6 +7,7 @@
 #include "aligned.hh"
 
 #include <cstdint>
+#include <memory>
 #include <span>
 #include <string_view>
 
@@ -15,6 +16,7 @@
 namespace openmsx {
 
 class FrameSource;
+class WorkerThreads;
 
 class ZMBVEncoder
 {
@@ -27,27 +29,70 @@ public:
 	ZMBVEncoder(ZMBVEncoder&&) = delete;
 	ZMBVEncoder& operator=(const ZMBVEncoder&) = delete;
 	ZMBVEncoder& operator=(ZMBVEncoder&&) = delete;
-	~ZMBVEncoder() = default;
+	~ZMBVEncoder();
 
-	[[nodiscard]] std::span<const uint8_t> compressFrame(bool keyFrame, const FrameSource* frame);
+	// Compressing a frame is split in three steps, so that (in a
+	// pipeline) each step can run on a different thread:
+	//  - captureFrame(): copy the frame into a buffer. This must run on
+	//    the thread that owns the FrameSource.
+	//  - encodeFrame(): motion search, produces the (uncompressed) frame
+	//    data.
+	//  - deflateFrame(): zlib compress that data.
+	// Each step must be called in frame order, but different steps can run
+	// concurrently (e.g. capture frame N+2 while encoding frame N+1 while
+	// deflating frame N). The result is the same as when all steps run
+	// sequentially on one thread.
+	using Buffer = MemBuffer<uint8_t, SSE_ALIGNMENT>;
+
+	/** Create a buffer suited for captureFrame(). */
+	[[nodiscard]] Buffer createFrameBuffer() const;
+	/** Create a buffer suited for encodeFrame(). */
+	[[nodiscard]] Buffer createWorkBuffer() const;
+
+	/** Copy the content of 'frame' into 'frameBuf'. 'frameBuf' must be
+	  * created by createFrameBuffer() or returned by encodeFrame(). */
+	void captureFrame(const FrameSource* frame, Buffer& frameBuf) const;
+
+	/** Encode a captured frame into 'work', returns the number of bytes
+	  * in 'work'. The captured frame becomes the new reference frame, on
+	  * return 'frameBuf' holds the previous reference frame (it can be
+	  * reused for a next captureFrame() call). */
+	[[nodiscard]] unsigned encodeFrame(bool keyFrame, Buffer& frameBuf, std::span<uint8_t> work);
+
+	/** Compress the output of encodeFrame(). The result remains valid
+	  * till the next call. */
+	[[nodiscard]] std::span<const uint8_t> deflateFrame(bool keyFrame, std::span<const uint8_t> work);
 
 private:
+	// Result of the motion search for one block.
+	struct BlockVector {
+		int vx;
+		int vy;
+		unsigned change;
+		[[nodiscard]] bool operator==(const BlockVector&) const = default;
+	};
+
 	void setupBuffers();
 	[[nodiscard]] unsigned neededSize() const;
-	void addFullFrame(unsigned& workUsed);
-	void addXorFrame (unsigned& workUsed);
-	[[nodiscard]] unsigned possibleBlock(int vx, int vy, size_t offset);
-	[[nodiscard]] unsigned compareBlock(int vx, int vy, size_t offset);
-	void addXorBlock(int vx, int vy, size_t offset, unsigned& workUsed);
+	void addFullFrame(std::span<uint8_t> work, unsigned& workUsed);
+	void addXorFrame (std::span<uint8_t> work, unsigned& workUsed);
+	void searchBlocks(unsigned begin, unsigned end);
+	[[nodiscard]] BlockVector searchBlock(int vx, int vy, size_t offset) const;
+	[[nodiscard]] unsigned possibleBlock(int vx, int vy, size_t offset) const;
+	[[nodiscard]] unsigned compareBlock(int vx, int vy, size_t offset) const;
+	void addXorBlock(int vx, int vy, size_t offset, std::span<uint8_t> work, unsigned& workUsed);
 	[[nodiscard]] const Pixel* getScaledLine(const FrameSource* frame, unsigned y, Pixel* workBuf) const;
 
 private:
-	MemBuffer<uint8_t, SSE_ALIGNMENT> oldFrame;
-	MemBuffer<uint8_t, SSE_ALIGNMENT> newFrame;
-	MemBuffer<uint8_t, SSE_ALIGNMENT> work;
+	Buffer oldFrame;
+	Buffer newFrame;
 	MemBuffer<uint8_t> output;
 	MemBuffer<size_t> blockOffsets;
+	MemBuffer<BlockVector> blockVectors;
+	size_t frameBufSize;
 	unsigned outputSize;
+	unsigned numStripes;
+	std::unique_ptr<WorkerThreads> workers; // numStripes - 1 threads
 
 	z_stream zstream;
 
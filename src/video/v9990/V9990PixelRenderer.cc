@@ -83,7 +83,7 @@ void V9990PixelRenderer::frameStart(EmuTime time)
 			drawFrame = true;
 		} else {
 			++frameSkipCounter;
-			if (rasterizer->isRecording()) {
+			if (rasterizer->needAllFrames()) {
 				drawFrame = true;
 			} else {
 				drawFrame = realTime.timeLeft(
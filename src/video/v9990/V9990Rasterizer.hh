@@ -94,9 +94,10 @@ public:
 		int fromX, int fromY, int toX, int toY,
 		int displayX, int displayY, int displayYA, int displayYB) = 0;
 
-	/** Is video recording active?
+	/** Should every frame be rendered? E.g. because video recording is
+	  * active. If so, frameskip is not allowed.
 	  */
-	[[nodiscard]] virtual bool isRecording() const = 0;
+	[[nodiscard]] virtual bool needAllFrames() const = 0;
 };
 
 } // namespace openmsx
@@ -339,9 +339,9 @@ void V9990SDLRasterizer::setSuperimpose(bool /*enabled*/)
 	resetPalette();
 }
 
-bool V9990SDLRasterizer::isRecording() const
+bool V9990SDLRasterizer::needAllFrames() const
 {
-	return postProcessor->isRecording();
+	return postProcessor->needAllFrames();
 }
 
 void V9990SDLRasterizer::update(const Setting& setting) noexcept
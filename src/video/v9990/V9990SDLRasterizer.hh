@@ -53,7 +53,7 @@ public:
 	void drawDisplay(int fromX, int fromY, int toX, int toY,
 	                 int displayX,
 	                 int displayY, int displayYA, int displayYB) override;
-	[[nodiscard]] bool isRecording() const override;
+	[[nodiscard]] bool needAllFrames() const override;
 
 	/** Fill the palettes.
 	  */
@@ -121,6 +121,9 @@ void Video9000::paint(OutputSurface& output)
 
 void Video9000::takeRawScreenShot(std::optional<unsigned> height, const std::string& filename)
 {
+	if (!activeLayer) {
+		recalculate(); // e.g. headless renderer, paint() is never called
+	}
 	auto* layer = dynamic_cast<VideoLayer*>(activeLayer);
 	if (!layer) {
 		throw CommandException("TODO");